@@ -0,0 +1,99 @@
+#include "bench_util.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+using namespace select_n::bench_n;
+
+double result_t::percentile( const double q ) const
+{
+  if ( samples.empty() )
+    return 0;
+
+  const auto position{ q * static_cast< double >( samples.size() - 1 ) };
+  const auto lower{ static_cast< std::size_t >( std::floor( position ) ) };
+  const auto upper{ std::min( lower + 1, samples.size() - 1 ) };
+  return samples[ lower ] + ( samples[ upper ] - samples[ lower ] ) * ( position - static_cast< double >( lower ) );
+}
+
+double result_t::mean() const
+{
+  return samples.empty() ? 0 : std::accumulate( samples.begin(), samples.end(), 0.0 ) / static_cast< double >( samples.size() );
+}
+
+options_t options_t::parse( const int argc, char **argv )
+{
+  options_t options;
+  for ( int index{ 1 }; index < argc; ++index )
+  {
+    const std::string argument{ argv[ index ] };
+    if ( index + 1 == argc )
+      throw std::invalid_argument{ "missing value for " + argument };
+
+    const std::string value{ argv[ ++index ] };
+    if ( argument == "--repetitions" )
+      options.repetitions = std::max< std::size_t >( std::stoul( value ), 1 );
+    else if ( argument == "--min-time-ms" )
+      options.min_sample_time = std::chrono::milliseconds{ std::stoul( value ) };
+    else if ( argument == "--filter" )
+      options.filter = value;
+    else if ( argument == "--json" )
+      options.json_path = value;
+    else
+      throw std::invalid_argument{ "unknown option " + argument };
+  }
+  return options;
+}
+
+bool suite::selected( const case_t &parameters ) const
+{
+  const auto name{ parameters.operation + "/" + parameters.container + "/" + parameters.key_type };
+  return _options.filter.empty() || name.find( _options.filter ) != std::string::npos;
+}
+
+void suite::print( const result_t &result )
+{
+  if ( !_header_printed )
+  {
+    std::cout << std::left << std::setw( 30 ) << "operation" << std::setw( 16 ) << "container" << std::setw( 8 ) << "key"
+              << std::right << std::setw( 8 ) << "size" << std::setw( 6 ) << "hit" << std::setw( 10 ) << "p50 ns" << std::setw( 10 ) << "p90 ns" << std::setw( 10 ) << "p99 ns" << '\n';
+    _header_printed = true;
+  }
+
+  const auto &parameters{ result.parameters };
+  std::cout << std::left << std::setw( 30 ) << parameters.operation << std::setw( 16 ) << parameters.container << std::setw( 8 ) << parameters.key_type
+            << std::right << std::setw( 8 ) << parameters.size << std::setw( 6 ) << std::setprecision( 2 ) << parameters.hit_ratio
+            << std::fixed << std::setprecision( 2 ) << std::setw( 10 ) << result.percentile( 0.5 ) << std::setw( 10 ) << result.percentile( 0.9 ) << std::setw( 10 ) << result.percentile( 0.99 )
+            << std::defaultfloat << std::endl;
+}
+
+void suite::write_json( std::ostream &stream ) const
+{
+  stream << "{\n  \"unit\": \"ns/op\",\n  \"results\": [";
+  for ( std::size_t index{ 0 }; index < _results.size(); ++index )
+  {
+    const auto &result{ _results[ index ] };
+    const auto &parameters{ result.parameters };
+    stream << ( index ? ",\n" : "\n" )
+           << "    { \"operation\": \"" << parameters.operation << "\", \"container\": \"" << parameters.container << "\", \"key_type\": \"" << parameters.key_type
+           << "\", \"size\": " << parameters.size << ", \"hit_ratio\": " << parameters.hit_ratio
+           << ", \"mean\": " << result.mean() << ", \"min\": " << result.percentile( 0 ) << ", \"p50\": " << result.percentile( 0.5 )
+           << ", \"p90\": " << result.percentile( 0.9 ) << ", \"p99\": " << result.percentile( 0.99 ) << ", \"max\": " << result.percentile( 1 ) << " }";
+  }
+  stream << "\n  ]\n}\n";
+}
+
+void suite::finish() const
+{
+  if ( _options.json_path.empty() )
+    return;
+
+  std::ofstream file{ _options.json_path };
+  if ( !file )
+    throw std::runtime_error{ "cannot write " + _options.json_path };
+  write_json( file );
+}
@@ -0,0 +1,116 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace select_n::bench_n
+{
+  //! Keep the compiler from optimizing away the computation of \c value .
+  template< typename T >
+  void do_not_optimize( const T &value )
+  {
+#if defined( __GNUC__ ) || defined( __clang__ )
+    asm volatile( "" : : "r,m"( value ) : "memory" );
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+  }
+
+  //! Parameters identifying a single benchmark.
+  struct case_t
+  {
+    std::string operation;
+    std::string container;
+    std::string key_type;
+    std::size_t size;
+    double hit_ratio;
+  };
+
+  //! Timings of a single benchmark, in nanoseconds per operation.
+  struct result_t
+  {
+    case_t parameters;
+    std::vector< double > samples;
+
+    //! Sample at quantile \c q , interpolating between neighbours.
+    double percentile( const double q ) const;
+    double mean() const;
+  };
+
+  //! Command line options of the benchmark driver.
+  struct options_t
+  {
+    std::size_t repetitions{ 15 };
+    std::chrono::nanoseconds min_sample_time{ std::chrono::milliseconds{ 5 } };
+    std::string filter;
+    std::string json_path;
+
+    //! Parse \c --repetitions N , \c --min-time-ms N , \c --filter TEXT and \c --json PATH .
+    static options_t parse( int argc, char **argv );
+  };
+
+  /*!
+    \brief Collection of benchmark results.
+
+    Each benchmark runs a batch of operations repeatedly, until the batch took at least \c min_sample_time .
+    This is one sample, and \c repetitions samples are taken, to report percentiles of the time per operation.
+  */
+  class suite
+  {
+  public:
+    explicit suite( options_t options ) : _options{ std::move( options ) } {}
+
+    //! Run \c batch , which does \c operations operations per call, and record its timings as \c parameters .
+    template< typename BATCH >
+    void run( const case_t &parameters, const std::size_t operations, BATCH &&batch )
+    {
+      if ( !selected( parameters ) )
+        return;
+
+      // Warm up caches and find the number of batches per sample.
+      std::size_t batches{ 1 };
+      while ( time( batch, batches ) < _options.min_sample_time )
+        batches *= 2;
+
+      result_t result{ parameters, {} };
+      for ( std::size_t repetition{ 0 }; repetition < _options.repetitions; ++repetition )
+        result.samples.push_back( static_cast< double >( time( batch, batches ).count() ) / static_cast< double >( batches * operations ) );
+      std::sort( result.samples.begin(), result.samples.end() );
+
+      print( result );
+      _results.push_back( std::move( result ) );
+    }
+
+    //! Write all results as a JSON document to \c stream .
+    void write_json( std::ostream &stream ) const;
+
+    //! Write the JSON document to the path given in the options, if any.
+    void finish() const;
+
+  private:
+    template< typename BATCH >
+    static std::chrono::nanoseconds time( BATCH &batch, const std::size_t batches )
+    {
+      const auto start{ std::chrono::steady_clock::now() };
+      for ( std::size_t i{ 0 }; i < batches; ++i )
+        batch();
+      return std::chrono::steady_clock::now() - start;
+    }
+
+    bool selected( const case_t &parameters ) const;
+    void print( const result_t &result );
+
+    options_t _options;
+    std::vector< result_t > _results;
+    bool _header_printed{ false };
+  };
+}
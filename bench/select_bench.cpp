@@ -0,0 +1,244 @@
+#include <array>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench_util.h"
+#include "select.h"
+#include "select_if.h"
+#include "select_many.h"
+#include "select_or_default.h"
+
+using namespace select_n;
+using bench_n::do_not_optimize;
+
+namespace
+{
+  //! Number of lookups per timed batch.
+  constexpr std::size_t lookups{ 1024 };
+
+  constexpr std::array< double, 3 > hit_ratios{ 0.0, 0.5, 1.0 };
+
+  //! Key \c index of a container. Missing keys use odd indices.
+  template< typename KEY >
+  KEY make_key( const std::size_t index )
+  {
+    if constexpr ( std::is_same_v< KEY, std::string > )
+      // Long enough to defeat the small string optimization.
+      return "select-benchmark-key-" + std::to_string( index );
+    else
+      return static_cast< KEY >( index );
+  }
+
+  template< typename KEY >
+  const char *key_name() { return std::is_same_v< KEY, std::string > ? "string" : "int"; }
+
+  //! Keys to look up in a container of \c size keys, hitting with probability \c hit_ratio .
+  template< typename KEY >
+  std::vector< KEY > make_lookups( const std::size_t size, const double hit_ratio )
+  {
+    std::mt19937_64 random{ 42 };
+    std::uniform_int_distribution< std::size_t > index{ 0, size - 1 };
+    std::bernoulli_distribution hit{ hit_ratio };
+
+    std::vector< KEY > keys;
+    for ( std::size_t i{ 0 }; i < lookups; ++i )
+      keys.push_back( make_key< KEY >( 2 * index( random ) + ( hit( random ) ? 0 : 1 ) ) );
+    return keys;
+  }
+
+  template< typename KEY, typename BATCH >
+  void run( bench_n::suite &suite, const char *operation, const char *container, const std::size_t size, const double hit_ratio, BATCH &&batch )
+  {
+    suite.run( { operation, container, key_name< KEY >(), size, hit_ratio }, lookups, std::forward< BATCH >( batch ) );
+  }
+
+  template< typename MAP >
+  void benchmarkMap( bench_n::suite &suite, const char *name, const std::size_t size )
+  {
+    using key_t = typename MAP::key_type;
+
+    MAP map;
+    for ( std::size_t i{ 0 }; i < size; ++i )
+      map.emplace( make_key< key_t >( 2 * i ), static_cast< int >( i ) );
+    const int def{ -1 };
+
+    for ( const auto hit_ratio : hit_ratios )
+    {
+      const auto keys{ make_lookups< key_t >( size, hit_ratio ) };
+
+      run< key_t >( suite, "select", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select( map, key ) ); } );
+      run< key_t >( suite, "select_or_default", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select_or_default( map, key, def ) ); } );
+      if ( size <= 1024 )
+        run< key_t >( suite, "select_if", name, size, hit_ratio, [ & ] {
+          for ( const auto &key : keys )
+            do_not_optimize( select_if( map, [ &key ]( const auto &entry ){ return entry.first == key; } ) );
+        } );
+
+      run< key_t >( suite, "baseline:find", name, size, hit_ratio, [ & ] {
+        for ( const auto &key : keys )
+        {
+          const auto entry{ map.find( key ) };
+          do_not_optimize( entry != map.end() ? &entry->second : nullptr );
+        }
+      } );
+      run< key_t >( suite, "baseline:at", name, size, hit_ratio, [ & ] {
+        for ( const auto &key : keys )
+          try { do_not_optimize( map.at( key ) ); } catch ( const std::out_of_range & ) { do_not_optimize( def ); }
+      } );
+      run< key_t >( suite, "baseline:count+at", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( map.count( key ) ? map.at( key ) : def ); } );
+    }
+  }
+
+  /*!
+    \brief Compare single and batched lookups of many distinct keys.
+
+    Unlike the other benchmarks, which repeat the same \c lookups keys, the keys here touch the whole map, so large maps actually miss the caches.
+  */
+  template< typename MAP >
+  void benchmarkBatch( bench_n::suite &suite, const char *name, const std::size_t size )
+  {
+    using key_t = typename MAP::key_type;
+    constexpr std::size_t batch_lookups{ 1 << 18 };
+
+    MAP map;
+    for ( std::size_t i{ 0 }; i < size; ++i )
+      map.emplace( make_key< key_t >( 2 * i ), static_cast< int >( i ) );
+    std::vector< const int * > results( batch_lookups );
+
+    for ( const auto hit_ratio : hit_ratios )
+    {
+      std::mt19937_64 random{ 42 };
+      std::uniform_int_distribution< std::size_t > index{ 0, size - 1 };
+      std::bernoulli_distribution hit{ hit_ratio };
+      std::vector< key_t > keys;
+      for ( std::size_t i{ 0 }; i < batch_lookups; ++i )
+        keys.push_back( make_key< key_t >( 2 * index( random ) + ( hit( random ) ? 0 : 1 ) ) );
+
+      suite.run( { "batch:select", name, key_name< key_t >(), size, hit_ratio }, batch_lookups, [ & ] {
+        auto out{ results.begin() };
+        for ( const auto &key : keys )
+          *out++ = select( map, key );
+        do_not_optimize( results.back() );
+      } );
+      suite.run( { "batch:select_many", name, key_name< key_t >(), size, hit_ratio }, batch_lookups, [ & ] {
+        select_many( map, keys, results.begin() );
+        do_not_optimize( results.back() );
+      } );
+    }
+  }
+
+  template< typename KEY >
+  void benchmarkSet( bench_n::suite &suite, const std::size_t size )
+  {
+    std::set< KEY > set;
+    for ( std::size_t i{ 0 }; i < size; ++i )
+      set.insert( make_key< KEY >( 2 * i ) );
+    const KEY def{};
+
+    for ( const auto hit_ratio : hit_ratios )
+    {
+      const auto keys{ make_lookups< KEY >( size, hit_ratio ) };
+
+      run< KEY >( suite, "select", "std::set", size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select( set, key ) ); } );
+      run< KEY >( suite, "select_or_default", "std::set", size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select_or_default( set, key, def ) ); } );
+      if ( size <= 1024 )
+        run< KEY >( suite, "select_if", "std::set", size, hit_ratio, [ & ] {
+          for ( const auto &key : keys )
+            do_not_optimize( select_if( set, [ &key ]( const KEY &value ){ return value == key; } ) );
+        } );
+
+      run< KEY >( suite, "baseline:find", "std::set", size, hit_ratio, [ & ] {
+        for ( const auto &key : keys )
+        {
+          const auto entry{ set.find( key ) };
+          do_not_optimize( entry != set.end() ? &*entry : nullptr );
+        }
+      } );
+      run< KEY >( suite, "baseline:count", "std::set", size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( set.count( key ) ); } );
+    }
+  }
+
+  template< typename KEY, typename CONTAINER >
+  void benchmarkSequence( bench_n::suite &suite, const char *name, CONTAINER &container )
+  {
+    const auto size{ container.size() };
+    for ( std::size_t i{ 0 }; i < size; ++i )
+      container[ i ] = make_key< KEY >( 2 * i );
+    const KEY def{};
+
+    for ( const auto hit_ratio : hit_ratios )
+    {
+      const auto keys{ make_lookups< KEY >( size, hit_ratio ) };
+
+      run< KEY >( suite, "select", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select( container, key ) ); } );
+      run< KEY >( suite, "select_or_default", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( select_or_default( container, key, def ) ); } );
+      run< KEY >( suite, "select_if", name, size, hit_ratio, [ & ] {
+        for ( const auto &key : keys )
+          do_not_optimize( select_if( container, [ &key ]( const KEY &value ){ return value == key; } ) );
+      } );
+
+      run< KEY >( suite, "baseline:find", name, size, hit_ratio, [ & ] {
+        for ( const auto &key : keys )
+        {
+          const auto entry{ std::find( container.begin(), container.end(), key ) };
+          do_not_optimize( entry != container.end() ? &*entry : nullptr );
+        }
+      } );
+      if constexpr ( detail_n::Unrollable< CONTAINER, KEY > && detail_n::SimdSearchable< CONTAINER, KEY > )
+        // The loop with an early exit, which the unrolled select replaces for small arrays.
+        run< KEY >( suite, "baseline:simd_find", name, size, hit_ratio, [ & ] { for ( const auto &key : keys ) do_not_optimize( detail_n::simd_find( container, key ) ); } );
+    }
+  }
+
+  template< typename KEY >
+  void benchmarkKeyType( bench_n::suite &suite )
+  {
+    for ( const std::size_t size : { 16, 1024, 16384 } )
+    {
+      benchmarkMap< std::map< KEY, int > >( suite, "std::map", size );
+      benchmarkMap< std::unordered_map< KEY, int > >( suite, "std::unordered_map", size );
+      benchmarkSet< KEY >( suite, size );
+
+      std::vector< KEY > vec( size );
+      benchmarkSequence< KEY >( suite, "std::vector", vec );
+    }
+
+    for ( const std::size_t size : { 16384, 1 << 20 } )
+    {
+      benchmarkBatch< std::map< KEY, int > >( suite, "std::map", size );
+      benchmarkBatch< std::unordered_map< KEY, int > >( suite, "std::unordered_map", size );
+    }
+
+    // Fixed sizes for arrays.
+    std::array< KEY, 8 > tiny{};
+    benchmarkSequence< KEY >( suite, "std::array", tiny );
+    std::array< KEY, 16 > small{};
+    benchmarkSequence< KEY >( suite, "std::array", small );
+    std::array< KEY, 1024 > large{};
+    benchmarkSequence< KEY >( suite, "std::array", large );
+  }
+}
+
+int main( int argc, char **argv )
+{
+  try
+  {
+    bench_n::suite suite{ bench_n::options_t::parse( argc, argv ) };
+
+    benchmarkKeyType< int >( suite );
+    benchmarkKeyType< std::string >( suite );
+
+    suite.finish();
+  }
+  catch ( const std::exception &error )
+  {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+}
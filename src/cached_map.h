@@ -0,0 +1,193 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <utility>
+
+#include "key_hash.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  //! Statistics of the lookup cache of a \c cached_map .
+  struct cache_stats
+  {
+    //! Lookups answered by the cache.
+    std::uint64_t hits;
+    //! Lookups, which had to search the map.
+    std::uint64_t misses;
+
+    //! Fraction of lookups answered by the cache.
+    double hit_rate() const noexcept { return hits + misses ? static_cast< double >( hits ) / static_cast< double >( hits + misses ) : 0.; }
+  };
+
+  namespace detail_n
+  {
+    //! Source of the ids of \c cached_map instances, which tag their entries in the thread local caches.
+    inline std::atomic< std::uint64_t > next_cache_owner{ 1 };
+  }
+
+  /*!
+    \brief Map wrapper, keeping a per thread cache of recently found entries in front of a \c MAP .
+
+    Each thread has a direct mapped cache of \c SLOTS entries, indexed by the hash of the key.
+    \c find checks the slot of a key first, and only searches the map if the slot holds no entry for the key.
+    So a hot key costs a hash and a few compares, instead of a tree walk or a hash table probe.
+    As \c cached_map is \c MapLike , \c select and \c select_or_default work on it as on \c MAP .
+
+    Each mutation increments a generation counter, which invalidates all cached entries of the map in all threads at once.
+    Concurrent lookups are safe, as long as the map is not mutated meanwhile, like for the standard maps.
+    \c EQUAL has to be consistent with the lookup of \c MAP , and \c HASH with \c EQUAL .
+    \c stats counts the lookups answered by the cache, in counters per thread.
+  */
+  template< typename MAP, std::size_t SLOTS = 64, typename HASH = key_hash< typename MAP::key_type >, typename EQUAL = std::equal_to<> >
+    requires ( std::has_single_bit( SLOTS ) )
+  class cached_map
+  {
+  public:
+    using map_type = MAP;
+    using key_type = typename MAP::key_type;
+    using mapped_type = typename MAP::mapped_type;
+    using value_type = typename MAP::value_type;
+    using size_type = typename MAP::size_type;
+    using iterator = typename MAP::iterator;
+    using const_iterator = typename MAP::const_iterator;
+
+    cached_map() = default;
+
+    explicit cached_map( MAP map, HASH hash = {}, EQUAL equal = {} ) : _map{ std::move( map ) }, _hash{ std::move( hash ) }, _equal{ std::move( equal ) } {}
+
+    cached_map( std::initializer_list< value_type > entries, HASH hash = {}, EQUAL equal = {} ) : cached_map( MAP( entries ), std::move( hash ), std::move( equal ) ) {}
+
+    //! A copy is a map of its own, so it does not share the cached entries of \c other .
+    cached_map( const cached_map &other ) : _map{ other._map }, _hash{ other._hash }, _equal{ other._equal } {}
+    cached_map( cached_map &&other ) noexcept : _map{ std::move( other._map ) }, _hash{ std::move( other._hash ) }, _equal{ std::move( other._equal ) } { other.invalidate(); }
+
+    cached_map &operator=( cached_map other ) noexcept
+    {
+      std::swap( _map, other._map );
+      std::swap( _hash, other._hash );
+      std::swap( _equal, other._equal );
+      invalidate();
+      return *this;
+    }
+
+    //! The wrapped map, for read access.
+    const MAP &map() const noexcept { return _map; }
+
+    iterator begin() noexcept { return _map.begin(); }
+    iterator end() noexcept { return _map.end(); }
+    const_iterator begin() const noexcept { return _map.begin(); }
+    const_iterator end() const noexcept { return _map.end(); }
+
+    size_type size() const noexcept { return _map.size(); }
+    bool empty() const noexcept { return _map.empty(); }
+
+    //! Find an entry for \c key , or return the end iterator. The map is only searched, if the cache of this thread has no entry for \c key .
+    template< typename OTHER >
+    iterator find( const OTHER &key ) { return find_cached( key ); }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return find_cached( key ); }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find( key ) != end(); }
+
+    template< typename... ARGS >
+    std::pair< iterator, bool > try_emplace( const key_type &key, ARGS &&... args )
+    {
+      invalidate();
+      return _map.try_emplace( key, std::forward< ARGS >( args )... );
+    }
+
+    std::pair< iterator, bool > insert( const value_type &entry ) { return try_emplace( entry.first, entry.second ); }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > insert_or_assign( const key_type &key, VALUE &&value )
+    {
+      invalidate();
+      return _map.insert_or_assign( key, std::forward< VALUE >( value ) );
+    }
+
+    mapped_type &operator[]( const key_type &key ) { return try_emplace( key ).first->second; }
+
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      invalidate();
+      return _map.erase( key );
+    }
+
+    void clear() noexcept
+    {
+      invalidate();
+      _map.clear();
+    }
+
+    //! Drop the cached entries of this map in all threads.
+    void invalidate() noexcept { _generation.fetch_add( 1, std::memory_order_release ); }
+
+    //! Statistics of the lookups so far.
+    cache_stats stats() const noexcept { return { _counters.sum( hits ), _counters.sum( misses ) }; }
+
+    void reset_stats() noexcept { _counters.reset(); }
+
+  private:
+    //! Indices of the \c striped_counters .
+    enum counter : std::size_t { hits, misses };
+
+    //! Cached entry, valid while its map has the same owner id and generation.
+    struct slot_t
+    {
+      std::uint64_t owner{ 0 };
+      std::uint64_t generation{ 0 };
+      iterator entry{};
+    };
+
+    //! The cache of the calling thread, shared by all maps of this type, which tag their slots by their owner id.
+    static std::array< slot_t, SLOTS > &cache() noexcept
+    {
+      static thread_local std::array< slot_t, SLOTS > slots{};
+      return slots;
+    }
+
+    template< typename OTHER >
+    iterator find_cached( const OTHER &key ) const
+    {
+      auto &slot{ cache()[ detail_n::mix( static_cast< std::uint64_t >( _hash( key ) ) ) & ( SLOTS - 1 ) ] };
+      const auto generation{ _generation.load( std::memory_order_acquire ) };
+      if ( slot.owner == _owner && slot.generation == generation && _equal( slot.entry->first, key ) )
+      {
+        // Cached -> no need to search the map.
+        _counters.increment( hits );
+        return slot.entry;
+      }
+
+      // The lookup does not change the map, but yields a mutable iterator, which the cache holds for both variants of find.
+      auto &map{ const_cast< MAP & >( _map ) };
+      _counters.increment( misses );
+      const auto entry{ map.find( key ) };
+      if ( entry != map.end() )
+        slot = { _owner, generation, entry };
+      return entry;
+    }
+
+    MAP _map;
+    HASH _hash;
+    EQUAL _equal;
+    const std::uint64_t _owner{ detail_n::next_cache_owner.fetch_add( 1, std::memory_order_relaxed ) };
+    //! On a cache line of its own, so a mutation does not evict the members readers load.
+    alignas( 64 ) std::atomic< std::uint64_t > _generation{ 1 };
+
+    //! Counted per thread, so hits stay free of contended writes.
+    mutable detail_n::striped_counters< 2 > _counters;
+  };
+}
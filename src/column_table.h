@@ -0,0 +1,383 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "select_all.h"
+#include "select_expression.h"
+#include "select_if.h"
+#include "select_stats.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Record and field type of a pointer to data member.
+    template< typename MEMBER >
+    struct member_traits;
+
+    template< typename RECORD, typename T >
+    struct member_traits< T RECORD::* >
+    {
+      using record = RECORD;
+      using type = T;
+    };
+
+    //! Record type of the pointer to data member \c MEMBER .
+    template< auto MEMBER >
+    using member_record_t = typename member_traits< decltype( MEMBER ) >::record;
+
+    //! Field type of the pointer to data member \c MEMBER .
+    template< auto MEMBER >
+    using member_type_t = typename member_traits< decltype( MEMBER ) >::type;
+
+    //! Record type of the first of the pointers to data members \c MEMBERS .
+    template< auto... MEMBERS >
+    using first_record_t = std::tuple_element_t< 0, std::tuple< member_record_t< MEMBERS >... > >;
+
+    //! Concept of the columns of a \c column_table : pointers to data members of one and the same record type.
+    template< auto... MEMBERS >
+    concept Columns = ( sizeof...( MEMBERS ) > 0 ) && ( std::is_member_object_pointer_v< decltype( MEMBERS ) > && ... ) && ( std::is_same_v< member_record_t< MEMBERS >, first_record_t< MEMBERS... > > && ... );
+
+    //! Whether \c A and \c B point to the same data member.
+    template< auto A, auto B >
+    constexpr bool same_member() noexcept
+    {
+      if constexpr ( std::is_same_v< decltype( A ), decltype( B ) > )
+        return A == B;
+      else
+        return false;
+    }
+  }
+
+  /*!
+    \brief Table of records, stored as structure of arrays.
+
+    Each of the data members \c MEMBERS of the record type is stored in a column of its own, i.e. a \c std::vector of the member's type.
+    Scans over one or two fields hence only touch the memory of those columns, and predicate expressions built from \c field
+    are evaluated by \c select_if and \c select_all in blocks of rows, column by column, which the compiler vectorizes.
+    Other predicates are called with a row proxy, which converts to the record type.
+  */
+  template< auto... MEMBERS > requires detail_n::Columns< MEMBERS... >
+  class column_table
+  {
+  public:
+    using record_type = detail_n::first_record_t< MEMBERS... >;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    //! Proxy for a row of the table. Its fields are accessed by \c get , and it converts to a record.
+    template< bool CONST >
+    class basic_row
+    {
+    public:
+      using table_type = detail_n::conditional_const_t< CONST, column_table >;
+
+      basic_row( table_type &table, const size_type index ) noexcept : _table{ &table }, _index{ index } {}
+
+      operator basic_row< true >() const noexcept { return { *_table, _index }; }
+
+      //! Reassemble the record of this row.
+      operator record_type() const { return ( *_table )[ _index ]; }
+
+      size_type index() const noexcept { return _index; }
+
+      //! The field of this row for the data member \c COLUMN , by reference.
+      template< auto COLUMN >
+      auto &get() const noexcept { return _table->template column< COLUMN >()[ _index ]; }
+
+    private:
+      table_type *_table;
+      size_type _index;
+    };
+
+    using row = basic_row< false >;
+    using const_row = basic_row< true >;
+
+    //! Forward iterator over the rows of a \c column_table .
+    template< bool CONST >
+    class basic_iterator
+    {
+    public:
+      using value_type = basic_row< CONST >;
+      using difference_type = std::ptrdiff_t;
+      using iterator_concept = std::forward_iterator_tag;
+
+      basic_iterator() = default;
+      basic_iterator( typename value_type::table_type &table, const size_type index ) noexcept : _table{ &table }, _index{ index } {}
+
+      value_type operator*() const noexcept { return { *_table, _index }; }
+
+      basic_iterator &operator++() noexcept { ++_index; return *this; }
+      basic_iterator operator++( int ) noexcept { auto previous{ *this }; ++_index; return previous; }
+
+      bool operator==( const basic_iterator &other ) const noexcept { return _index == other._index; }
+
+    private:
+      typename value_type::table_type *_table{ nullptr };
+      size_type _index{ 0 };
+    };
+
+    using iterator = basic_iterator< false >;
+    using const_iterator = basic_iterator< true >;
+
+    column_table() = default;
+
+    template< std::input_iterator ITERATOR >
+    column_table( ITERATOR first, ITERATOR last )
+    {
+      for ( ; first != last; ++first )
+        push_back( *first );
+    }
+
+    column_table( std::initializer_list< record_type > records ) : column_table( records.begin(), records.end() ) {}
+
+    iterator begin() noexcept { return { *this, 0 }; }
+    iterator end() noexcept { return { *this, size() }; }
+    const_iterator begin() const noexcept { return { *this, 0 }; }
+    const_iterator end() const noexcept { return { *this, size() }; }
+
+    size_type size() const noexcept { return std::get< 0 >( _columns ).size(); }
+    bool empty() const noexcept { return size() == 0; }
+
+    void reserve( const size_type capacity )
+    {
+      std::apply( [ capacity ]( auto &... columns ){ ( columns.reserve( capacity ), ... ); }, _columns );
+    }
+
+    void clear() noexcept
+    {
+      std::apply( []( auto &... columns ){ ( columns.clear(), ... ); }, _columns );
+    }
+
+    //! Append \c record , splitting it into the columns. If any field fails to copy, the table is left unchanged.
+    void push_back( const record_type &record )
+    {
+      const auto count{ size() };
+      try
+      {
+        std::apply( [ &record ]( auto &... columns ){ ( columns.push_back( record.*MEMBERS ), ... ); }, _columns );
+      }
+      catch ( ... )
+      {
+        // Drop the fields appended before the failure.
+        std::apply( [ count ]( auto &... columns ){ ( columns.erase( columns.begin() + static_cast< difference_type >( std::min( count, columns.size() ) ), columns.end() ), ... ); }, _columns );
+        throw;
+      }
+    }
+
+    //! Reassemble the record at \c index . Fields, which are not columns of the table, are value initialized.
+    record_type operator[]( const size_type index ) const
+    {
+      record_type record{};
+      ( ( record.*MEMBERS = column< MEMBERS >()[ index ] ), ... );
+      return record;
+    }
+
+    //! The column of the data member \c COLUMN .
+    template< auto COLUMN >
+    std::span< detail_n::member_type_t< COLUMN > > column() noexcept { return std::get< column_index< COLUMN >() >( _columns ); }
+
+    //! The column of the data member \c COLUMN .
+    template< auto COLUMN >
+    std::span< const detail_n::member_type_t< COLUMN > > column() const noexcept { return std::get< column_index< COLUMN >() >( _columns ); }
+
+    /*!
+      \brief The data of the column of \c member , as looked up at runtime.
+
+      This binds the fields of predicate expressions to the columns.
+      \throws std::invalid_argument if \c member is not a column of this table.
+    */
+    template< typename T >
+    const T *column_data( T record_type::*member ) const
+    {
+      const T *data{ nullptr };
+      bool found{ false };
+      const auto bind{ [ & ]< typename COLUMN >( const std::vector< COLUMN > &column, auto candidate )
+      {
+        if constexpr ( std::is_same_v< decltype( candidate ), T record_type::* > )
+          if ( candidate == member )
+          {
+            data = column.data();
+            found = true;
+          }
+      } };
+      std::apply( [ & ]( const auto &... columns ){ ( bind( columns, MEMBERS ), ... ); }, _columns );
+
+      if ( !found )
+        throw std::invalid_argument{ "column_table: field is not a column of the table" };
+      return data;
+    }
+
+  private:
+    //! Index of the column of the data member \c COLUMN .
+    template< auto COLUMN >
+    static constexpr std::size_t column_index() noexcept
+    {
+      constexpr bool matches[]{ detail_n::same_member< COLUMN, MEMBERS >()... };
+      static_assert( std::ranges::find( matches, true ) != std::ranges::end( matches ), "COLUMN is not a column of the table" );
+      return static_cast< std::size_t >( std::ranges::find( matches, true ) - std::ranges::begin( matches ) );
+    }
+
+    std::tuple< std::vector< detail_n::member_type_t< MEMBERS > >... > _columns;
+  };
+
+  namespace detail_n
+  {
+    /*!
+      \brief Find the index of the first row of \c table satisfying \c predicate , or the size of \c table if there is none.
+
+      Expressions are evaluated block by block on the columns, other predicates row by row.
+    */
+    template< typename TABLE, typename PREDICATE >
+    std::size_t table_find_index( const TABLE &table, const PREDICATE &predicate )
+    {
+      const auto size{ table.size() };
+      if constexpr ( Expression< PREDICATE > )
+      {
+        // Expression -> scan the columns block by block.
+        const auto bound{ predicate.bind( table ) };
+        for ( std::size_t first{ 0 }; first < size; first += scan_block_size )
+          if ( const auto mask{ bound.match( first, std::min( scan_block_size, size - first ) ) } )
+            return first + static_cast< std::size_t >( std::countr_zero( mask ) );
+      }
+      else
+      {
+        // Opaque predicate -> test row by row.
+        for ( std::size_t index{ 0 }; index < size; ++index )
+          if ( std::invoke( predicate, typename TABLE::const_row{ table, index } ) )
+            return index;
+      }
+      return size;
+    }
+
+    /*!
+      \brief Iterator over the rows of \c TABLE matching a bound expression.
+
+      The expression is evaluated for a block of rows at once, and the resulting mask is consumed bit by bit.
+      The next block is only evaluated when the current one has no more matches, so stopping early skips the remaining blocks.
+    */
+    template< typename TABLE, typename BOUND >
+    class match_iterator
+    {
+    public:
+      using value_type = typename std::remove_const_t< TABLE >::template basic_row< std::is_const_v< TABLE > >;
+      using difference_type = std::ptrdiff_t;
+      using iterator_concept = std::forward_iterator_tag;
+
+      match_iterator() = default;
+      match_iterator( TABLE &table, BOUND bound ) : _table{ &table }, _bound{ std::move( bound ) } { load( 0 ); }
+
+      value_type operator*() const noexcept { return { *_table, _first + static_cast< std::size_t >( std::countr_zero( _mask ) ) }; }
+
+      match_iterator &operator++() noexcept
+      {
+        // Drop the current match, and move on to the next block if it was the last one.
+        _mask &= _mask - 1;
+        if ( !_mask )
+          load( _first + scan_block_size );
+        return *this;
+      }
+
+      match_iterator operator++( int ) noexcept { auto previous{ *this }; ++*this; return previous; }
+
+      bool operator==( const match_iterator &other ) const noexcept { return _first == other._first && _mask == other._mask; }
+      bool operator==( std::default_sentinel_t ) const noexcept { return _mask == 0; }
+
+    private:
+      //! Evaluate the blocks from row \c first on, until one has a match.
+      void load( const std::size_t first ) noexcept
+      {
+        const auto size{ _table->size() };
+        for ( _first = first; _first < size; _first += scan_block_size )
+          if ( ( _mask = _bound.match( _first, std::min( scan_block_size, size - _first ) ) ) )
+            return;
+        _first = size;
+        _mask = 0;
+      }
+
+      TABLE *_table{ nullptr };
+      BOUND _bound{};
+      std::size_t _first{ 0 };
+      std::uint64_t _mask{ 0 };
+    };
+
+    //! View of all rows of \c table satisfying \c expression .
+    template< typename TABLE, typename EXPRESSION >
+    auto table_select_all( TABLE &table, const EXPRESSION &expression )
+    {
+      using iterator_t = match_iterator< TABLE, decltype( expression.bind( table ) ) >;
+      return std::ranges::subrange< iterator_t, std::default_sentinel_t >{ iterator_t{ table, expression.bind( table ) }, std::default_sentinel };
+    }
+  }
+
+  /*!
+    \brief Select the first row from a column table, which satisfies a predicate.
+
+    A predicate expression, as built from \c field , is evaluated on the columns in blocks of rows.
+    Any other predicate is called for each row proxy in turn, which converts to the record type.
+    The row is returned as proxy, or nothing is returned if no row matches.
+  */
+  template< auto... MEMBERS, typename PREDICATE >
+  std::optional< typename column_table< MEMBERS... >::row > select_if( column_table< MEMBERS... > &table, PREDICATE &&predicate SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_if" );
+    if ( const auto index{ detail_n::table_find_index( table, predicate ) }; index < table.size() )
+      // Row found -> return proxy.
+      return SELECT_N_HIT( std::optional{ typename column_table< MEMBERS... >::row( table, index ) } );
+    else
+      // Nothing found -> return nothing.
+      return SELECT_N_MISS( std::nullopt );
+  }
+
+  //! Select the first row from a constant column table, which satisfies a predicate.
+  template< auto... MEMBERS, typename PREDICATE >
+  std::optional< typename column_table< MEMBERS... >::const_row > select_if( const column_table< MEMBERS... > &table, PREDICATE &&predicate SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_if" );
+    if ( const auto index{ detail_n::table_find_index( table, predicate ) }; index < table.size() )
+      // Row found -> return proxy.
+      return SELECT_N_HIT( std::optional{ typename column_table< MEMBERS... >::const_row( table, index ) } );
+    else
+      // Nothing found -> return nothing.
+      return SELECT_N_MISS( std::nullopt );
+  }
+
+  /*!
+    \brief Select all rows from a column table, which satisfy a predicate expression.
+
+    The rows are provided as a lazy view of row proxies, which evaluates the expression on the columns one block of rows at a time.
+    Other predicates are handled by the general \c select_all .
+  */
+  template< auto... MEMBERS, detail_n::Expression EXPRESSION >
+  auto select_all( column_table< MEMBERS... > &table, EXPRESSION &&expression )
+  {
+    return detail_n::table_select_all( table, expression );
+  }
+
+  //! Select all rows from a constant column table, which satisfy a predicate expression.
+  template< auto... MEMBERS, detail_n::Expression EXPRESSION >
+  auto select_all( const column_table< MEMBERS... > &table, EXPRESSION &&expression )
+  {
+    return detail_n::table_select_all( table, expression );
+  }
+}
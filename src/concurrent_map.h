@@ -0,0 +1,315 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+#include "select_handle.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  /*!
+    \brief Hash map for concurrent readers and writers.
+
+    Keys are distributed over \c SHARDS shards, each a hash table of singly linked chains, with a mutex serializing its writers.
+    Readers take no locks: They traverse the chains while in an epoch critical section, so entries are only destroyed once no reader can see them anymore.
+    Thus, lookups write no shared memory, and read throughput scales with the number of cores while writers keep running.
+
+    Published entries are immutable. \c insert_or_assign replaces an entry by a new one, instead of assigning to it.
+    \c get and \c select return a \c select_handle , which keeps the entry alive until it is released.
+    There is deliberately no \c find member, so the pointer returning \c select overloads do not apply.
+  */
+  template< typename KEY, typename T, typename HASH = std::hash< KEY >, typename EQUAL = std::equal_to< KEY >, std::size_t SHARDS = 64 >
+    requires ( std::has_single_bit( SHARDS ) )
+  class concurrent_map
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = T;
+    using value_type = std::pair< const KEY, T >;
+    using size_type = std::size_t;
+    using hasher = HASH;
+    using key_equal = EQUAL;
+    using handle = select_handle< const T, detail_n::epoch_guard >;
+
+    explicit concurrent_map( HASH hash = {}, EQUAL equal = {} ) : _hash{ std::move( hash ) }, _equal{ std::move( equal ) }
+    {
+      for ( auto &shard : _shards )
+        shard.table.store( new table_t{ initial_buckets }, std::memory_order_relaxed );
+    }
+
+    concurrent_map( const concurrent_map & ) = delete;
+    concurrent_map &operator=( const concurrent_map & ) = delete;
+
+    //! No other thread may access the map anymore, so all entries are destroyed right away.
+    ~concurrent_map()
+    {
+      for ( auto &shard : _shards )
+      {
+        const std::unique_ptr< table_t > table{ shard.table.load( std::memory_order_relaxed ) };
+        destroy_chains( *table );
+      }
+    }
+
+    //! Number of entries. With concurrent writers, this is just a snapshot.
+    size_type size() const noexcept
+    {
+      size_type result{ 0 };
+      for ( const auto &shard : _shards )
+        result += shard.size.load( std::memory_order_relaxed );
+      return result;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    //! Find the value for \c key . The returned handle is empty, if \c key is missing.
+    handle get( const KEY &key ) const
+    {
+      const auto hash{ hash_of( key ) };
+      auto guard{ detail_n::epoch_guard::enter() };
+
+      const auto &table{ *shard_of( hash ).table.load( std::memory_order_acquire ) };
+      for ( auto *node{ table.bucket( hash ).load( std::memory_order_acquire ) }; node; node = node->next.load( std::memory_order_acquire ) )
+        if ( node->hash == hash && _equal( node->entry->first, key ) )
+          // Key exists -> keep the entry alive along with the handle.
+          return { std::move( guard ), &node->entry->second };
+
+      // Key missing -> leave the critical section right away.
+      return {};
+    }
+
+    bool contains( const KEY &key ) const { return static_cast< bool >( get( key ) ); }
+
+    //! Insert an entry constructed from \c args for \c key , unless \c key already exists. Returns whether the entry was inserted.
+    template< typename... ARGS >
+    bool try_emplace( const KEY &key, ARGS &&... args )
+    {
+      const auto hash{ hash_of( key ) };
+      auto &shard{ shard_of( hash ) };
+      const std::lock_guard lock{ shard.mutex };
+
+      auto &table{ *shard.table.load( std::memory_order_relaxed ) };
+      if ( find_link( table, hash, key ) )
+        return false;
+
+      insert( shard, hash, make_entry( key, std::forward< ARGS >( args )... ) );
+      return true;
+    }
+
+    //! Insert an entry for \c key , or replace the present one. Returns whether the entry was inserted.
+    template< typename VALUE >
+    bool insert_or_assign( const KEY &key, VALUE &&value )
+    {
+      const auto hash{ hash_of( key ) };
+      auto &shard{ shard_of( hash ) };
+      auto entry{ make_entry( key, std::forward< VALUE >( value ) ) };
+      const std::lock_guard lock{ shard.mutex };
+
+      auto &table{ *shard.table.load( std::memory_order_relaxed ) };
+      if ( auto *link{ find_link( table, hash, key ) } )
+      {
+        // Key exists -> replace the node, as readers may still use the old entry.
+        detail_n::epoch_domain::instance().reserve( 2 );
+        auto *old{ link->load( std::memory_order_relaxed ) };
+        link->store( new node_t{ hash, entry.release(), old->next.load( std::memory_order_relaxed ) }, std::memory_order_release );
+        retire( old );
+        return false;
+      }
+      else
+      {
+        insert( shard, hash, std::move( entry ) );
+        return true;
+      }
+    }
+
+    //! Remove the entry for \c key , and return the number of removed entries.
+    size_type erase( const KEY &key )
+    {
+      const auto hash{ hash_of( key ) };
+      auto &shard{ shard_of( hash ) };
+      const std::lock_guard lock{ shard.mutex };
+
+      if ( auto *link{ find_link( *shard.table.load( std::memory_order_relaxed ), hash, key ) } )
+      {
+        // Retiring must not fail, once the node is unlinked.
+        detail_n::epoch_domain::instance().reserve( 2 );
+        auto *old{ link->load( std::memory_order_relaxed ) };
+        link->store( old->next.load( std::memory_order_relaxed ), std::memory_order_release );
+        shard.size.fetch_sub( 1, std::memory_order_relaxed );
+        retire( old );
+        return 1;
+      }
+      else
+        return 0;
+    }
+
+    void clear()
+    {
+      for ( auto &shard : _shards )
+      {
+        const std::lock_guard lock{ shard.mutex };
+        auto &domain{ detail_n::epoch_domain::instance() };
+        auto empty{ std::make_unique< table_t >( initial_buckets ) };
+        domain.reserve( 2 * shard.size.load( std::memory_order_relaxed ) + 1 );
+
+        auto *old{ shard.table.exchange( empty.release(), std::memory_order_acq_rel ) };
+        shard.size.store( 0, std::memory_order_relaxed );
+
+        for ( auto &bucket : old->buckets )
+          for ( auto *node{ bucket.load( std::memory_order_relaxed ) }; node; )
+            retire( std::exchange( node, node->next.load( std::memory_order_relaxed ) ) );
+        domain.retire( old );
+      }
+    }
+
+  private:
+    static constexpr size_type initial_buckets{ 8 };
+
+    //! Link of a chain. Nodes refer to their entries, so growing a table does not copy entries.
+    struct node_t
+    {
+      std::uint64_t hash;
+      const value_type *entry;
+      std::atomic< node_t * > next;
+    };
+
+    struct table_t
+    {
+      explicit table_t( const size_type size ) : buckets( size ) {}
+
+      std::atomic< node_t * > &bucket( const std::uint64_t hash ) noexcept { return buckets[ hash & ( buckets.size() - 1 ) ]; }
+      const std::atomic< node_t * > &bucket( const std::uint64_t hash ) const noexcept { return buckets[ hash & ( buckets.size() - 1 ) ]; }
+
+      std::vector< std::atomic< node_t * > > buckets;
+    };
+
+    //! A shard on cache lines of its own, so writers of different shards do not interfere.
+    struct alignas( 64 ) shard_t
+    {
+      std::mutex mutex;
+      std::atomic< table_t * > table{ nullptr };
+      std::atomic< size_type > size{ 0 };
+    };
+
+    std::uint64_t hash_of( const KEY &key ) const { return detail_n::mix( static_cast< std::uint64_t >( _hash( key ) ) ); }
+
+    //! Shards are chosen by the high bits of the hash, buckets by the low bits.
+    shard_t &shard_of( const std::uint64_t hash ) const noexcept { return _shards[ SHARDS > 1 ? hash >> ( 64 - std::countr_zero( SHARDS ) ) : 0 ]; }
+
+    template< typename... ARGS >
+    static std::unique_ptr< const value_type > make_entry( const KEY &key, ARGS &&... args )
+    {
+      return std::make_unique< const value_type >( std::piecewise_construct, std::forward_as_tuple( key ), std::forward_as_tuple( std::forward< ARGS >( args )... ) );
+    }
+
+    //! The link pointing to the node for \c key , or \c nullptr if there is none. Must be called by the shard's writer.
+    std::atomic< node_t * > *find_link( table_t &table, const std::uint64_t hash, const KEY &key ) const
+    {
+      for ( auto *link{ &table.bucket( hash ) }; auto *node{ link->load( std::memory_order_relaxed ) }; link = &node->next )
+        if ( node->hash == hash && _equal( node->entry->first, key ) )
+          return link;
+      return nullptr;
+    }
+
+    //! Publish a node for \c entry , growing the table if needed. Must be called by the shard's writer.
+    static void insert( shard_t &shard, const std::uint64_t hash, std::unique_ptr< const value_type > entry )
+    {
+      auto *table{ shard.table.load( std::memory_order_relaxed ) };
+      if ( shard.size.load( std::memory_order_relaxed ) >= table->buckets.size() )
+        table = grow( shard, *table );
+
+      auto &bucket{ table->bucket( hash ) };
+      bucket.store( new node_t{ hash, entry.get(), bucket.load( std::memory_order_relaxed ) }, std::memory_order_release );
+      entry.release();
+      shard.size.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    //! Publish a table of twice the size with new chains to the same entries, and retire the old one.
+    static table_t *grow( shard_t &shard, table_t &old )
+    {
+      auto grown{ std::make_unique< table_t >( 2 * old.buckets.size() ) };
+      try
+      {
+        for ( auto &bucket : old.buckets )
+          for ( auto *node{ bucket.load( std::memory_order_relaxed ) }; node; node = node->next.load( std::memory_order_relaxed ) )
+          {
+            auto &target{ grown->bucket( node->hash ) };
+            target.store( new node_t{ node->hash, node->entry, target.load( std::memory_order_relaxed ) }, std::memory_order_relaxed );
+          }
+        // The old table holds a node per entry.
+        detail_n::epoch_domain::instance().reserve( shard.size.load( std::memory_order_relaxed ) + 1 );
+      }
+      catch ( ... )
+      {
+        destroy_nodes( *grown );
+        throw;
+      }
+
+      shard.table.store( grown.get(), std::memory_order_release );
+
+      // Readers may still traverse the old chains.
+      auto &domain{ detail_n::epoch_domain::instance() };
+      for ( auto &bucket : old.buckets )
+        for ( auto *node{ bucket.load( std::memory_order_relaxed ) }; node; )
+          domain.retire( std::exchange( node, node->next.load( std::memory_order_relaxed ) ) );
+      domain.retire( &old );
+      return grown.release();
+    }
+
+    //! Retire an unlinked node along with its entry. The node may be destroyed right away, if no reader can see it.
+    static void retire( node_t *node )
+    {
+      auto &domain{ detail_n::epoch_domain::instance() };
+      domain.retire( node->entry );
+      domain.retire( node );
+    }
+
+    //! Delete the nodes of \c table , but not their entries.
+    static void destroy_nodes( table_t &table ) noexcept
+    {
+      for ( auto &bucket : table.buckets )
+        for ( auto *node{ bucket.load( std::memory_order_relaxed ) }; node; )
+          delete std::exchange( node, node->next.load( std::memory_order_relaxed ) );
+    }
+
+    //! Delete the nodes of \c table , and their entries.
+    static void destroy_chains( table_t &table ) noexcept
+    {
+      for ( auto &bucket : table.buckets )
+        for ( auto *node{ bucket.load( std::memory_order_relaxed ) }; node; node = node->next.load( std::memory_order_relaxed ) )
+          delete node->entry;
+      destroy_nodes( table );
+    }
+
+    HASH _hash;
+    EQUAL _equal;
+    mutable std::array< shard_t, SHARDS > _shards;
+  };
+
+  /*!
+    \brief Select an entry from a \c concurrent_map .
+
+    Unlike the other \c select overloads, a \c select_handle is returned instead of a plain pointer, which keeps the entry alive while other threads modify \c map .
+    It tests and dereferences just like a pointer.
+  */
+  template< typename KEY, typename T, typename HASH, typename EQUAL, std::size_t SHARDS >
+  typename concurrent_map< KEY, T, HASH, EQUAL, SHARDS >::handle select( const concurrent_map< KEY, T, HASH, EQUAL, SHARDS > &map, const std::type_identity_t< KEY > &key )
+  {
+    return map.get( key );
+  }
+}
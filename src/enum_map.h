@@ -0,0 +1,283 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "select_util.h"
+
+namespace select_n
+{
+  /*!
+    \brief Number of enumerators of the enumeration \c E , i.e. the size of an \c enum_map over \c E .
+
+    By default, the value of an enumerator \c E::COUNT is taken, which has to follow all others.
+    For other enumerations, specialize this variable, or pass the size to \c enum_map explicitly.
+  */
+  template< typename E > requires std::is_enum_v< E >
+  inline constexpr std::size_t enum_size_v{ static_cast< std::size_t >( E::COUNT ) };
+
+  namespace detail_n
+  {
+    //! Maps enumerators to their underlying value. Negative values wrap around, and thus end up out of range.
+    template< typename E >
+    struct enum_index
+    {
+      constexpr std::size_t operator()( const E key ) const noexcept { return static_cast< std::size_t >( static_cast< std::underlying_type_t< E > >( key ) ); }
+    };
+
+    //! Maps integers to their distance from \c FIRST . Keys below \c FIRST wrap around, and thus end up out of range.
+    template< std::integral KEY, KEY FIRST >
+    struct offset_index
+    {
+      using unsigned_t = std::make_unsigned_t< KEY >;
+
+      constexpr std::size_t operator()( const KEY key ) const noexcept { return static_cast< std::size_t >( static_cast< unsigned_t >( static_cast< unsigned_t >( key ) - static_cast< unsigned_t >( FIRST ) ) ); }
+    };
+
+    /*!
+      \brief Map over the \c N keys indexed by \c INDEX , storing its entries in an inline array.
+
+      Each key has a fixed slot, and a bitmap tells which slots hold an entry.
+      So a lookup is a single bounds check and a bit test, and the map never allocates.
+      Iteration visits the entries in the order of their indices.
+    */
+    template< typename KEY, typename T, std::size_t N, typename INDEX >
+    class direct_map
+    {
+    public:
+      using key_type = KEY;
+      using mapped_type = T;
+      using value_type = std::pair< const KEY, T >;
+      using size_type = std::size_t;
+      using difference_type = std::ptrdiff_t;
+
+      //! Forward iterator over the present entries.
+      template< bool CONST >
+      class basic_iterator
+      {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = direct_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = conditional_const_t< CONST, value_type > &;
+        using pointer = conditional_const_t< CONST, value_type > *;
+
+        constexpr basic_iterator() = default;
+        constexpr basic_iterator( conditional_const_t< CONST, direct_map > *map, const size_type index ) noexcept : _map{ map }, _index{ index } {}
+
+        //! Allow conversion from mutable to const iterators.
+        constexpr operator basic_iterator< true >() const noexcept requires ( !CONST ) { return { _map, _index }; }
+
+        constexpr reference operator*() const noexcept { return _map->_slots[ _index ].value; }
+        constexpr pointer operator->() const noexcept { return &**this; }
+
+        constexpr basic_iterator &operator++() noexcept { _index = _map->next( _index + 1 ); return *this; }
+        constexpr basic_iterator operator++( int ) noexcept { auto old{ *this }; ++*this; return old; }
+
+        friend constexpr bool operator==( const basic_iterator &a, const basic_iterator &b ) noexcept { return a._index == b._index; }
+
+      private:
+        conditional_const_t< CONST, direct_map > *_map{ nullptr };
+        size_type _index{ N };
+      };
+
+      using iterator = basic_iterator< false >;
+      using const_iterator = basic_iterator< true >;
+
+      constexpr direct_map() noexcept = default;
+
+      //! Build the map from \c entries . For duplicate keys, the first entry is kept.
+      constexpr direct_map( std::initializer_list< std::pair< KEY, T > > entries ) : direct_map()
+      {
+        for ( const auto &entry : entries )
+          try_emplace( entry.first, entry.second );
+      }
+
+      constexpr direct_map( const direct_map &other ) : direct_map()
+      {
+        for ( const auto &entry : other )
+          try_emplace( entry.first, entry.second );
+      }
+
+      //! Move the entries of \c other , which is left empty.
+      constexpr direct_map( direct_map &&other ) noexcept( std::is_nothrow_move_constructible_v< T > ) : direct_map()
+      {
+        for ( auto &entry : other )
+          try_emplace( entry.first, std::move( entry.second ) );
+        other.clear();
+      }
+
+      constexpr direct_map &operator=( const direct_map &other )
+      {
+        if ( this != &other )
+        {
+          clear();
+          for ( const auto &entry : other )
+            try_emplace( entry.first, entry.second );
+        }
+        return *this;
+      }
+
+      constexpr direct_map &operator=( direct_map &&other ) noexcept( std::is_nothrow_move_constructible_v< T > )
+      {
+        if ( this != &other )
+        {
+          clear();
+          for ( auto &entry : other )
+            try_emplace( entry.first, std::move( entry.second ) );
+          other.clear();
+        }
+        return *this;
+      }
+
+      constexpr ~direct_map() { clear(); }
+
+      constexpr iterator begin() noexcept { return { this, next( 0 ) }; }
+      constexpr iterator end() noexcept { return { this, N }; }
+      constexpr const_iterator begin() const noexcept { return { this, next( 0 ) }; }
+      constexpr const_iterator end() const noexcept { return { this, N }; }
+
+      constexpr size_type size() const noexcept { return _size; }
+      constexpr bool empty() const noexcept { return _size == 0; }
+      static constexpr size_type max_size() noexcept { return N; }
+
+      //! Find the entry for \c key , or return the end iterator.
+      constexpr iterator find( const KEY &key ) noexcept { return { this, slot( key ) }; }
+      constexpr const_iterator find( const KEY &key ) const noexcept { return { this, slot( key ) }; }
+
+      constexpr bool contains( const KEY &key ) const noexcept { return slot( key ) < N; }
+
+      constexpr T &at( const KEY &key )
+      {
+        if ( const auto index{ slot( key ) }; index < N )
+          return _slots[ index ].value.second;
+        else
+          throw std::out_of_range{ "enum_map::at" };
+      }
+
+      constexpr const T &at( const KEY &key ) const
+      {
+        if ( const auto index{ slot( key ) }; index < N )
+          return _slots[ index ].value.second;
+        else
+          throw std::out_of_range{ "enum_map::at" };
+      }
+
+      //! Insert an entry constructed from \c args for \c key , unless \c key already exists. Throws \c std::out_of_range for keys outside the map's range.
+      template< typename... ARGS >
+      constexpr std::pair< iterator, bool > try_emplace( const KEY &key, ARGS &&... args )
+      {
+        const auto index{ INDEX{}( key ) };
+        if ( index >= N )
+          throw std::out_of_range{ "enum_map::try_emplace" };
+        if ( present( index ) )
+          return { { this, index }, false };
+
+        std::construct_at( &_slots[ index ].value, std::piecewise_construct, std::forward_as_tuple( key ), std::forward_as_tuple( std::forward< ARGS >( args )... ) );
+        _present[ index / word_bits ] |= std::uint64_t{ 1 } << ( index % word_bits );
+        ++_size;
+        return { { this, index }, true };
+      }
+
+      constexpr std::pair< iterator, bool > insert( std::pair< KEY, T > entry ) { return try_emplace( entry.first, std::move( entry.second ) ); }
+
+      constexpr T &operator[]( const KEY &key ) { return try_emplace( key ).first->second; }
+
+      //! Remove the entry for \c key , and return the number of removed entries.
+      constexpr size_type erase( const KEY &key ) noexcept
+      {
+        if ( const auto index{ slot( key ) }; index < N )
+        {
+          remove( index );
+          return 1;
+        }
+        else
+          return 0;
+      }
+
+      constexpr void clear() noexcept
+      {
+        for ( auto index{ next( 0 ) }; index < N; index = next( index + 1 ) )
+          remove( index );
+      }
+
+    private:
+      static constexpr size_type word_bits{ 64 };
+
+      //! Storage for a single entry, which is only constructed if the key is present.
+      union slot_t
+      {
+        constexpr slot_t() noexcept : empty{} {}
+        constexpr ~slot_t() {}
+
+        std::byte empty;
+        value_type value;
+      };
+
+      constexpr bool present( const size_type index ) const noexcept { return _present[ index / word_bits ] >> ( index % word_bits ) & 1; }
+
+      //! Slot of the entry for \c key , or \c N if there is none.
+      constexpr size_type slot( const KEY &key ) const noexcept
+      {
+        const auto index{ INDEX{}( key ) };
+        return index < N && present( index ) ? index : N;
+      }
+
+      //! First present slot at or after \c index , or \c N if there is none.
+      constexpr size_type next( size_type index ) const noexcept
+      {
+        while ( index < N )
+        {
+          if ( const auto word{ _present[ index / word_bits ] >> ( index % word_bits ) } )
+            return std::min( index + static_cast< size_type >( std::countr_zero( word ) ), N );
+          index = ( index / word_bits + 1 ) * word_bits;
+        }
+        return N;
+      }
+
+      constexpr void remove( const size_type index ) noexcept
+      {
+        std::destroy_at( &_slots[ index ].value );
+        _present[ index / word_bits ] &= ~( std::uint64_t{ 1 } << ( index % word_bits ) );
+        --_size;
+      }
+
+      std::array< slot_t, N > _slots{};
+      std::array< std::uint64_t, ( N + word_bits - 1 ) / word_bits > _present{};
+      size_type _size{ 0 };
+    };
+  }
+
+  /*!
+    \brief Map over the enumerators of \c E , storing its entries in an inline array.
+
+    Keys are used as indices, so they have to be the enumerators from zero up to \c N , exclusively.
+    A lookup is a single bounds check and a bit test, and the map never allocates.
+    By default, \c N is \c enum_size_v<E> .
+  */
+  template< typename E, typename T, std::size_t N = enum_size_v< E > > requires std::is_enum_v< E >
+  using enum_map = detail_n::direct_map< E, T, N, detail_n::enum_index< E > >;
+
+  /*!
+    \brief Map over the integers from \c FIRST to \c LAST , inclusively, storing its entries in an inline array.
+
+    Like \c enum_map , a lookup is a single bounds check and a bit test, and the map never allocates.
+  */
+  template< typename T, auto FIRST, decltype( FIRST ) LAST > requires ( std::integral< decltype( FIRST ) > && FIRST <= LAST )
+  using int_map = detail_n::direct_map< decltype( FIRST ), T, static_cast< std::size_t >( LAST - FIRST ) + 1, detail_n::offset_index< decltype( FIRST ), FIRST > >;
+}
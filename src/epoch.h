@@ -0,0 +1,329 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace select_n::detail_n
+{
+  /*!
+    \brief Epoch based reclamation of objects shared with concurrent readers.
+
+    Readers enter a critical section by announcing the current global epoch in a record of their own thread.
+    Writers unlink objects from shared structures, and retire them with the epoch of the unlinking.
+    The global epoch only advances once all threads in a critical section announced it, so an object retired in epoch \c e is unreachable for all readers once the epoch reached \c e+2 , and is destroyed then.
+
+    Reading takes no locks and writes no shared cache lines, so it scales with the number of threads.
+  */
+  class epoch_domain
+  {
+  public:
+    //! Retired objects of a thread are reclaimed whenever this many accumulated.
+    static constexpr std::size_t reclaim_threshold{ 64 };
+
+    static epoch_domain &instance()
+    {
+      static epoch_domain domain;
+      return domain;
+    }
+
+    epoch_domain( const epoch_domain & ) = delete;
+    epoch_domain &operator=( const epoch_domain & ) = delete;
+
+    ~epoch_domain()
+    {
+      for ( const auto &object : _orphans )
+        object.destroy( object.object );
+
+      for ( auto *record{ _records.load() }; record; )
+        delete std::exchange( record, record->next );
+    }
+
+    //! Set up the state of the current thread, so that \c reclaim on it does not throw afterwards. The first call of a thread allocates its record, which may throw.
+    void attach()
+    {
+      local();
+    }
+
+    //! Enter a critical section of the current thread. Sections may be nested. The first call of a thread allocates its record, which may throw.
+    void enter()
+    {
+      auto &state{ local() };
+      if ( state.depth++ == 0 )
+      {
+        state.record->announced.store( _epoch.load( std::memory_order_relaxed ), std::memory_order_release );
+        // Order the announcement before all reads of shared pointers.
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+      }
+    }
+
+    //! Leave a critical section of the current thread.
+    void leave() noexcept
+    {
+      auto &state{ local() };
+      if ( --state.depth == 0 )
+        state.record->announced.store( 0, std::memory_order_release );
+    }
+
+    /*!
+      \brief Make room for retiring \c count more objects on the current thread.
+
+      The next \c count calls of \c retire on this thread do not throw then.
+      So writers reserve before unlinking, and a failed allocation leaves their structure unchanged.
+      Room for handing the objects over when the thread exits is reserved as well, so that cannot fail.
+    */
+    void reserve( const std::size_t count )
+    {
+      auto &state{ local() };
+      const auto needed{ state.retired.size() + count };
+      if ( needed > state.orphan_room )
+      {
+        const std::lock_guard lock{ _orphan_mutex };
+        const auto room{ std::max( needed, 2 * state.orphan_room ) };
+        make_room( room - state.orphan_room );
+        _thread_reserved += room - state.orphan_room;
+        state.orphan_room = room;
+      }
+      if ( needed > state.retired.capacity() )
+        state.retired.reserve( std::max( needed, 2 * state.retired.capacity() ) );
+    }
+
+    //! Destroy \c object by \c destroy , once no reader can reach it anymore. It has to be unlinked already. Throws only, if no room was reserved for it.
+    void retire( void *object, void ( *destroy )( void * ) )
+    {
+      // Order the unlinking before reading the epoch.
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+
+      reserve( 1 );
+      auto &state{ local() };
+      state.retired.push_back( { object, destroy, _epoch.load( std::memory_order_relaxed ) } );
+      if ( state.retired.size() >= reclaim_threshold )
+        reclaim();
+    }
+
+    //! Destroy \c object by \c delete , once no reader can reach it anymore.
+    template< typename T >
+    void retire( T *object )
+    {
+      retire( const_cast< std::remove_const_t< T > * >( object ), []( void *pointer ){ delete static_cast< T * >( pointer ); } );
+    }
+
+    //! Make room for retiring \c count more objects by \c retire_shared , so those calls do not throw.
+    void reserve_shared( const std::size_t count )
+    {
+      const std::lock_guard lock{ _orphan_mutex };
+      make_room( count );
+      _shared_reserved += count;
+    }
+
+    /*!
+      \brief Like \c retire , but hand \c object to the list shared by all threads, rather than keeping it with the current thread.
+
+      So the next \c reclaim on any thread destroys it, once no reader can reach it anymore. This suits rarely retired, large objects.
+      Throws only, if no room was reserved for it by \c reserve_shared .
+    */
+    void retire_shared( void *object, void ( *destroy )( void * ) )
+    {
+      // Order the unlinking before reading the epoch.
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+
+      const std::lock_guard lock{ _orphan_mutex };
+      if ( _shared_reserved > 0 )
+        --_shared_reserved;
+      else
+        make_room( 1 );
+      _orphans.push_back( { object, destroy, _epoch.load( std::memory_order_relaxed ) } );
+    }
+
+    //! Destroy \c object by \c delete , once no reader can reach it anymore, on whichever thread reclaims next.
+    template< typename T >
+    void retire_shared( T *object )
+    {
+      retire_shared( const_cast< std::remove_const_t< T > * >( object ), []( void *pointer ){ delete static_cast< T * >( pointer ); } );
+    }
+
+    //! Try to advance the epoch, and destroy the retired objects of the current thread, and those handed to all threads, which are unreachable.
+    void reclaim()
+    {
+      try_advance();
+      try_advance();
+
+      const auto epoch{ _epoch.load( std::memory_order_acquire ) };
+      const auto safe{ [ epoch ]( const retired_object &object ){ return object.epoch + 2 <= epoch; } };
+
+      auto &state{ local() };
+      destroy_if( state.retired, safe );
+
+      if ( const std::unique_lock lock{ _orphan_mutex, std::try_to_lock }; lock )
+        destroy_if( _orphans, safe );
+    }
+
+  private:
+    struct retired_object
+    {
+      void *object;
+      void ( *destroy )( void * );
+      std::uint64_t epoch;
+    };
+
+    //! Announcement of a thread, on a cache line of its own.
+    struct alignas( 64 ) thread_record
+    {
+      std::atomic< std::uint64_t > announced{ 0 };
+      std::atomic< bool > owned{ true };
+      thread_record *next{ nullptr };
+    };
+
+    /*!
+      \brief State of the current thread. Its record is released, and its retired objects are handed over, when the thread exits.
+
+      \c reserve keeps room in the orphans for all retired objects, so handing them over does not allocate, and cannot fail.
+    */
+    struct thread_state
+    {
+      thread_record *record{ nullptr };
+      std::size_t depth{ 0 };
+      std::vector< retired_object > retired;
+      //! Room in the orphans, which is reserved for \c retired . It is never less than the size of \c retired .
+      std::size_t orphan_room{ 0 };
+
+      explicit thread_state( epoch_domain &domain ) : record{ domain.acquire_record() } {}
+
+      ~thread_state()
+      {
+        auto &domain{ instance() };
+        {
+          const std::lock_guard lock{ domain._orphan_mutex };
+          assert( retired.size() <= orphan_room && domain._orphans.size() + retired.size() <= domain._orphans.capacity() );
+          domain._orphans.insert( domain._orphans.end(), retired.begin(), retired.end() );
+          domain._thread_reserved -= orphan_room;
+        }
+        record->owned.store( false, std::memory_order_release );
+      }
+    };
+
+    epoch_domain() = default;
+
+    thread_state &local()
+    {
+      thread_local thread_state state{ *this };
+      return state;
+    }
+
+    //! Reuse the record of an exited thread, or add a new one.
+    thread_record *acquire_record()
+    {
+      for ( auto *current{ _records.load( std::memory_order_acquire ) }; current; current = current->next )
+        if ( bool owned{ false }; current->owned.compare_exchange_strong( owned, true, std::memory_order_acquire ) )
+          return current;
+
+      auto *added{ new thread_record };
+      added->next = _records.load( std::memory_order_relaxed );
+      while ( !_records.compare_exchange_weak( added->next, added, std::memory_order_release, std::memory_order_relaxed ) ) {}
+      return added;
+    }
+
+    //! Advance the epoch, if all threads in a critical section announced it.
+    void try_advance() noexcept
+    {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+
+      auto epoch{ _epoch.load( std::memory_order_relaxed ) };
+      for ( auto *current{ _records.load( std::memory_order_acquire ) }; current; current = current->next )
+        if ( const auto announced{ current->announced.load( std::memory_order_acquire ) }; announced != 0 && announced != epoch )
+          return;
+
+      _epoch.compare_exchange_strong( epoch, epoch + 1, std::memory_order_acq_rel );
+    }
+
+    //! Make room for \c count more orphans, besides the reserved ones. The caller has to hold \c _orphan_mutex .
+    void make_room( const std::size_t count )
+    {
+      if ( const auto needed{ _orphans.size() + _shared_reserved + _thread_reserved + count }; needed > _orphans.capacity() )
+        _orphans.reserve( std::max( needed, 2 * _orphans.capacity() ) );
+    }
+
+    template< typename PREDICATE >
+    static void destroy_if( std::vector< retired_object > &objects, const PREDICATE &predicate )
+    {
+      const auto kept{ std::partition( objects.begin(), objects.end(), [ &predicate ]( const retired_object &object ){ return !predicate( object ); } ) };
+      for ( auto object{ kept }; object != objects.end(); ++object )
+        object->destroy( object->object );
+      objects.erase( kept, objects.end() );
+    }
+
+    //! Zero marks threads outside of critical sections, so the epoch starts at one.
+    std::atomic< std::uint64_t > _epoch{ 1 };
+    std::atomic< thread_record * > _records{ nullptr };
+
+    //! Objects of exited threads, and those retired by \c retire_shared .
+    std::mutex _orphan_mutex;
+    std::vector< retired_object > _orphans;
+    //! Room in \c _orphans , which is reserved for calls of \c retire_shared .
+    std::size_t _shared_reserved{ 0 };
+    //! Room in \c _orphans , which is reserved for the retired objects of running threads.
+    std::size_t _thread_reserved{ 0 };
+  };
+
+  /*!
+    \brief Keeps the current thread in a critical section of the \c epoch_domain , while it exists.
+
+    The critical section belongs to the thread, which entered it.
+    So a guard may be moved, but has to be released or destroyed on that thread.
+  */
+  class epoch_guard
+  {
+  public:
+    //! Guard that is not in a critical section.
+    epoch_guard() noexcept = default;
+
+    //! Enter a critical section of the current thread.
+    static epoch_guard enter()
+    {
+      epoch_domain::instance().enter();
+      return epoch_guard{ std::this_thread::get_id() };
+    }
+
+    epoch_guard( epoch_guard &&other ) noexcept : _owner{ std::exchange( other._owner, {} ) } {}
+
+    epoch_guard &operator=( epoch_guard &&other ) noexcept
+    {
+      if ( this != &other )
+      {
+        release();
+        _owner = std::exchange( other._owner, {} );
+      }
+      return *this;
+    }
+
+    ~epoch_guard() { release(); }
+
+    //! Leave the critical section early.
+    void release() noexcept
+    {
+      if ( const auto owner{ std::exchange( _owner, {} ) }; owner != std::thread::id{} )
+      {
+        // Leaving on another thread would unbalance the sections of both threads.
+        assert( owner == std::this_thread::get_id() );
+        epoch_domain::instance().leave();
+      }
+    }
+
+  private:
+    explicit epoch_guard( const std::thread::id owner ) noexcept : _owner{ owner } {}
+
+    //! Thread in the critical section, or no thread for an inactive guard.
+    std::thread::id _owner{};
+  };
+}
@@ -0,0 +1,313 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "key_hash.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  //! Default hash of \c filtered_map . Strings are hashed as \c std::string_view , so a map with string keys can be queried by any string like type.
+  template< typename KEY >
+  using filter_hash = key_hash< KEY >;
+
+  //! Statistics of the filter of a \c filtered_map .
+  struct filter_stats
+  {
+    //! Lookups of missing keys, answered by the filter alone.
+    std::uint64_t filtered;
+    //! Lookups of missing keys, which passed the filter, and had to search the map.
+    std::uint64_t false_positives;
+
+    //! Fraction of lookups of missing keys, which were not answered by the filter.
+    double false_positive_rate() const noexcept { return filtered + false_positives ? static_cast< double >( false_positives ) / static_cast< double >( filtered + false_positives ) : 0.; }
+  };
+
+  namespace detail_n
+  {
+    /*!
+      \brief Blocked Bloom filter over 64 bit hashes.
+
+      Each hash selects one block of 256 bits, i.e. 32 bytes within a single cache line, and sets one bit in each of its eight words.
+      A query thus touches a single block, with no dependent memory accesses.
+      With 10 bits per key, about 1% of the queries for missing keys pass the filter.
+    */
+    class blocked_bloom_filter
+    {
+    public:
+      static constexpr std::size_t default_bits_per_key{ 10 };
+
+      blocked_bloom_filter() = default;
+
+      //! Filter sized for \c capacity keys.
+      explicit blocked_bloom_filter( const std::size_t capacity, const std::size_t bits_per_key = default_bits_per_key )
+        : _blocks( std::max< std::size_t >( 1, ( capacity * bits_per_key + block_bits - 1 ) / block_bits ) ), _capacity{ capacity } {}
+
+      blocked_bloom_filter( const blocked_bloom_filter & ) = default;
+      //! Leaves \c other without blocks and with no capacity, so it is rebuilt before its next insertion.
+      blocked_bloom_filter( blocked_bloom_filter &&other ) noexcept : _blocks{ std::move( other._blocks ) }, _capacity{ std::exchange( other._capacity, 0 ) } { other._blocks.clear(); }
+
+      blocked_bloom_filter &operator=( const blocked_bloom_filter & ) = default;
+      blocked_bloom_filter &operator=( blocked_bloom_filter &&other ) noexcept
+      {
+        _blocks = std::move( other._blocks );
+        other._blocks.clear();
+        _capacity = std::exchange( other._capacity, 0 );
+        return *this;
+      }
+
+      //! Number of keys the filter was sized for.
+      std::size_t capacity() const noexcept { return _capacity; }
+
+      void insert( const std::uint64_t hash ) noexcept
+      {
+        auto &block{ block_of( hash ) };
+        const auto bits{ mask( hash ) };
+        for ( std::size_t word{ 0 }; word < words; ++word )
+          block[ word ] |= bits[ word ];
+      }
+
+      bool may_contain( const std::uint64_t hash ) const noexcept
+      {
+        if ( _blocks.empty() )
+          return false;
+
+        const auto &block{ block_of( hash ) };
+        const auto bits{ mask( hash ) };
+        bool result{ true };
+        for ( std::size_t word{ 0 }; word < words; ++word )
+          result &= ( block[ word ] & bits[ word ] ) == bits[ word ];
+        return result;
+      }
+
+      void clear() noexcept { std::fill( _blocks.begin(), _blocks.end(), aligned_block_t{} ); }
+
+    private:
+      static constexpr std::size_t words{ 8 };
+      static constexpr std::size_t block_bits{ words * 32 };
+
+      //! Odd multipliers, deriving a bit position per word from a hash.
+      static constexpr std::array< std::uint32_t, words > salts{ 0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u };
+
+      using block_t = std::array< std::uint32_t, words >;
+      struct alignas( 32 ) aligned_block_t : block_t {};
+
+      //! The high half of the hash selects the block, by a multiplication instead of a modulo.
+      block_t &block_of( const std::uint64_t hash ) noexcept { return _blocks[ ( ( hash >> 32 ) * _blocks.size() ) >> 32 ]; }
+      const block_t &block_of( const std::uint64_t hash ) const noexcept { return _blocks[ ( ( hash >> 32 ) * _blocks.size() ) >> 32 ]; }
+
+      //! The low half of the hash selects a bit per word.
+      static block_t mask( const std::uint64_t hash ) noexcept
+      {
+        block_t result;
+        for ( std::size_t word{ 0 }; word < words; ++word )
+          result[ word ] = std::uint32_t{ 1 } << ( ( static_cast< std::uint32_t >( hash ) * salts[ word ] ) >> 27 );
+        return result;
+      }
+
+      std::vector< aligned_block_t > _blocks;
+      std::size_t _capacity{ 0 };
+    };
+  }
+
+  /*!
+    \brief Map wrapper, keeping a Bloom filter over the keys in front of a \c MAP .
+
+    \c find consults the filter first, and only searches the map if the key may be present.
+    So most lookups of missing keys are answered without touching the map, while lookups of present keys cost a filter query more.
+    As \c filtered_map is \c MapLike , \c select and \c select_or_default work on it as on \c MAP .
+
+    The filter is updated on insertion, and rebuilt when the map outgrows it, or after many erasures, which a Bloom filter cannot forget.
+    \c stats counts the lookups of missing keys, and how many of them passed the filter.
+  */
+  template< typename MAP, typename HASH = filter_hash< typename MAP::key_type > >
+  class filtered_map
+  {
+  public:
+    using map_type = MAP;
+    using key_type = typename MAP::key_type;
+    using mapped_type = typename MAP::mapped_type;
+    using value_type = typename MAP::value_type;
+    using size_type = typename MAP::size_type;
+    using iterator = typename MAP::iterator;
+    using const_iterator = typename MAP::const_iterator;
+
+    filtered_map() = default;
+
+    //! Wrap \c map , building the filter once for all its keys.
+    explicit filtered_map( MAP map, HASH hash = {} ) : _map{ std::move( map ) }, _hash{ std::move( hash ) } { rebuild(); }
+
+    filtered_map( std::initializer_list< value_type > entries, HASH hash = {} ) : filtered_map( MAP( entries ), std::move( hash ) ) {}
+
+    filtered_map( const filtered_map &other ) : _map{ other._map }, _hash{ other._hash }, _filter{ other._filter }, _stale{ other._stale } {}
+    filtered_map( filtered_map &&other ) noexcept : _map{ std::move( other._map ) }, _hash{ std::move( other._hash ) }, _filter{ std::move( other._filter ) }, _stale{ std::exchange( other._stale, 0 ) } {}
+
+    filtered_map &operator=( filtered_map other ) noexcept
+    {
+      std::swap( _map, other._map );
+      std::swap( _hash, other._hash );
+      std::swap( _filter, other._filter );
+      std::swap( _stale, other._stale );
+      return *this;
+    }
+
+    //! The wrapped map, for read access.
+    const MAP &map() const noexcept { return _map; }
+
+    iterator begin() noexcept { return _map.begin(); }
+    iterator end() noexcept { return _map.end(); }
+    const_iterator begin() const noexcept { return _map.begin(); }
+    const_iterator end() const noexcept { return _map.end(); }
+
+    size_type size() const noexcept { return _map.size(); }
+    bool empty() const noexcept { return _map.empty(); }
+
+    //! Find an entry for \c key , or return the end iterator. The map is only searched, if the filter may contain \c key .
+    template< typename OTHER >
+    iterator find( const OTHER &key ) { return find_in( _map, key ); }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return find_in( _map, key ); }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find( key ) != end(); }
+
+    //! Insert an entry constructed from \c args for \c key , unless \c key already exists.
+    template< typename... ARGS >
+    std::pair< iterator, bool > try_emplace( const key_type &key, ARGS &&... args )
+    {
+      const auto hash{ hash_of( key ) };
+      const auto result{ _map.try_emplace( key, std::forward< ARGS >( args )... ) };
+      if ( result.second )
+        added( key, hash );
+      return result;
+    }
+
+    std::pair< iterator, bool > insert( const value_type &entry ) { return try_emplace( entry.first, entry.second ); }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > insert_or_assign( const key_type &key, VALUE &&value )
+    {
+      const auto hash{ hash_of( key ) };
+      const auto result{ _map.insert_or_assign( key, std::forward< VALUE >( value ) ) };
+      if ( result.second )
+        added( key, hash );
+      return result;
+    }
+
+    mapped_type &operator[]( const key_type &key ) { return try_emplace( key ).first->second; }
+
+    /*!
+      \brief Remove the entry for \c key . Its bits stay in the filter until the next rebuild.
+
+      The entry is gone once the map erased it, so a failed rebuild keeps the old filter, which only gets more false positives, and is retried by the next erasure.
+    */
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      const auto removed{ _map.erase( key ) };
+      _stale += removed;
+      if ( _stale > _map.size() && _stale > minimum_capacity )
+        try
+        {
+          // Mostly stale bits -> too many false positives.
+          rebuild();
+        }
+        catch ( ... ) {}
+      return removed;
+    }
+
+    void clear() noexcept
+    {
+      _map.clear();
+      _filter.clear();
+      _stale = 0;
+    }
+
+    //! Rebuild the filter from the present keys, e.g. after a bulk load or many erasures.
+    void rebuild()
+    {
+      detail_n::blocked_bloom_filter filter{ std::max( 2 * _map.size(), minimum_capacity ) };
+      for ( const auto &entry : _map )
+        filter.insert( hash_of( entry.first ) );
+      _filter = std::move( filter );
+      _stale = 0;
+    }
+
+    //! Statistics of the lookups so far.
+    filter_stats stats() const noexcept { return { _counters.sum( filtered ), _counters.sum( false_positives ) }; }
+
+    void reset_stats() noexcept { _counters.reset(); }
+
+  private:
+    static constexpr size_type minimum_capacity{ 64 };
+
+    //! Indices of the \c striped_counters .
+    enum counter : std::size_t { filtered, false_positives };
+
+    template< typename OTHER >
+    std::uint64_t hash_of( const OTHER &key ) const { return detail_n::mix( static_cast< std::uint64_t >( _hash( key ) ) ); }
+
+    template< typename SELF_MAP, typename OTHER >
+    auto find_in( SELF_MAP &map, const OTHER &key ) const -> decltype( map.find( key ) )
+    {
+      if ( !_filter.may_contain( hash_of( key ) ) )
+      {
+        // Surely missing -> answer from the filter.
+        _counters.increment( filtered );
+        return map.end();
+      }
+
+      const auto entry{ map.find( key ) };
+      if ( entry == map.end() )
+        _counters.increment( false_positives );
+      return entry;
+    }
+
+    /*!
+      \brief Add the new \c key of the map with its \c hash to the filter.
+
+      A present key must never be missing from the filter, as \c find would not find it.
+      So if resizing the filter fails, the key is added to the old filter, which just gets more false positives.
+      Only without a filter to fall back on, the key is erased from the map again.
+    */
+    void added( const key_type &key, const std::uint64_t hash )
+    {
+      if ( _map.size() + _stale > _filter.capacity() )
+        try
+        {
+          // Outgrown -> resize, which includes the new key.
+          rebuild();
+          return;
+        }
+        catch ( ... )
+        {
+          if ( _filter.capacity() == 0 )
+          {
+            _map.erase( key );
+            throw;
+          }
+        }
+      _filter.insert( hash );
+    }
+
+    MAP _map;
+    HASH _hash;
+    detail_n::blocked_bloom_filter _filter;
+    size_type _stale{ 0 };
+
+    //! Counted per thread, so concurrent readers do not contend on them.
+    mutable detail_n::striped_counters< 2 > _counters;
+  };
+}
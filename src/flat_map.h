@@ -0,0 +1,372 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "select_sorted.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    /*!
+      \brief Sort \c keys with respect to \c compare and drop duplicates, keeping the first occurrence.
+
+      The permutation of the remaining keys is returned, such that entries associated to the keys can be rearranged accordingly.
+    */
+    template< typename KEY, typename COMPARE >
+    std::vector< std::size_t > sort_unique_permutation( const std::vector< KEY > &keys, const COMPARE &compare )
+    {
+      std::vector< std::size_t > order( keys.size() );
+      std::iota( order.begin(), order.end(), std::size_t{ 0 } );
+
+      // Sort indices instead of keys, so the keys are moved only once afterwards.
+      std::stable_sort( order.begin(), order.end(), [ & ]( const std::size_t a, const std::size_t b ){ return compare( keys[ a ], keys[ b ] ); } );
+      order.erase( std::unique( order.begin(), order.end(), [ & ]( const std::size_t a, const std::size_t b ){ return !compare( keys[ a ], keys[ b ] ); } ), order.end() );
+
+      return order;
+    }
+
+    //! Rearrange \c values according to \c order , as returned by \c sort_unique_permutation .
+    template< typename T >
+    std::vector< T > apply_permutation( std::vector< T > &&values, const std::vector< std::size_t > &order )
+    {
+      std::vector< T > result;
+      result.reserve( order.size() );
+      for ( const auto index : order )
+        result.push_back( std::move( values[ index ] ) );
+      return result;
+    }
+
+    //! Search \c keys for an entry equivalent to \c key , and return its index, or the size of \c keys if it is missing.
+    template< typename KEY, typename OTHER, typename COMPARE >
+    std::size_t flat_find_index( const std::vector< KEY > &keys, const OTHER &key, const COMPARE &compare )
+    {
+      const auto entry{ branchless_lower_bound( keys.begin(), keys.size(), key, compare ) };
+      if ( entry != keys.end() && !compare( key, *entry ) )
+        return static_cast< std::size_t >( entry - keys.begin() );
+      else
+        return keys.size();
+    }
+
+    //! Proxy for an entry of a map storing keys and mapped values in separate arrays, mimicking \c std::pair<const KEY,T> .
+    template< typename KEY, typename T, bool CONST >
+    struct split_reference
+    {
+      const KEY &first;
+      conditional_const_t< CONST, T > &second;
+    };
+
+    //! Random access iterator over a pair of arrays of keys and mapped values, dereferencing to \c split_reference proxies.
+    template< typename KEY, typename T, bool CONST >
+    class split_iterator
+    {
+    public:
+      using iterator_concept = std::random_access_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
+      using value_type = split_reference< KEY, T, CONST >;
+      using difference_type = std::ptrdiff_t;
+      using reference = split_reference< KEY, T, CONST >;
+
+      //! Makes \c operator-> usable on a proxy.
+      struct pointer
+      {
+        reference entry;
+        const reference *operator->() const noexcept { return &entry; }
+      };
+
+      split_iterator() = default;
+      split_iterator( const KEY *key, conditional_const_t< CONST, T > *value ) noexcept : _key{ key }, _value{ value } {}
+
+      //! Allow conversion from mutable to const iterators.
+      operator split_iterator< KEY, T, true >() const noexcept requires ( !CONST ) { return { _key, _value }; }
+
+      reference operator*() const noexcept { return { *_key, *_value }; }
+      pointer operator->() const noexcept { return { **this }; }
+      reference operator[]( const difference_type offset ) const noexcept { return *( *this + offset ); }
+
+      split_iterator &operator++() noexcept { ++_key; ++_value; return *this; }
+      split_iterator &operator--() noexcept { --_key; --_value; return *this; }
+      split_iterator operator++( int ) noexcept { auto old{ *this }; ++*this; return old; }
+      split_iterator operator--( int ) noexcept { auto old{ *this }; --*this; return old; }
+
+      split_iterator &operator+=( const difference_type offset ) noexcept { _key += offset; _value += offset; return *this; }
+      split_iterator &operator-=( const difference_type offset ) noexcept { return *this += -offset; }
+
+      friend split_iterator operator+( split_iterator it, const difference_type offset ) noexcept { return it += offset; }
+      friend split_iterator operator+( const difference_type offset, split_iterator it ) noexcept { return it += offset; }
+      friend split_iterator operator-( split_iterator it, const difference_type offset ) noexcept { return it -= offset; }
+      friend difference_type operator-( const split_iterator &a, const split_iterator &b ) noexcept { return a._key - b._key; }
+
+      friend bool operator==( const split_iterator &a, const split_iterator &b ) noexcept { return a._key == b._key; }
+      friend std::strong_ordering operator<=>( const split_iterator &a, const split_iterator &b ) noexcept { return a._key <=> b._key; }
+
+    private:
+      const KEY *_key{ nullptr };
+      conditional_const_t< CONST, T > *_value{ nullptr };
+    };
+  }
+
+  /*!
+    \brief Sorted associative container, storing keys and mapped values in separate contiguous arrays.
+
+    Lookups only touch the densely packed keys, until the mapped value of a match is accessed.
+    Insertion and erasure are linear in the size of the container, so the map is best suited for lookup tables which are built once, e.g. from a bulk of unsorted entries.
+
+    As there are no \c std::pair objects stored, iterators dereference to proxies holding references to the key and mapped value.
+    Hence, \c select and \c select_or_default work as for \c std::map , while \c select_if has to be applied to \c keys() or \c values() .
+  */
+  template< typename KEY, typename T, typename COMPARE = std::less<> >
+  class flat_map
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = T;
+    using key_compare = COMPARE;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    //! Proxy for an entry, mimicking \c std::pair<const KEY,T> .
+    template< bool CONST >
+    using basic_reference = detail_n::split_reference< KEY, T, CONST >;
+
+    using reference = basic_reference< false >;
+    using const_reference = basic_reference< true >;
+
+    //! Random access iterator over the entries of a \c flat_map .
+    template< bool CONST >
+    using basic_iterator = detail_n::split_iterator< KEY, T, CONST >;
+
+    using iterator = basic_iterator< false >;
+    using const_iterator = basic_iterator< true >;
+
+    flat_map() = default;
+
+    //! Build the map from unsorted \c entries , sorting them once. For duplicate keys, the first entry is kept.
+    explicit flat_map( std::vector< std::pair< KEY, T > > entries, COMPARE compare = {} ) : _compare{ std::move( compare ) }
+    {
+      std::vector< KEY > keys;
+      std::vector< T > values;
+      keys.reserve( entries.size() );
+      values.reserve( entries.size() );
+      for ( auto &entry : entries )
+      {
+        keys.push_back( std::move( entry.first ) );
+        values.push_back( std::move( entry.second ) );
+      }
+
+      const auto order{ detail_n::sort_unique_permutation( keys, _compare ) };
+      _keys = detail_n::apply_permutation( std::move( keys ), order );
+      _values = detail_n::apply_permutation( std::move( values ), order );
+    }
+
+    //! Build the map from the unsorted range \c [first, last) of key value pairs.
+    template< std::input_iterator ITERATOR >
+    flat_map( ITERATOR first, ITERATOR last, COMPARE compare = {} ) : flat_map( std::vector< std::pair< KEY, T > >( first, last ), std::move( compare ) ) {}
+
+    flat_map( std::initializer_list< std::pair< KEY, T > > entries, COMPARE compare = {} ) : flat_map( entries.begin(), entries.end(), std::move( compare ) ) {}
+
+    iterator begin() noexcept { return { _keys.data(), _values.data() }; }
+    iterator end() noexcept { return begin() + static_cast< difference_type >( size() ); }
+    const_iterator begin() const noexcept { return { _keys.data(), _values.data() }; }
+    const_iterator end() const noexcept { return begin() + static_cast< difference_type >( size() ); }
+
+    size_type size() const noexcept { return _keys.size(); }
+    bool empty() const noexcept { return _keys.empty(); }
+
+    //! The sorted keys, stored contiguously.
+    std::span< const KEY > keys() const noexcept { return _keys; }
+    //! The mapped values, in the order of their keys.
+    std::span< T > values() noexcept { return _values; }
+    std::span< const T > values() const noexcept { return _values; }
+
+    //! The entry at position \c index in sorted order.
+    iterator nth( const size_type index ) noexcept { return begin() + static_cast< difference_type >( index ); }
+    const_iterator nth( const size_type index ) const noexcept { return begin() + static_cast< difference_type >( index ); }
+
+    const COMPARE &key_comp() const noexcept { return _compare; }
+
+    //! Find an entry for \c key , or return the end iterator.
+    template< typename OTHER >
+    iterator find( const OTHER &key ) { return nth( detail_n::flat_find_index( _keys, key, _compare ) ); }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return nth( detail_n::flat_find_index( _keys, key, _compare ) ); }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find( key ) != end(); }
+
+    template< typename OTHER >
+    T &at( const OTHER &key )
+    {
+      if ( const auto entry{ find( key ) }; entry != end() )
+        return entry->second;
+      else
+        throw std::out_of_range{ "flat_map::at" };
+    }
+
+    template< typename OTHER >
+    const T &at( const OTHER &key ) const
+    {
+      if ( const auto entry{ find( key ) }; entry != end() )
+        return entry->second;
+      else
+        throw std::out_of_range{ "flat_map::at" };
+    }
+
+    //! Insert an entry constructed from \c args for \c key , unless \c key already exists.
+    template< typename... ARGS >
+    std::pair< iterator, bool > try_emplace( const KEY &key, ARGS &&... args )
+    {
+      const auto position{ lower_bound_index( key ) };
+      if ( position < size() && !_compare( key, _keys[ position ] ) )
+        return { nth( position ), false };
+
+      const auto key_position{ _keys.insert( _keys.begin() + static_cast< difference_type >( position ), key ) };
+      try
+      {
+        _values.emplace( _values.begin() + static_cast< difference_type >( position ), std::forward< ARGS >( args )... );
+      }
+      catch ( ... )
+      {
+        // Keep keys and values in sync.
+        _keys.erase( key_position );
+        throw;
+      }
+      return { nth( position ), true };
+    }
+
+    std::pair< iterator, bool > insert( std::pair< KEY, T > entry ) { return try_emplace( entry.first, std::move( entry.second ) ); }
+
+    T &operator[]( const KEY &key ) { return try_emplace( key ).first->second; }
+
+    //! Remove the entry for \c key , and return the number of removed entries.
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      if ( const auto position{ detail_n::flat_find_index( _keys, key, _compare ) }; position < size() )
+      {
+        _keys.erase( _keys.begin() + static_cast< difference_type >( position ) );
+        _values.erase( _values.begin() + static_cast< difference_type >( position ) );
+        return 1;
+      }
+      else
+        return 0;
+    }
+
+    void clear() noexcept { _keys.clear(); _values.clear(); }
+
+    void reserve( const size_type capacity )
+    {
+      _keys.reserve( capacity );
+      _values.reserve( capacity );
+    }
+
+  private:
+    size_type lower_bound_index( const KEY &key ) const
+    {
+      return static_cast< size_type >( detail_n::branchless_lower_bound( _keys.begin(), _keys.size(), key, _compare ) - _keys.begin() );
+    }
+
+    std::vector< KEY > _keys;
+    std::vector< T > _values;
+    COMPARE _compare;
+  };
+
+  /*!
+    \brief Sorted set, storing its keys in a contiguous array.
+
+    Lookups are binary searches on densely packed keys.
+    Insertion and erasure are linear in the size of the container, so the set is best suited for lookup tables which are built once, e.g. from a bulk of unsorted keys.
+  */
+  template< typename KEY, typename COMPARE = std::less<> >
+  class flat_set
+  {
+  public:
+    using key_type = KEY;
+    using value_type = KEY;
+    using key_compare = COMPARE;
+    using size_type = std::size_t;
+    using const_iterator = typename std::vector< KEY >::const_iterator;
+    using iterator = const_iterator;
+
+    flat_set() = default;
+
+    //! Build the set from unsorted \c keys , sorting them once. Duplicates are dropped.
+    explicit flat_set( std::vector< KEY > keys, COMPARE compare = {} ) : _compare{ std::move( compare ) }
+    {
+      const auto order{ detail_n::sort_unique_permutation( keys, _compare ) };
+      _keys = detail_n::apply_permutation( std::move( keys ), order );
+    }
+
+    //! Build the set from the unsorted range \c [first, last) .
+    template< std::input_iterator ITERATOR >
+    flat_set( ITERATOR first, ITERATOR last, COMPARE compare = {} ) : flat_set( std::vector< KEY >( first, last ), std::move( compare ) ) {}
+
+    flat_set( std::initializer_list< KEY > keys, COMPARE compare = {} ) : flat_set( keys.begin(), keys.end(), std::move( compare ) ) {}
+
+    const_iterator begin() const noexcept { return _keys.begin(); }
+    const_iterator end() const noexcept { return _keys.end(); }
+
+    size_type size() const noexcept { return _keys.size(); }
+    bool empty() const noexcept { return _keys.empty(); }
+
+    //! The sorted keys, stored contiguously.
+    std::span< const KEY > keys() const noexcept { return _keys; }
+
+    //! The key at position \c index in sorted order.
+    const_iterator nth( const size_type index ) const noexcept { return begin() + static_cast< std::ptrdiff_t >( index ); }
+
+    const COMPARE &key_comp() const noexcept { return _compare; }
+
+    //! Find a key equivalent to \c key , or return the end iterator.
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return nth( detail_n::flat_find_index( _keys, key, _compare ) ); }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find( key ) != end(); }
+
+    //! Insert \c key , unless an equivalent key already exists.
+    std::pair< const_iterator, bool > insert( KEY key )
+    {
+      const auto position{ detail_n::branchless_lower_bound( _keys.begin(), _keys.size(), key, _compare ) };
+      if ( position != _keys.end() && !_compare( key, *position ) )
+        return { position, false };
+      else
+        return { _keys.insert( position, std::move( key ) ), true };
+    }
+
+    //! Remove \c key , and return the number of removed keys.
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      if ( const auto position{ detail_n::flat_find_index( _keys, key, _compare ) }; position < size() )
+      {
+        _keys.erase( _keys.begin() + static_cast< std::ptrdiff_t >( position ) );
+        return 1;
+      }
+      else
+        return 0;
+    }
+
+    void clear() noexcept { _keys.clear(); }
+    void reserve( const size_type capacity ) { _keys.reserve( capacity ); }
+
+  private:
+    std::vector< KEY > _keys;
+    COMPARE _compare;
+  };
+}
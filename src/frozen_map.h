@@ -0,0 +1,299 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Concept of keys for which a hash can be computed at compile time.
+    template< typename KEY >
+    concept FrozenHashable = std::integral< KEY > || std::is_enum_v< KEY > || std::convertible_to< const KEY &, std::string_view >;
+
+    //! Seed independent hash of \c key , usable at compile time.
+    template< FrozenHashable KEY >
+    constexpr std::uint64_t frozen_hash( const KEY &key ) noexcept
+    {
+      if constexpr ( std::is_enum_v< KEY > )
+        return mix( static_cast< std::uint64_t >( static_cast< std::underlying_type_t< KEY > >( key ) ) );
+      else if constexpr ( std::integral< KEY > )
+        return mix( static_cast< std::uint64_t >( key ) );
+      else
+      {
+        // FNV-1a
+        std::uint64_t hash{ 0xcbf29ce484222325u };
+        for ( const char c : std::string_view{ key } )
+          hash = ( hash ^ static_cast< unsigned char >( c ) ) * 0x100000001b3u;
+        return mix( hash );
+      }
+    }
+
+    //! Derive the hash of family member \c seed from a seed independent \c hash .
+    constexpr std::uint64_t seeded_hash( const std::uint64_t hash, const std::uint64_t seed ) noexcept
+    {
+      return mix( hash + seed * 0x9e3779b97f4a7c15u );
+    }
+
+    /*!
+      \brief Minimal perfect hash function over \c N keys, built at compile time by hash and displace.
+
+      Keys are distributed over buckets by a first hash.
+      Starting with the largest bucket, a seed is searched for each bucket, such that the seeded hashes of its keys hit only free slots of the table.
+      A lookup thus takes two hashes and a single key comparison.
+    */
+    template< std::size_t N >
+    class perfect_hash
+    {
+    public:
+      static constexpr std::size_t bucket_count{ N / 2 + 1 };
+      static constexpr std::size_t slot_count{ std::bit_ceil( 2 * N + 1 ) };
+
+      //! Build the function for the seed independent \c hashes of \c N distinct keys.
+      constexpr explicit perfect_hash( const std::array< std::uint64_t, N > &hashes )
+      {
+        std::array< std::size_t, bucket_count > sizes{};
+        for ( const auto hash : hashes )
+          ++sizes[ hash % bucket_count ];
+
+        std::array< std::size_t, bucket_count > order{};
+        for ( std::size_t bucket{ 0 }; bucket < bucket_count; ++bucket )
+          order[ bucket ] = bucket;
+        std::sort( order.begin(), order.end(), [ &sizes ]( const std::size_t a, const std::size_t b ){ return sizes[ a ] > sizes[ b ]; } );
+
+        _slots.fill( N );
+        for ( const auto bucket : order )
+        {
+          if ( sizes[ bucket ] == 0 )
+            break;
+
+          // Keys of this bucket, and their candidate slots.
+          std::array< std::size_t, N > members{};
+          std::array< std::size_t, N > candidates{};
+          std::size_t count{ 0 };
+          for ( std::size_t index{ 0 }; index < N; ++index )
+            if ( hashes[ index ] % bucket_count == bucket )
+              members[ count++ ] = index;
+
+          for ( std::uint32_t seed{ 1 }; ; ++seed )
+          {
+            if ( seed == 1u << 20 )
+              throw std::logic_error{ "perfect_hash: no seed found, keys are not distinct" };
+
+            bool free{ true };
+            for ( std::size_t member{ 0 }; free && member < count; ++member )
+            {
+              candidates[ member ] = seeded_hash( hashes[ members[ member ] ], seed ) % slot_count;
+              free = _slots[ candidates[ member ] ] == N && std::find( candidates.begin(), candidates.begin() + member, candidates[ member ] ) == candidates.begin() + member;
+            }
+
+            if ( free )
+            {
+              _seeds[ bucket ] = seed;
+              for ( std::size_t member{ 0 }; member < count; ++member )
+                _slots[ candidates[ member ] ] = members[ member ];
+              break;
+            }
+          }
+        }
+      }
+
+      //! Index of the only key that may have the seed independent \c hash , or \c N if there is none.
+      constexpr std::size_t operator()( const std::uint64_t hash ) const noexcept
+      {
+        return _slots[ seeded_hash( hash, _seeds[ hash % bucket_count ] ) % slot_count ];
+      }
+
+    private:
+      std::array< std::uint32_t, bucket_count > _seeds{};
+      std::array< std::size_t, slot_count > _slots{};
+    };
+
+    /*!
+      \brief Index over \c N sorted keys, built at compile time.
+
+      Small or non hashable key sets are searched by a branchless binary search.
+      Larger sets of hashable keys use a \c perfect_hash , so a lookup does a single comparison.
+    */
+    template< typename KEY, std::size_t N >
+    class frozen_index
+    {
+    public:
+      //! Up to this size, a binary search is at least as fast as hashing.
+      static constexpr std::size_t binary_search_limit{ 16 };
+      static constexpr bool hashed{ FrozenHashable< KEY > && N > binary_search_limit };
+
+      //! Build the index for \c keys , which have to be sorted and distinct.
+      template< typename KEYS >
+      constexpr explicit frozen_index( const KEYS &keys ) : _hash{ hashes( keys ) } {}
+
+      //! Position of \c key in \c keys , or \c N if it is missing.
+      template< typename KEYS >
+      constexpr std::size_t find( const KEYS &keys, const KEY &key ) const
+      {
+        if constexpr ( hashed )
+        {
+          const auto index{ _hash( frozen_hash( key ) ) };
+          return index < N && keys( index ) == key ? index : N;
+        }
+        else
+        {
+          std::size_t first{ 0 };
+          std::size_t size{ N };
+          while ( size > 1 )
+          {
+            const auto half{ size / 2 };
+            first = keys( first + half ) < key ? first + half : first;
+            size -= half;
+          }
+          if constexpr ( N > 0 )
+            first += keys( first ) < key;
+          return first < N && !( key < keys( first ) ) ? first : N;
+        }
+      }
+
+    private:
+      struct no_hash
+      {
+        constexpr explicit no_hash( std::nullptr_t ) noexcept {}
+      };
+
+      template< typename KEYS >
+      static constexpr auto hashes( const KEYS &keys )
+      {
+        if constexpr ( hashed )
+        {
+          std::array< std::uint64_t, N > result{};
+          for ( std::size_t index{ 0 }; index < N; ++index )
+            result[ index ] = frozen_hash( keys( index ) );
+          return result;
+        }
+        else
+          return nullptr;
+      }
+
+      std::conditional_t< hashed, perfect_hash< N >, no_hash > _hash;
+    };
+
+    //! Sort \c entries by the keys given by \c key_of , and reject duplicate keys.
+    template< typename ENTRY, std::size_t N, typename KEY_OF >
+    constexpr std::array< ENTRY, N > sorted_entries( std::array< ENTRY, N > entries, const KEY_OF &key_of )
+    {
+      std::sort( entries.begin(), entries.end(), [ &key_of ]( const ENTRY &a, const ENTRY &b ){ return key_of( a ) < key_of( b ); } );
+      for ( std::size_t index{ 1 }; index < N; ++index )
+        if ( !( key_of( entries[ index - 1 ] ) < key_of( entries[ index ] ) ) )
+          throw std::logic_error{ "frozen container: duplicate key" };
+      return entries;
+    }
+  }
+
+  /*!
+    \brief Immutable map with \c N entries, built at compile time.
+
+    The entries are stored sorted by key in an array, indexed by a perfect hash for hashable keys or a binary search for small maps.
+    As all member functions are \c constexpr , \c select on a \c constexpr map with a constant key is folded by the compiler.
+    Use \c make_frozen_map to deduce \c N from an initializer list.
+  */
+  template< typename KEY, typename T, std::size_t N >
+  class frozen_map
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = T;
+    using value_type = std::pair< KEY, T >;
+    using const_iterator = const value_type *;
+    using iterator = const_iterator;
+
+    constexpr explicit frozen_map( const std::array< value_type, N > &entries )
+      : _entries{ detail_n::sorted_entries( entries, key_of ) }, _index{ keys() } {}
+
+    constexpr const_iterator begin() const noexcept { return _entries.data(); }
+    constexpr const_iterator end() const noexcept { return _entries.data() + N; }
+    constexpr std::size_t size() const noexcept { return N; }
+    constexpr bool empty() const noexcept { return N == 0; }
+
+    //! Find the entry for \c key , or return the end iterator.
+    constexpr const_iterator find( const KEY &key ) const { return begin() + _index.find( keys(), key ); }
+
+    constexpr bool contains( const KEY &key ) const { return find( key ) != end(); }
+
+    constexpr const T &at( const KEY &key ) const
+    {
+      if ( const auto entry{ find( key ) }; entry != end() )
+        return entry->second;
+      else
+        throw std::out_of_range{ "frozen_map::at" };
+    }
+
+  private:
+    static constexpr const KEY &key_of( const value_type &entry ) noexcept { return entry.first; }
+    constexpr auto keys() const noexcept { return [ this ]( const std::size_t index ) -> const KEY & { return _entries[ index ].first; }; }
+
+    std::array< value_type, N > _entries;
+    detail_n::frozen_index< KEY, N > _index;
+  };
+
+  /*!
+    \brief Immutable set with \c N keys, built at compile time.
+
+    The keys are stored sorted in an array, indexed like the keys of a \c frozen_map .
+    Use \c make_frozen_set to deduce \c N from an initializer list.
+  */
+  template< typename KEY, std::size_t N >
+  class frozen_set
+  {
+  public:
+    using key_type = KEY;
+    using value_type = KEY;
+    using const_iterator = const KEY *;
+    using iterator = const_iterator;
+
+    constexpr explicit frozen_set( const std::array< KEY, N > &keys )
+      : _keys{ detail_n::sorted_entries( keys, key_of ) }, _index{ key_at() } {}
+
+    constexpr const_iterator begin() const noexcept { return _keys.data(); }
+    constexpr const_iterator end() const noexcept { return _keys.data() + N; }
+    constexpr std::size_t size() const noexcept { return N; }
+    constexpr bool empty() const noexcept { return N == 0; }
+
+    //! Find \c key , or return the end iterator.
+    constexpr const_iterator find( const KEY &key ) const { return begin() + _index.find( key_at(), key ); }
+
+    constexpr bool contains( const KEY &key ) const { return find( key ) != end(); }
+
+  private:
+    static constexpr const KEY &key_of( const KEY &key ) noexcept { return key; }
+    constexpr auto key_at() const noexcept { return [ this ]( const std::size_t index ) -> const KEY & { return _keys[ index ]; }; }
+
+    std::array< KEY, N > _keys;
+    detail_n::frozen_index< KEY, N > _index;
+  };
+
+  //! Build a \c frozen_map from a list of key value pairs.
+  template< typename KEY, typename T, std::size_t N >
+  constexpr frozen_map< KEY, T, N > make_frozen_map( const std::pair< KEY, T > ( &entries )[ N ] )
+  {
+    return frozen_map< KEY, T, N >{ std::to_array( entries ) };
+  }
+
+  //! Build a \c frozen_set from a list of keys.
+  template< typename KEY, std::size_t N >
+  constexpr frozen_set< KEY, N > make_frozen_set( const KEY ( &keys )[ N ] )
+  {
+    return frozen_set< KEY, N >{ std::to_array( keys ) };
+  }
+}
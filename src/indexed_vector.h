@@ -0,0 +1,411 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "key_hash.h"
+#include "select_or_default.h"
+#include "select_stats.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Key extracted by \c KEY_OF from a \c T , e.g. by a pointer to data member or a captureless lambda.
+    template< auto KEY_OF, typename T >
+    using extracted_key_t = std::remove_cvref_t< std::invoke_result_t< decltype( KEY_OF ), const T & > >;
+
+    //! Positions of elements by key, in a hash map of ordered position sets, so keys shared by many elements stay cheap to update.
+    template< typename KEY >
+    class hashed_positions
+    {
+    public:
+      void insert( KEY key, const std::size_t position )
+      {
+        const auto [ entry, added ]{ _positions.try_emplace( std::move( key ) ) };
+        try
+        {
+          entry->second.insert( position );
+        }
+        catch ( ... )
+        {
+          // Do not keep a key without positions.
+          if ( added )
+            _positions.erase( entry );
+          throw;
+        }
+      }
+
+      void erase( const KEY &key, const std::size_t position )
+      {
+        const auto entry{ _positions.find( key ) };
+        assert( entry != _positions.end() );
+        entry->second.erase( position );
+        if ( entry->second.empty() )
+          _positions.erase( entry );
+      }
+
+      //! Move the entry of \c key from position \c from to \c to , reusing its node, so nothing is allocated.
+      void relocate( const KEY &key, const std::size_t from, const std::size_t to )
+      {
+        auto &positions{ _positions.find( key )->second };
+        auto node{ positions.extract( from ) };
+        node.value() = to;
+        positions.insert( std::move( node ) );
+      }
+
+      //! The first position of an element with \c key , or \c npos if there is none.
+      template< typename OTHER >
+      std::size_t find( const OTHER &key ) const
+      {
+        const auto entry{ _positions.find( key ) };
+        return entry != _positions.end() ? *entry->second.begin() : npos;
+      }
+
+      void clear() noexcept { _positions.clear(); }
+
+      static constexpr std::size_t npos{ static_cast< std::size_t >( -1 ) };
+
+    private:
+      std::unordered_map< KEY, std::set< std::size_t >, key_hash< KEY >, std::equal_to<> > _positions;
+    };
+
+    //! Order of (key, position) entries of an ordered index, which also compares entries of other key types.
+    struct position_less
+    {
+      using is_transparent = void;
+
+      template< typename A, typename B >
+      bool operator()( const std::pair< A, std::size_t > &a, const std::pair< B, std::size_t > &b ) const
+      {
+        return a.first < b.first || ( !( b.first < a.first ) && a.second < b.second );
+      }
+    };
+
+    //! Positions of elements by key, in a balanced tree of (key, position) entries.
+    template< typename KEY >
+    class ordered_positions
+    {
+    public:
+      void insert( KEY key, const std::size_t position ) { _positions.emplace( std::move( key ), position ); }
+
+      void erase( const KEY &key, const std::size_t position )
+      {
+        _positions.erase( _positions.find( std::pair< const KEY &, std::size_t >{ key, position } ) );
+      }
+
+      //! Move the entry of \c key from position \c from to \c to , reusing its node, so nothing is allocated.
+      void relocate( const KEY &key, const std::size_t from, const std::size_t to )
+      {
+        auto node{ _positions.extract( _positions.find( std::pair< const KEY &, std::size_t >{ key, from } ) ) };
+        node.value().second = to;
+        _positions.insert( std::move( node ) );
+      }
+
+      //! The first position of an element with \c key , or \c npos if there is none.
+      template< typename OTHER >
+      std::size_t find( const OTHER &key ) const
+      {
+        const auto entry{ _positions.lower_bound( std::pair< const OTHER &, std::size_t >{ key, 0 } ) };
+        return entry != _positions.end() && !( key < entry->first ) ? entry->second : npos;
+      }
+
+      void clear() noexcept { _positions.clear(); }
+
+      static constexpr std::size_t npos{ static_cast< std::size_t >( -1 ) };
+
+    private:
+      std::set< std::pair< KEY, std::size_t >, position_less > _positions;
+    };
+
+    //! Secondary index over elements of type \c T , as described by \c INDEX .
+    template< typename INDEX, typename T >
+    class secondary_index
+    {
+    public:
+      using tag = typename INDEX::tag;
+      using key_type = extracted_key_t< INDEX::key_of, T >;
+      using positions_type = typename INDEX::template positions< key_type >;
+
+      void insert( const T &value, const std::size_t position ) { _positions.insert( key_of( value ), position ); }
+      void erase( const T &value, const std::size_t position ) { _positions.erase( key_of( value ), position ); }
+      void relocate( const T &value, const std::size_t from, const std::size_t to ) { _positions.relocate( key_of( value ), from, to ); }
+      void clear() noexcept { _positions.clear(); }
+
+      template< typename OTHER >
+      std::size_t find( const OTHER &key ) const { return _positions.find( key ); }
+
+      static constexpr std::size_t npos{ positions_type::npos };
+
+    private:
+      static decltype( auto ) key_of( const T &value ) { return std::invoke( INDEX::key_of, value ); }
+
+      positions_type _positions;
+    };
+  }
+
+  /*!
+    \brief Hashed secondary index of an \c indexed_vector , named by \c TAG .
+
+    \c KEY_OF extracts the key from an element, e.g. a pointer to data member like \c &record::owner , or a captureless lambda.
+    Lookups take constant time on average. Keys are hashed by \c key_hash , so string keys can be looked up by any string like type.
+    Insertions, erasures and modifications take logarithmic time in the number of elements sharing a key, so low cardinality keys are fine, too.
+    A lookup finds the element with the lowest position among those with the key.
+  */
+  template< typename TAG, auto KEY_OF >
+  struct hashed_index
+  {
+    using tag = TAG;
+    static constexpr auto key_of{ KEY_OF };
+
+    template< typename KEY >
+    using positions = detail_n::hashed_positions< KEY >;
+  };
+
+  /*!
+    \brief Ordered secondary index of an \c indexed_vector , named by \c TAG .
+
+    \c KEY_OF extracts the key from an element, like for \c hashed_index . Keys are ordered by \c operator< .
+    Lookups, insertions and erasures take logarithmic time, also for keys shared by many elements.
+    A lookup finds the element with the lowest position among those with the key.
+  */
+  template< typename TAG, auto KEY_OF >
+  struct ordered_index
+  {
+    using tag = TAG;
+    static constexpr auto key_of{ KEY_OF };
+
+    template< typename KEY >
+    using positions = detail_n::ordered_positions< KEY >;
+  };
+
+  /*!
+    \brief Vector with secondary indexes, maintained incrementally.
+
+    Each of \c INDEXES , a \c hashed_index or \c ordered_index , maps a key extracted from the elements to their positions.
+    They are updated on every insertion, erasure and modification, so \c select_by finds an element by key without scanning the vector.
+    Elements are only exposed as const, and changed by \c modify , which updates the indexes.
+    Erasing an element moves the last element into its place, so positions are not stable across erasures.
+  */
+  template< typename T, typename... INDEXES >
+  class indexed_vector
+  {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using const_iterator = typename std::vector< T >::const_iterator;
+    using iterator = const_iterator;
+
+    indexed_vector() = default;
+
+    indexed_vector( std::initializer_list< T > values )
+    {
+      reserve( values.size() );
+      for ( const auto &value : values )
+        push_back( value );
+    }
+
+    const_iterator begin() const noexcept { return _values.begin(); }
+    const_iterator end() const noexcept { return _values.end(); }
+
+    size_type size() const noexcept { return _values.size(); }
+    bool empty() const noexcept { return _values.empty(); }
+
+    void reserve( const size_type capacity ) { _values.reserve( capacity ); }
+
+    const T &operator[]( const size_type position ) const noexcept { return _values[ position ]; }
+
+    const T &at( const size_type position ) const
+    {
+      if ( position < size() )
+        return _values[ position ];
+      else
+        throw std::out_of_range{ "indexed_vector::at: position out of range" };
+    }
+
+    //! The elements, stored contiguously.
+    std::span< const T > values() const noexcept { return _values; }
+
+    void push_back( const T &value ) { emplace_back( value ); }
+    void push_back( T &&value ) { emplace_back( std::move( value ) ); }
+
+    //! Append an element constructed from \c args , and add it to all indexes. If indexing fails, the element is dropped again.
+    template< typename... ARGS >
+    const T &emplace_back( ARGS &&... args )
+    {
+      _values.emplace_back( std::forward< ARGS >( args )... );
+      try
+      {
+        index( size() - 1 );
+      }
+      catch ( ... )
+      {
+        _values.pop_back();
+        throw;
+      }
+      return _values.back();
+    }
+
+    //! Erase the element at \c position , moving the last element into its place.
+    void erase( const size_type position )
+    {
+      unindex( position );
+      remove( position );
+    }
+
+    /*!
+      \brief Change the element at \c position by calling \c modifier on it, and update its keys in all indexes.
+
+      If \c modifier throws, the element is indexed by its keys as left by \c modifier .
+      If the element cannot be indexed by its new keys, it is erased, as it cannot stay in the vector without being indexed.
+    */
+    template< std::invocable< T & > MODIFIER >
+    void modify( const size_type position, MODIFIER &&modifier )
+    {
+      unindex( position );
+      try
+      {
+        std::invoke( std::forward< MODIFIER >( modifier ), _values[ position ] );
+      }
+      catch ( ... )
+      {
+        reindex( position );
+        throw;
+      }
+      reindex( position );
+    }
+
+    void clear() noexcept
+    {
+      _values.clear();
+      std::apply( []( auto &... indexes ){ ( indexes.clear(), ... ); }, _indexes );
+    }
+
+    //! Find an element with \c key in the index tagged \c TAG . Returns the end iterator if there is none.
+    template< typename TAG, typename KEY >
+    const_iterator find_by( const KEY &key ) const
+    {
+      static_assert( index_position< TAG >() < sizeof...( INDEXES ), "TAG is not the tag of an index" );
+      const auto &index{ std::get< index_position< TAG >() >( _indexes ) };
+      const auto position{ index.find( key ) };
+      return position != index.npos ? begin() + static_cast< std::ptrdiff_t >( position ) : end();
+    }
+
+  private:
+    //! Remove the unindexed element at \c position from the vector, moving the last element into its place.
+    void remove( const size_type position )
+    {
+      const auto last{ size() - 1 };
+      if ( position != last )
+      {
+        std::apply( [ & ]( auto &... indexes ){ ( indexes.relocate( _values[ last ], last, position ), ... ); }, _indexes );
+        _values[ position ] = std::move( _values[ last ] );
+      }
+      _values.pop_back();
+    }
+
+    //! Position of the index tagged \c TAG in \c INDEXES .
+    template< typename TAG >
+    static constexpr std::size_t index_position() noexcept
+    {
+      constexpr bool matches[]{ std::is_same_v< TAG, typename INDEXES::tag >... };
+      std::size_t position{ 0 };
+      while ( position < sizeof...( INDEXES ) && !matches[ position ] )
+        ++position;
+      return position;
+    }
+
+    //! Add the element at \c position to all indexes. If any index fails, it is removed from the others again.
+    void index( const size_type position )
+    {
+      std::size_t indexed{ 0 };
+      try
+      {
+        std::apply( [ & ]( auto &... indexes ){ ( ( indexes.insert( _values[ position ], position ), ++indexed ), ... ); }, _indexes );
+      }
+      catch ( ... )
+      {
+        std::apply( [ & ]( auto &... indexes )
+        {
+          ( [ & ]{ if ( indexed > 0 ) { indexes.erase( _values[ position ], position ); --indexed; } }(), ... );
+        }, _indexes );
+        throw;
+      }
+    }
+
+    //! Index the modified element at \c position again. If that fails, the element is removed from the vector.
+    void reindex( const size_type position )
+    {
+      try
+      {
+        index( position );
+      }
+      catch ( ... )
+      {
+        remove( position );
+        throw;
+      }
+    }
+
+    //! Remove the element at \c position from all indexes.
+    void unindex( const size_type position )
+    {
+      std::apply( [ & ]( auto &... indexes ){ ( indexes.erase( _values[ position ], position ), ... ); }, _indexes );
+    }
+
+    std::vector< T > _values;
+    std::tuple< detail_n::secondary_index< INDEXES, T >... > _indexes;
+  };
+
+  /*!
+    \brief Select an element from an \c indexed_vector by the key of one of its indexes.
+
+    Instead of scanning all elements like \c select_if , the index tagged \c TAG is asked for \c key .
+    An element with the key is returned by pointer, or a \c nullptr if there is none.
+  */
+  template< typename T, typename... INDEXES, typename TAG, typename KEY >
+  const T *select_by( const indexed_vector< T, INDEXES... > &container, TAG, const KEY &key SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_by" );
+    if ( const auto entry{ container.template find_by< TAG >( key ) }; entry != container.end() )
+      // Key exists -> return pointer to element.
+      return SELECT_N_HIT( &*entry );
+    else
+      // Key missing -> return nullptr.
+      return SELECT_N_MISS( nullptr );
+  }
+
+  /*!
+    \brief Select an element from an \c indexed_vector by the key of one of its indexes, or return a default value.
+
+    Like \c select_or_default , but the element is selected by \c select_by .
+    Elements are const, so the result is a const reference if \c def is an lvalue, or a value otherwise.
+  */
+  template< typename T, typename... INDEXES, typename TAG, typename KEY, typename DEFAULT >
+  typename detail_n::find_or_default_result_c< const indexed_vector< T, INDEXES... > &, const T *, DEFAULT >::type
+  select_or_default_by( const indexed_vector< T, INDEXES... > &container, TAG tag, const KEY &key, DEFAULT &&def SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_or_default_by" );
+    if ( const auto existing{ select_by( container, tag, key ) } )
+      // Key exists -> reference or copy element.
+      return SELECT_N_HIT( *existing );
+    else
+      // Key missing -> return the default value.
+      return SELECT_N_DEFAULT( std::forward< DEFAULT >( def ) );
+  }
+}
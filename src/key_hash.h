@@ -0,0 +1,31 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+namespace select_n
+{
+  /*!
+    \brief Default hash of the hash maps of this library.
+
+    Keys are hashed by \c std::hash , but string keys are hashed as \c std::string_view .
+    Hence, the hash of strings is transparent: Any string like type can be hashed, and looked up, without constructing a \c KEY .
+    A hash computed once can be reused for lookups in all maps with the same key type, see \c select_hashed .
+  */
+  template< typename KEY >
+  struct key_hash : std::hash< KEY > {};
+
+  template< typename KEY > requires std::convertible_to< const KEY &, std::string_view >
+  struct key_hash< KEY >
+  {
+    using is_transparent = void;
+
+    std::size_t operator()( const std::string_view key ) const noexcept { return std::hash< std::string_view >{}( key ); }
+  };
+}
@@ -0,0 +1,422 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "select_sorted.h"
+
+/*!
+  \file
+  \brief Read only, memory mapped index files, which \c select can query in place.
+
+  An index file holds a header and an array of records, sorted by key.
+  Records are stored exactly as they are laid out in memory, so a \c mapped_index maps the file and hands out pointers right into the mapping, without any deserialization.
+  Opening an index is thus independent of its size, and its pages are loaded on demand and shared by all processes mapping the same file.
+
+  Keys and values are either trivially copyable types of fixed size, or strings stored as \c relative_string , which refer to the string data at the end of the file.
+  Index files are not portable between platforms of different endianness or ABI.
+  This header needs POSIX \c mmap .
+*/
+
+namespace select_n
+{
+  /*!
+    \brief String stored in a mapped index.
+
+    The characters are stored elsewhere in the mapping, at an offset relative to the \c relative_string itself.
+    Hence, it can be used in place, but it cannot be copied.
+    It compares like its \c std::string_view .
+  */
+  class relative_string
+  {
+  public:
+    relative_string() = default;
+    relative_string( const relative_string & ) = delete;
+    relative_string &operator=( const relative_string & ) = delete;
+
+    std::string_view view() const noexcept { return { reinterpret_cast< const char * >( this ) + _offset, static_cast< std::size_t >( _size ) }; }
+    operator std::string_view() const noexcept { return view(); }
+
+    std::size_t size() const noexcept { return static_cast< std::size_t >( _size ); }
+    bool empty() const noexcept { return _size == 0; }
+
+    friend bool operator==( const relative_string &a, const relative_string &b ) noexcept { return a.view() == b.view(); }
+    friend std::strong_ordering operator<=>( const relative_string &a, const relative_string &b ) noexcept { return a.view() <=> b.view(); }
+    friend bool operator==( const relative_string &a, const std::string_view b ) noexcept { return a.view() == b; }
+    friend std::strong_ordering operator<=>( const relative_string &a, const std::string_view b ) noexcept { return a.view() <=> b; }
+
+  private:
+    template< typename, typename >
+    friend class mapped_index_builder;
+
+    std::int64_t _offset{ 0 };
+    std::uint64_t _size{ 0 };
+  };
+
+  namespace detail_n
+  {
+    //! Concept of types that can be stored in a mapped index.
+    template< typename T >
+    concept Mappable = ( std::is_trivially_copyable_v< T > && std::is_standard_layout_v< T > ) || std::same_as< T, relative_string >;
+
+    //! Type to provide a \c T from, when building an index.
+    template< typename T >
+    using mapped_input_t = std::conditional_t< std::same_as< T, relative_string >, std::string, T >;
+
+    //! Record of a mapped map.
+    template< typename KEY, typename VALUE >
+    struct mapped_record
+    {
+      KEY first;
+      VALUE second;
+    };
+
+    //! Stored record type: the plain key for sets, or a key value pair for maps.
+    template< typename KEY, typename VALUE >
+    using mapped_value_t = std::conditional_t< std::is_void_v< VALUE >, KEY, mapped_record< KEY, std::conditional_t< std::is_void_v< VALUE >, char, VALUE > > >;
+
+    //! Header of an index file. The records follow at \c records_offset .
+    struct mapped_header
+    {
+      //! Space reserved for the header, so records are aligned.
+      static constexpr std::size_t reserved_size{ 64 };
+      static constexpr char magic_value[ 8 ]{ 'S', 'E', 'L', 'N', 'I', 'D', 'X', '1' };
+      static constexpr std::uint32_t current_version{ 1 };
+
+      char magic[ 8 ];
+      std::uint32_t version;
+      std::uint32_t record_size;
+      std::uint32_t record_alignment;
+      std::uint32_t key_size;
+      std::uint64_t count;
+      std::uint64_t records_offset;
+      std::uint64_t file_size;
+    };
+    static_assert( sizeof( mapped_header ) <= mapped_header::reserved_size );
+
+    //! Throw a \c std::system_error for the current \c errno .
+    [[noreturn]] inline void throw_errno( const std::string &what )
+    {
+      throw std::system_error{ errno, std::system_category(), what };
+    }
+
+    //! File descriptor, closed on destruction.
+    class file_descriptor
+    {
+    public:
+      explicit file_descriptor( const int descriptor ) noexcept : _descriptor{ descriptor } {}
+      file_descriptor( const file_descriptor & ) = delete;
+      file_descriptor &operator=( const file_descriptor & ) = delete;
+      ~file_descriptor() { if ( _descriptor >= 0 ) ::close( _descriptor ); }
+
+      int get() const noexcept { return _descriptor; }
+
+    private:
+      int _descriptor;
+    };
+  }
+
+  /*!
+    \brief Read only map or set, queried right in a memory mapped index file.
+
+    An index with \c VALUE \c void is a set of \c KEY , which is \c SetLike .
+    Otherwise, it is a map from \c KEY to \c VALUE , which is \c MapLike .
+    Either way, the records can be searched by \c select_if , too.
+    Results point into the mapping, and are valid as long as the index is.
+
+    Lookups are binary searches over the records, comparing keys by \c std::less<> , so e.g. \c relative_string keys can be found by \c std::string_view .
+    The file is expected to be written by \c mapped_index_builder with the same \c KEY and \c VALUE .
+    Its header is validated, but the string offsets are trusted.
+  */
+  template< detail_n::Mappable KEY, typename VALUE = void > requires ( std::is_void_v< VALUE > || detail_n::Mappable< VALUE > )
+  class mapped_index
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = VALUE;
+    using value_type = detail_n::mapped_value_t< KEY, VALUE >;
+    using size_type = std::size_t;
+    using const_iterator = const value_type *;
+    using iterator = const_iterator;
+
+    //! Map the index file at \c path . Throws \c std::system_error if it cannot be mapped, or \c std::runtime_error if it is no suitable index.
+    explicit mapped_index( const std::filesystem::path &path )
+    {
+      const detail_n::file_descriptor file{ ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) };
+      if ( file.get() < 0 )
+        detail_n::throw_errno( "mapped_index: cannot open " + path.string() );
+
+      struct stat status;
+      if ( ::fstat( file.get(), &status ) != 0 )
+        detail_n::throw_errno( "mapped_index: cannot stat " + path.string() );
+      _size = static_cast< std::size_t >( status.st_size );
+      if ( _size < detail_n::mapped_header::reserved_size )
+        throw std::runtime_error{ "mapped_index: " + path.string() + " is too short" };
+
+      // A shared mapping lets all processes use the same pages of the page cache.
+      _data = ::mmap( nullptr, _size, PROT_READ, MAP_SHARED, file.get(), 0 );
+      if ( _data == MAP_FAILED )
+        detail_n::throw_errno( "mapped_index: cannot map " + path.string() );
+
+      try
+      {
+        validate( path );
+      }
+      catch ( ... )
+      {
+        ::munmap( _data, _size );
+        throw;
+      }
+    }
+
+    mapped_index( mapped_index &&other ) noexcept
+      : _data{ std::exchange( other._data, MAP_FAILED ) }, _size{ std::exchange( other._size, 0 ) }, _records{ std::exchange( other._records, nullptr ) }, _count{ std::exchange( other._count, 0 ) } {}
+
+    mapped_index &operator=( mapped_index other ) noexcept
+    {
+      std::swap( _data, other._data );
+      std::swap( _size, other._size );
+      std::swap( _records, other._records );
+      std::swap( _count, other._count );
+      return *this;
+    }
+
+    ~mapped_index()
+    {
+      if ( _data != MAP_FAILED )
+        ::munmap( _data, _size );
+    }
+
+    const_iterator begin() const noexcept { return _records; }
+    const_iterator end() const noexcept { return _records + _count; }
+    size_type size() const noexcept { return _count; }
+    bool empty() const noexcept { return _count == 0; }
+
+    //! The record at position \c index in key order.
+    const_iterator nth( const size_type index ) const noexcept { return _records + index; }
+
+    //! Find the record for \c key , or return the end iterator.
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const
+    {
+      const auto compare{ []( const value_type &record, const OTHER &other ){ return std::less<>{}( key_of( record ), other ); } };
+      if ( const auto entry{ detail_n::branchless_lower_bound( begin(), _count, key, compare ) }; entry != end() && !std::less<>{}( key, key_of( *entry ) ) )
+        return entry;
+      else
+        return end();
+    }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find( key ) != end(); }
+
+    //! The mapped bytes, e.g. to check whether results point into the mapping.
+    std::span< const std::byte > bytes() const noexcept { return { static_cast< const std::byte * >( _data ), _size }; }
+
+  private:
+    static const KEY &key_of( const value_type &record ) noexcept
+    {
+      if constexpr ( std::is_void_v< VALUE > )
+        return record;
+      else
+        return record.first;
+    }
+
+    void validate( const std::filesystem::path &path )
+    {
+      const auto &header{ *static_cast< const detail_n::mapped_header * >( _data ) };
+      const auto fail{ [ &path ]( const char *reason ){ throw std::runtime_error{ "mapped_index: " + path.string() + ": " + reason }; } };
+
+      if ( std::memcmp( header.magic, detail_n::mapped_header::magic_value, sizeof( header.magic ) ) != 0 )
+        fail( "not an index file" );
+      if ( header.version != detail_n::mapped_header::current_version )
+        fail( "unsupported version" );
+      if ( header.record_size != sizeof( value_type ) || header.record_alignment != alignof( value_type ) || header.key_size != sizeof( KEY ) )
+        fail( "record type mismatch" );
+      if ( header.file_size != _size || header.records_offset % alignof( value_type ) != 0 || header.records_offset > _size
+           || header.count > ( _size - header.records_offset ) / sizeof( value_type ) )
+        fail( "corrupt layout" );
+
+      _records = reinterpret_cast< const value_type * >( static_cast< const std::byte * >( _data ) + header.records_offset );
+      _count = static_cast< size_type >( header.count );
+    }
+
+    void *_data{ MAP_FAILED };
+    std::size_t _size{ 0 };
+    const value_type *_records{ nullptr };
+    size_type _count{ 0 };
+  };
+
+  //! Memory mapped set of \c KEY .
+  template< typename KEY >
+  using mapped_set = mapped_index< KEY >;
+
+  /*!
+    \brief Collects entries, and writes them as an index file for \c mapped_index<KEY,VALUE> .
+
+    Entries may be added in any order. They are sorted when written, keeping the first entry of duplicate keys.
+    Keys and values of type \c relative_string are added as \c std::string .
+  */
+  template< typename KEY, typename VALUE = void >
+  class mapped_index_builder
+  {
+  public:
+    using key_input = detail_n::mapped_input_t< KEY >;
+    using value_input = detail_n::mapped_input_t< std::conditional_t< std::is_void_v< VALUE >, char, VALUE > >;
+
+    void reserve( const std::size_t size ) { _entries.reserve( size ); }
+
+    void add( key_input key ) requires std::is_void_v< VALUE > { _entries.push_back( { std::move( key ), {} } ); }
+    void add( key_input key, value_input value ) requires ( !std::is_void_v< VALUE > ) { _entries.push_back( { std::move( key ), std::move( value ) } ); }
+
+    std::size_t size() const noexcept { return _entries.size(); }
+
+    /*!
+      \brief Write the index to \c path .
+
+      The file is written next to \c path first, synced, and renamed to it when complete.
+      So processes that still map an older version keep using it, while new readers see the complete new version, even after a crash.
+    */
+    void write( const std::filesystem::path &path )
+    {
+      using record_t = detail_n::mapped_value_t< KEY, VALUE >;
+
+      std::stable_sort( _entries.begin(), _entries.end(), []( const entry_t &a, const entry_t &b ){ return std::less<>{}( a.key, b.key ); } );
+      _entries.erase( std::unique( _entries.begin(), _entries.end(), []( const entry_t &a, const entry_t &b ){ return !std::less<>{}( a.key, b.key ); } ), _entries.end() );
+
+      static_assert( alignof( record_t ) <= alignof( std::max_align_t ), "records must not be over aligned" );
+
+      const std::size_t records_offset{ detail_n::mapped_header::reserved_size };
+      const std::size_t strings_offset{ records_offset + _entries.size() * sizeof( record_t ) };
+      std::size_t strings_size{ 0 };
+      for ( const auto &entry : _entries )
+        strings_size += string_size( entry.key ) + string_size( entry.value );
+
+      // Lay out the file in memory, so the relative offsets of strings can be computed from addresses.
+      std::vector< std::byte > buffer( strings_offset + strings_size );
+      auto *strings{ buffer.data() + strings_offset };
+
+      auto &header{ *std::construct_at( reinterpret_cast< detail_n::mapped_header * >( buffer.data() ) ) };
+      std::memcpy( header.magic, detail_n::mapped_header::magic_value, sizeof( header.magic ) );
+      header.version = detail_n::mapped_header::current_version;
+      header.record_size = sizeof( record_t );
+      header.record_alignment = alignof( record_t );
+      header.key_size = sizeof( KEY );
+      header.count = _entries.size();
+      header.records_offset = records_offset;
+      header.file_size = buffer.size();
+
+      auto *record{ reinterpret_cast< record_t * >( buffer.data() + records_offset ) };
+      for ( const auto &entry : _entries )
+      {
+        auto &stored{ *std::construct_at( record++ ) };
+        if constexpr ( std::is_void_v< VALUE > )
+          encode( stored, entry.key, strings );
+        else
+        {
+          encode( stored.first, entry.key, strings );
+          encode( stored.second, entry.value, strings );
+        }
+      }
+
+      write_file( path, buffer );
+    }
+
+  private:
+    struct entry_t
+    {
+      key_input key;
+      value_input value;
+    };
+
+    template< typename T >
+    static std::size_t string_size( const T &input ) noexcept
+    {
+      if constexpr ( std::same_as< T, std::string > )
+        return input.size();
+      else
+        return 0;
+    }
+
+    //! Store \c input in \c field , appending string data at \c strings .
+    template< typename FIELD, typename INPUT >
+    static void encode( FIELD &field, const INPUT &input, std::byte *&strings )
+    {
+      if constexpr ( std::same_as< FIELD, relative_string > )
+      {
+        std::memcpy( strings, input.data(), input.size() );
+        field._offset = strings - reinterpret_cast< std::byte * >( &field );
+        field._size = input.size();
+        strings += input.size();
+      }
+      else
+        field = input;
+    }
+
+    //! Write \c buffer to a temporary file, sync it, and rename it to \c path . On failure, the temporary file is removed, and \c path is left as it was.
+    static void write_file( const std::filesystem::path &path, const std::vector< std::byte > &buffer )
+    {
+      auto temporary{ path };
+      temporary += ".tmp";
+
+      {
+        const detail_n::file_descriptor file{ ::open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) };
+        if ( file.get() < 0 )
+          detail_n::throw_errno( "mapped_index_builder: cannot create " + temporary.string() );
+
+        try
+        {
+          for ( std::size_t written{ 0 }; written < buffer.size(); )
+            if ( const auto result{ ::write( file.get(), buffer.data() + written, buffer.size() - written ) }; result >= 0 )
+              written += static_cast< std::size_t >( result );
+            else if ( errno != EINTR )
+              detail_n::throw_errno( "mapped_index_builder: cannot write " + temporary.string() );
+
+          // The data has to be durable before the rename, or a crash may leave an empty or partial file at path.
+          if ( ::fsync( file.get() ) != 0 )
+            detail_n::throw_errno( "mapped_index_builder: cannot sync " + temporary.string() );
+
+          if ( ::rename( temporary.c_str(), path.c_str() ) != 0 )
+            detail_n::throw_errno( "mapped_index_builder: cannot rename " + temporary.string() );
+        }
+        catch ( ... )
+        {
+          ::unlink( temporary.c_str() );
+          throw;
+        }
+      }
+
+      // Make the rename itself durable.
+      const auto directory{ path.has_parent_path() ? path.parent_path() : std::filesystem::path{ "." } };
+      const detail_n::file_descriptor parent{ ::open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) };
+      if ( parent.get() < 0 || ::fsync( parent.get() ) != 0 )
+        detail_n::throw_errno( "mapped_index_builder: cannot sync " + directory.string() );
+    }
+
+    std::vector< entry_t > _entries;
+  };
+}
@@ -5,10 +5,26 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
 #include <utility>
 
+#include "select_simd.h"
+#include "select_stats.h"
 #include "select_util.h"
 
+//! Largest static extent of a container, which \c select searches by an unrolled comparison of all its elements.
+#ifndef SELECT_N_UNROLL_LIMIT
+  #define SELECT_N_UNROLL_LIMIT 16
+#endif
+
+static_assert( SELECT_N_UNROLL_LIMIT < 64, "The matches of an unrolled search are collected in a 64 bit mask." );
+
 namespace select_n
 {
   namespace detail_n
@@ -18,9 +34,10 @@ namespace select_n
 
       A type \c MAP is like a map over another type \c KEY , if it provides a member function like \c std::map<KEY,T>::find .
       Its return type's values \c it must point to a type \c T with a member \c T::second , just like the standard map's iterators.
+      The key is passed with its value category, just like \c select passes it on.
     */
     template< typename MAP, typename KEY >
-    concept MapLike = requires( MAP map, KEY key ){ { map.find( key )->second }; };
+    concept MapLike = requires( MAP map, KEY &&key ){ { map.find( std::forward< KEY >( key ) )->second }; };
 
     /*!
       \brief Concept of Set Like Types.
@@ -29,7 +46,7 @@ namespace select_n
       Its return type's values \c it must support dereferencing, just like the standard set's iterators.
     */
     template< typename SET, typename KEY >
-    concept SetLike = requires( SET set, KEY key ){ { *set.find( key ) }; };
+    concept SetLike = requires( SET set, KEY &&key ){ { *set.find( std::forward< KEY >( key ) ) }; };
 
     /*!
       \brief Concept of General Searchable Containers.
@@ -38,6 +55,64 @@ namespace select_n
     */
     template< typename CONTAINER, typename VALUE >
     concept Searchable = requires( CONTAINER container, VALUE value ){ { *std::find( container.begin(), container.end(), value ) }; };
+
+    /*!
+      \brief Concept of Hash Maps accepting a precomputed hash.
+
+      A type \c MAP is a hashed map over another type \c KEY , if it provides a member function \c find , which takes a key and its hash.
+      Its return type's values \c it must point to a type \c T with a member \c T::second , just like for \c MapLike types.
+    */
+    template< typename MAP, typename KEY >
+    concept HashedMapLike = requires( MAP map, KEY key, std::size_t hash ){ { map.find( key, hash )->second }; };
+
+    //! Number of elements of a container with a size fixed at compile time, like \c std::array or \c std::span with a static extent, or \c 0 otherwise.
+    template< typename CONTAINER >
+    inline constexpr std::size_t static_extent_v{ 0 };
+    template< typename T, std::size_t N >
+    inline constexpr std::size_t static_extent_v< std::array< T, N > >{ N };
+    template< typename T, std::size_t N > requires ( N != std::dynamic_extent )
+    inline constexpr std::size_t static_extent_v< std::span< T, N > >{ N };
+
+    /*!
+      \brief Concept of containers searched by an unrolled comparison of all their elements.
+
+      A type \c CONTAINER is unrollable for another type \c VALUE , if it has a static extent of at most \c SELECT_N_UNROLL_LIMIT elements.
+      Both its elements and \c VALUE have to be scalars, so comparing all elements is cheap and free of side effects.
+    */
+    template< typename CONTAINER, typename VALUE >
+    concept Unrollable = ( static_extent_v< std::remove_cv_t< CONTAINER > > > 0 ) && ( static_extent_v< std::remove_cv_t< CONTAINER > > <= SELECT_N_UNROLL_LIMIT )
+                         && std::is_scalar_v< std::remove_cvref_t< decltype( *std::declval< CONTAINER & >().data() ) > >
+                         && std::is_scalar_v< std::remove_cvref_t< VALUE > >
+                         && requires( CONTAINER &container, const VALUE &value ){ { container.data()[ 0 ] == value } -> std::convertible_to< bool >; };
+
+    //! Index of the first element of \c data equal to \c value , or the number of elements if there is none. All elements are compared, and the matches collected in a bit mask.
+    template< typename T, typename VALUE, std::size_t... INDICES >
+    constexpr std::size_t unrolled_find_index( const T *data, const VALUE &value, std::index_sequence< INDICES... > ) noexcept
+    {
+      // A sentinel bit past the last element stands for a miss.
+      constexpr std::uint64_t sentinel{ std::uint64_t{ 1 } << sizeof...( INDICES ) };
+
+#ifdef SELECT_N_SIMD_X86
+      if constexpr ( SimdComparable< std::remove_cv_t< T > > && std::same_as< std::remove_cv_t< T >, std::remove_cvref_t< VALUE > > )
+        if ( !std::is_constant_evaluated() )
+          // Plain integers -> compare whole registers at once.
+          return static_cast< std::size_t >( std::countr_zero( sse2_unrolled_matches< std::remove_cv_t< T >, sizeof...( INDICES ) >( data, value ) | sentinel ) );
+#endif
+
+      // Select each bit by a mask, rather than shifting a flag, which GCC turns back into a branch for the last element.
+      const std::uint64_t matches{ ( ( ( std::uint64_t{ 0 } - static_cast< std::uint64_t >( data[ INDICES ] == value ) ) & ( std::uint64_t{ 1 } << INDICES ) ) | ... | sentinel ) };
+      return static_cast< std::size_t >( std::countr_zero( matches ) );
+    }
+
+    //! Return \c entry if \c valid , or \c nullptr otherwise, by masking the address instead of branching.
+    template< typename T >
+    constexpr T *mask_pointer( T *entry, const bool valid ) noexcept
+    {
+      if ( std::is_constant_evaluated() )
+        return valid ? entry : nullptr;
+      else
+        return reinterpret_cast< T * >( reinterpret_cast< std::uintptr_t >( entry ) & ( std::uintptr_t{ 0 } - std::uintptr_t{ valid } ) );
+    }
   }
 
   /*!
@@ -45,16 +120,20 @@ namespace select_n
 
     If \c map has an entry associated to \c key , it is returned by pointer.
     If \c key is missing from \c map, a \c nullptr is returned, instead.
+
+    \c key is passed on to \c find as it is, so maps with a transparent comparator or hash, like \c std::map<std::string,T,std::less<>> , look up
+    e.g. a \c std::string_view or a string literal without constructing a temporary key.
   */
   template< typename MAP, typename KEY > requires detail_n::MapLike< MAP, KEY >
-  auto select( MAP &map, KEY &&key ) -> decltype( &map.find( key )->second )
+  constexpr auto select( MAP &map, KEY &&key SELECT_N_LOCATION_PARAMETER ) -> decltype( &map.find( std::forward< KEY >( key ) )->second )
   {
+    SELECT_N_PROBE( "select" );
     if ( const auto entry{ map.find( std::forward< KEY >( key ) ) }; entry != map.end() )
       // Key exists -> return pointer to mapped value.
-      return &entry->second;
+      return SELECT_N_HIT( &entry->second );
     else
       // Key missing -> return nullptr.
-      return nullptr;
+      return SELECT_N_MISS( nullptr );
   }
 
   /*!
@@ -62,16 +141,18 @@ namespace select_n
 
     If \c set has an entry similar to \c key , it is returned by pointer.
     If \c key is missing from \c set, a \c nullptr is returned, instead.
+    Like for maps, \c key is passed on to \c find as it is.
   */
   template< typename SET, typename KEY > requires ( detail_n::SetLike< SET, KEY > && !detail_n::MapLike< SET, KEY > )
-  auto select( SET &set, KEY &&key ) -> decltype( &*set.find( key) )
+  constexpr auto select( SET &set, KEY &&key SELECT_N_LOCATION_PARAMETER ) -> decltype( &*set.find( std::forward< KEY >( key ) ) )
   {
+    SELECT_N_PROBE( "select" );
     if ( const auto entry{ set.find( std::forward< KEY >( key ) ) }; entry != set.end() )
       // Key exists -> return pointer to value.
-      return &*entry;
+      return SELECT_N_HIT( &*entry );
     else
       // Key missing -> return nullptr.
-      return nullptr;
+      return SELECT_N_MISS( nullptr );
   }
 
   /*!
@@ -79,15 +160,91 @@ namespace select_n
 
     If \c container has an entry similar to \c value , it is returned by pointer.
     If \c value is missing from \c container, a \c nullptr is returned, instead.
+
+    Contiguous containers of integral values are searched with SIMD instructions, if available.
   */
-  template< typename CONTAINER, typename VALUE > requires ( detail_n::Searchable< CONTAINER, VALUE > && !detail_n::SetLike< CONTAINER, VALUE > )
-  auto select( CONTAINER &container, VALUE &&value ) -> decltype( &*std::find( container.begin(), container.end(), value ) )
+  template< typename CONTAINER, typename VALUE > requires ( detail_n::Searchable< CONTAINER, VALUE > && !detail_n::SetLike< CONTAINER, VALUE > && !detail_n::Unrollable< CONTAINER, VALUE > )
+  constexpr auto select( CONTAINER &container, VALUE &&value SELECT_N_LOCATION_PARAMETER ) -> decltype( &*std::find( container.begin(), container.end(), value ) )
   {
+    SELECT_N_PROBE( "select" );
+    if constexpr ( detail_n::SimdSearchable< CONTAINER, VALUE > )
+      if ( !std::is_constant_evaluated() )
+      {
+        // Plain integers in contiguous memory -> vectorized search.
+        const auto entry{ detail_n::simd_find( container, value ) };
+        return entry ? SELECT_N_HIT( entry ) : SELECT_N_MISS( entry );
+      }
+
     if ( const auto entry{ std::find( container.begin(), container.end(), std::forward< VALUE >( value ) ) }; entry != container.end() )
       // Value exists -> return by pointer.
-      return &*entry;
+      return SELECT_N_HIT( &*entry );
     else
       // Value missing -> return nullptr.
-      return nullptr;
+      return SELECT_N_MISS( nullptr );
+  }
+
+  /*!
+    \brief Select an entry from a small container of static size.
+
+    Like \c select for generic containers, but for \c std::array and \c std::span of scalars with a static extent up to \c SELECT_N_UNROLL_LIMIT .
+    All elements are compared to \c value in an unrolled sequence, by SSE2 registers for integers, and the first match is taken from the resulting bit mask.
+    A miss yields the index past the end, which masks the pointer to \c nullptr .
+    So the lookup has no branches depending on the data, which cannot be mispredicted. It can be evaluated at compile time, too.
+  */
+  template< typename CONTAINER, typename VALUE > requires detail_n::Unrollable< CONTAINER, VALUE >
+  constexpr auto select( CONTAINER &container, VALUE &&value SELECT_N_LOCATION_PARAMETER ) -> decltype( &*container.data() )
+  {
+    SELECT_N_PROBE( "select" );
+    constexpr auto size{ detail_n::static_extent_v< std::remove_cv_t< CONTAINER > > };
+    const auto index{ detail_n::unrolled_find_index( container.data(), value, std::make_index_sequence< size >{} ) };
+    // Index past the end -> nullptr, by masking the address rather than a branch.
+    const bool found{ index < size };
+    return SELECT_N_HIT_IF( found, detail_n::mask_pointer( container.data() + index, found ) );
+  }
+
+  /*!
+    \brief Select an entry from a hash map, by a hash computed beforehand.
+
+    Like \c select , but \c map does not hash \c key again.
+    \c hash has to be the result of the map's hash function for \c key , e.g. \c key_hash<KEY>{}( key ) .
+    Thus, a hash computed once can be reused for lookups in several maps with the same hash function.
+  */
+  template< typename MAP, typename KEY > requires detail_n::HashedMapLike< MAP, KEY >
+  constexpr auto select_hashed( MAP &map, KEY &&key, const std::size_t hash SELECT_N_LOCATION_PARAMETER ) -> decltype( &map.find( key, hash )->second )
+  {
+    SELECT_N_PROBE( "select_hashed" );
+    if ( const auto entry{ map.find( std::forward< KEY >( key ), hash ) }; entry != map.end() )
+      // Key exists -> return pointer to mapped value.
+      return SELECT_N_HIT( &entry->second );
+    else
+      // Key missing -> return nullptr.
+      return SELECT_N_MISS( nullptr );
+  }
+
+  /*!
+    \brief Select an entry from a container, which does not take a precomputed hash.
+
+    \c hash is ignored, and the entry is selected by \c select .
+    So lookups of a hashed key may mix hash maps with other containers.
+  */
+  template< typename CONTAINER, typename KEY > requires ( !detail_n::HashedMapLike< CONTAINER, KEY > && requires( CONTAINER &container, KEY &&key ){ select( container, std::forward< KEY >( key ) ); } )
+  constexpr auto select_hashed( CONTAINER &container, KEY &&key, std::size_t SELECT_N_LOCATION_PARAMETER )
+  {
+    return select( container, std::forward< KEY >( key ) SELECT_N_LOCATION_ARGUMENT );
+  }
+
+  namespace detail_n
+  {
+    /*!
+      \brief Concept of containers, which \c select returns a plain pointer for.
+
+      Only a pointer stays valid beyond the lookup, e.g. to descend into the entry, or to pass it on as result of a lookup in several containers.
+      A handle, as selected from concurrent containers, releases its entry when it is destroyed.
+    */
+    template< typename CONTAINER, typename KEY >
+    concept PointerSelectable = requires( CONTAINER &container, KEY &&key )
+    {
+      requires std::is_pointer_v< decltype( select( container, std::forward< KEY >( key ) ) ) >;
+    };
   }
 }
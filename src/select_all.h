@@ -0,0 +1,109 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Concept of predicates, which can select elements from a range \c RANGE .
+    template< typename PREDICATE, typename RANGE >
+    concept RangePredicate = std::ranges::input_range< RANGE > && std::indirect_unary_predicate< const std::remove_cvref_t< PREDICATE >, std::ranges::iterator_t< RANGE > >;
+
+    /*!
+      \brief Concept of containers with several entries per key, like \c std::multimap .
+
+      A type \c CONTAINER provides all entries for a \c KEY by a member function like \c std::multimap::equal_range .
+    */
+    template< typename CONTAINER, typename KEY >
+    concept EqualRangeable = requires( CONTAINER &container, const KEY &key )
+    {
+      requires std::input_iterator< decltype( container.equal_range( key ).first ) >;
+      requires std::sentinel_for< decltype( container.equal_range( key ).second ), decltype( container.equal_range( key ).first ) >;
+    };
+
+    //! Mapped value of a map entry, by reference.
+    struct second_of
+    {
+      template< typename ENTRY >
+      constexpr decltype( auto ) operator()( ENTRY &&entry ) const noexcept { return ( std::forward< ENTRY >( entry ).second ); }
+    };
+
+    /*!
+      \brief Range adaptor closure of \c views::select_all .
+
+      It holds the predicate, and applies \c select_all to any range piped into it.
+    */
+    template< typename PREDICATE >
+    struct select_all_closure
+    {
+      PREDICATE predicate;
+
+      template< std::ranges::viewable_range RANGE > requires RangePredicate< PREDICATE, RANGE >
+      friend constexpr auto operator|( RANGE &&range, const select_all_closure &closure )
+      {
+        return std::views::filter( std::forward< RANGE >( range ), closure.predicate );
+      }
+
+      template< std::ranges::viewable_range RANGE > requires RangePredicate< PREDICATE, RANGE >
+      friend constexpr auto operator|( RANGE &&range, select_all_closure &&closure )
+      {
+        return std::views::filter( std::forward< RANGE >( range ), std::move( closure.predicate ) );
+      }
+    };
+  }
+
+  /*!
+    \brief Select all elements from a container, which satisfy a predicate.
+
+    Unlike \c select_if , which returns the first match only, all matches are provided as a lazy view.
+    Elements are tested while iterating the view, and yielded by reference, so nothing is copied, and stopping early skips the remaining tests.
+    The view composes with other range adaptors, e.g. \c std::views::take .
+    A \c container passed as rvalue is moved into the view.
+  */
+  template< std::ranges::viewable_range CONTAINER, typename PREDICATE > requires detail_n::RangePredicate< PREDICATE, CONTAINER >
+  constexpr auto select_all( CONTAINER &&container, PREDICATE &&predicate )
+  {
+    return std::views::filter( std::forward< CONTAINER >( container ), std::forward< PREDICATE >( predicate ) );
+  }
+
+  /*!
+    \brief Select all entries for a key from a container with several entries per key.
+
+    The entries found by \c equal_range are provided as a view, without any copy.
+    Like for \c select , maps yield the mapped values, while sets yield the values themselves.
+  */
+  template< typename CONTAINER, typename KEY > requires ( detail_n::EqualRangeable< CONTAINER, KEY > && !detail_n::RangePredicate< KEY, CONTAINER & > )
+  constexpr auto select_all( CONTAINER &container, const KEY &key )
+  {
+    const auto [ first, last ]{ container.equal_range( key ) };
+    const std::ranges::subrange entries{ first, last };
+    if constexpr ( requires { first->second; } )
+      // Map -> mapped values.
+      return std::views::transform( entries, detail_n::second_of{} );
+    else
+      // Set -> values.
+      return entries;
+  }
+
+  namespace views
+  {
+    /*!
+      \brief Range adaptor for \c select_all .
+
+      <tt>range | views::select_all( predicate )</tt> is the same as <tt>select_all( range, predicate )</tt>.
+    */
+    template< typename PREDICATE >
+    constexpr detail_n::select_all_closure< std::decay_t< PREDICATE > > select_all( PREDICATE &&predicate )
+    {
+      return { std::forward< PREDICATE >( predicate ) };
+    }
+  }
+}
@@ -0,0 +1,229 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "select_simd.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Number of rows evaluated at once by a columnar scan, i.e. the bits of a match mask.
+    inline constexpr std::size_t scan_block_size{ 64 };
+
+    //! Common base of all predicate expressions, to tell them from opaque callables.
+    struct expression_base {};
+
+    //! Concept of predicate expressions, as built from \c field .
+    template< typename EXPRESSION >
+    concept Expression = std::derived_from< std::remove_cvref_t< EXPRESSION >, expression_base >;
+
+    /*!
+      \brief Pack the 0/1 bytes in \c matches into a bit mask of a full block.
+
+      Bit \c i is set if \c matches[i] is set.
+    */
+    inline std::uint64_t pack_block_mask( const unsigned char *matches ) noexcept
+    {
+      std::uint64_t mask{ 0 };
+#ifdef SELECT_N_SIMD_X86
+      for ( std::size_t chunk{ 0 }; chunk < scan_block_size / 16; ++chunk )
+      {
+        // Shift the low bit of each byte to its sign bit, which movemask collects.
+        const auto bytes{ _mm_loadu_si128( reinterpret_cast< const __m128i * >( matches + 16 * chunk ) ) };
+        mask |= static_cast< std::uint64_t >( static_cast< unsigned >( _mm_movemask_epi8( _mm_slli_epi16( bytes, 7 ) ) ) ) << ( 16 * chunk );
+      }
+#else
+      for ( std::size_t index{ 0 }; index < scan_block_size; ++index )
+        mask |= static_cast< std::uint64_t >( matches[ index ] ) << index;
+#endif
+      return mask;
+    }
+
+    //! Mask of the first \c count rows of a block.
+    constexpr std::uint64_t block_mask( const std::size_t count ) noexcept
+    {
+      return count < scan_block_size ? ( std::uint64_t{ 1 } << count ) - 1 : ~std::uint64_t{ 0 };
+    }
+
+    /*!
+      \brief Comparison of a column to a constant, bound to the column's data.
+
+      Full blocks compare all rows into a byte array first. The loop has a fixed trip count and no branches, so the compiler vectorizes it.
+    */
+    template< typename T, typename VALUE, typename COMPARE >
+    struct bound_comparison
+    {
+      const T *column;
+      VALUE value;
+
+      std::uint64_t match( const std::size_t first, const std::size_t count ) const noexcept
+      {
+        const auto *data{ column + first };
+        if ( count == scan_block_size )
+        {
+          // Full block -> vectorized comparison, then pack the results.
+          alignas( 16 ) unsigned char matches[ scan_block_size ];
+          for ( std::size_t index{ 0 }; index < scan_block_size; ++index )
+            matches[ index ] = static_cast< unsigned char >( COMPARE{}( data[ index ], value ) );
+          return pack_block_mask( matches );
+        }
+        else
+        {
+          // Tail -> scalar loop.
+          std::uint64_t mask{ 0 };
+          for ( std::size_t index{ 0 }; index < count; ++index )
+            mask |= static_cast< std::uint64_t >( COMPARE{}( data[ index ], value ) ) << index;
+          return mask;
+        }
+      }
+    };
+
+    //! Conjunction of two bound expressions. The right side is skipped for blocks without any match on the left.
+    template< typename LEFT, typename RIGHT >
+    struct bound_and
+    {
+      LEFT left;
+      RIGHT right;
+
+      std::uint64_t match( const std::size_t first, const std::size_t count ) const noexcept
+      {
+        const auto mask{ left.match( first, count ) };
+        return mask ? mask & right.match( first, count ) : 0;
+      }
+    };
+
+    //! Disjunction of two bound expressions. The right side is skipped for blocks matching entirely on the left.
+    template< typename LEFT, typename RIGHT >
+    struct bound_or
+    {
+      LEFT left;
+      RIGHT right;
+
+      std::uint64_t match( const std::size_t first, const std::size_t count ) const noexcept
+      {
+        const auto mask{ left.match( first, count ) };
+        return mask == block_mask( count ) ? mask : mask | right.match( first, count );
+      }
+    };
+
+    //! Negation of a bound expression.
+    template< typename OPERAND >
+    struct bound_not
+    {
+      OPERAND operand;
+
+      std::uint64_t match( const std::size_t first, const std::size_t count ) const noexcept
+      {
+        return ~operand.match( first, count ) & block_mask( count );
+      }
+    };
+
+    /*!
+      \brief Comparison of a record's field to a constant.
+
+      It is a predicate on records, and can be bound to the columns of a \c column_table for a columnar scan.
+    */
+    template< typename RECORD, typename T, typename VALUE, typename COMPARE >
+    struct comparison_expression : expression_base
+    {
+      T RECORD::*member;
+      VALUE value;
+
+      constexpr bool operator()( const RECORD &record ) const { return COMPARE{}( record.*member, value ); }
+
+      template< typename TABLE >
+      bound_comparison< T, VALUE, COMPARE > bind( const TABLE &table ) const { return { table.column_data( member ), value }; }
+    };
+
+    //! Conjunction of two expressions.
+    template< typename LEFT, typename RIGHT >
+    struct and_expression : expression_base
+    {
+      LEFT left;
+      RIGHT right;
+
+      template< typename RECORD >
+      constexpr bool operator()( const RECORD &record ) const { return left( record ) && right( record ); }
+
+      template< typename TABLE >
+      auto bind( const TABLE &table ) const { return bound_and< decltype( left.bind( table ) ), decltype( right.bind( table ) ) >{ left.bind( table ), right.bind( table ) }; }
+    };
+
+    //! Disjunction of two expressions.
+    template< typename LEFT, typename RIGHT >
+    struct or_expression : expression_base
+    {
+      LEFT left;
+      RIGHT right;
+
+      template< typename RECORD >
+      constexpr bool operator()( const RECORD &record ) const { return left( record ) || right( record ); }
+
+      template< typename TABLE >
+      auto bind( const TABLE &table ) const { return bound_or< decltype( left.bind( table ) ), decltype( right.bind( table ) ) >{ left.bind( table ), right.bind( table ) }; }
+    };
+
+    //! Negation of an expression.
+    template< typename OPERAND >
+    struct not_expression : expression_base
+    {
+      OPERAND operand;
+
+      template< typename RECORD >
+      constexpr bool operator()( const RECORD &record ) const { return !operand( record ); }
+
+      template< typename TABLE >
+      auto bind( const TABLE &table ) const { return bound_not< decltype( operand.bind( table ) ) >{ operand.bind( table ) }; }
+    };
+
+    //! Field of a record, which can be compared to a constant to build an expression.
+    template< typename RECORD, typename T >
+    struct field_reference
+    {
+      T RECORD::*member;
+
+      template< typename COMPARE, typename VALUE >
+      constexpr comparison_expression< RECORD, T, std::decay_t< VALUE >, COMPARE > compare( VALUE &&value ) const { return { {}, member, std::forward< VALUE >( value ) }; }
+
+      template< typename VALUE > constexpr auto operator==( VALUE &&value ) const { return compare< std::equal_to<> >( std::forward< VALUE >( value ) ); }
+      template< typename VALUE > constexpr auto operator!=( VALUE &&value ) const { return compare< std::not_equal_to<> >( std::forward< VALUE >( value ) ); }
+      template< typename VALUE > constexpr auto operator<( VALUE &&value ) const { return compare< std::less<> >( std::forward< VALUE >( value ) ); }
+      template< typename VALUE > constexpr auto operator<=( VALUE &&value ) const { return compare< std::less_equal<> >( std::forward< VALUE >( value ) ); }
+      template< typename VALUE > constexpr auto operator>( VALUE &&value ) const { return compare< std::greater<> >( std::forward< VALUE >( value ) ); }
+      template< typename VALUE > constexpr auto operator>=( VALUE &&value ) const { return compare< std::greater_equal<> >( std::forward< VALUE >( value ) ); }
+    };
+
+    template< Expression LEFT, Expression RIGHT >
+    constexpr and_expression< std::remove_cvref_t< LEFT >, std::remove_cvref_t< RIGHT > > operator&&( LEFT &&left, RIGHT &&right ) { return { {}, std::forward< LEFT >( left ), std::forward< RIGHT >( right ) }; }
+
+    template< Expression LEFT, Expression RIGHT >
+    constexpr or_expression< std::remove_cvref_t< LEFT >, std::remove_cvref_t< RIGHT > > operator||( LEFT &&left, RIGHT &&right ) { return { {}, std::forward< LEFT >( left ), std::forward< RIGHT >( right ) }; }
+
+    template< Expression OPERAND >
+    constexpr not_expression< std::remove_cvref_t< OPERAND > > operator!( OPERAND &&operand ) { return { {}, std::forward< OPERAND >( operand ) }; }
+  }
+
+  /*!
+    \brief Refer to a field of a record, to build a predicate expression.
+
+    Comparing the field to a constant, e.g. <tt>field( &record::price ) < 10</tt>, yields an expression,
+    which can be combined with \c && , \c || and \c ! , like <tt>field( &record::price ) < 10 && field( &record::quantity ) == 0</tt>.
+    An expression is a plain predicate on records, usable with \c select_if on any container of records.
+    On a \c column_table , \c select_if and \c select_all evaluate it by scanning the columns in blocks instead, which the compiler vectorizes.
+  */
+  template< typename RECORD, typename T >
+  constexpr detail_n::field_reference< RECORD, T > field( T RECORD::*member ) noexcept
+  {
+    return { member };
+  }
+}
@@ -0,0 +1,52 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+namespace select_n
+{
+  /*!
+    \brief Result of \c select on a concurrent container.
+
+    Like the pointer returned by \c select on other containers, a handle points to the selected entry, or to nothing if the key is missing.
+    In addition, it holds a \c GUARD that keeps the entry alive, while other threads modify the container.
+    Hence, a handle should be released soon, and must not outlive its container.
+
+    Handles can be moved, but not copied.
+    The guard may be bound to the thread, which selected the entry, like the \c epoch_guard of \c concurrent_map , so handles must not be passed to other threads.
+  */
+  template< typename T, typename GUARD >
+  class select_handle
+  {
+  public:
+    using element_type = T;
+
+    select_handle() = default;
+    select_handle( GUARD guard, T *entry ) noexcept : _guard{ std::move( guard ) }, _entry{ entry } {}
+
+    select_handle( select_handle &&other ) noexcept : _guard{ std::move( other._guard ) }, _entry{ std::exchange( other._entry, nullptr ) } {}
+
+    select_handle &operator=( select_handle &&other ) noexcept
+    {
+      _guard = std::move( other._guard );
+      _entry = std::exchange( other._entry, nullptr );
+      return *this;
+    }
+
+    explicit operator bool() const noexcept { return _entry != nullptr; }
+
+    T &operator*() const noexcept { return *_entry; }
+    T *operator->() const noexcept { return _entry; }
+    T *get() const noexcept { return _entry; }
+
+    friend bool operator==( const select_handle &handle, std::nullptr_t ) noexcept { return handle._entry == nullptr; }
+
+  private:
+    GUARD _guard{};
+    T *_entry{ nullptr };
+  };
+}
@@ -5,7 +5,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
+#include "select_stats.h"
 #include "select_util.h"
 
 namespace select_n
@@ -15,6 +20,17 @@ namespace select_n
     //! Deduce the value type of \c std::find_if with \c CONTAINER and \c PREDICATE .
     template< typename CONTAINER, typename PREDICATE >
     using find_if_value_t = std::remove_reference_t< decltype( *std::find_if( std::declval< CONTAINER >().begin(), std::declval< CONTAINER >().end(), std::declval< PREDICATE >() ) ) >;
+
+    //! Store \c element in \c found , if no earlier element matched \c predicate , but \c element does.
+    template< typename ELEMENT, typename VALUE, typename PREDICATE >
+    constexpr void match_unresolved( ELEMENT &element, VALUE *&found, PREDICATE &predicate, std::size_t &unresolved )
+    {
+      if ( !found && predicate( element ) )
+      {
+        found = &element;
+        --unresolved;
+      }
+    }
   }
 
   /*!
@@ -24,14 +40,35 @@ namespace select_n
     Otherwise, a \c nullptr is returned.
   */
   template< typename CONTAINER, typename PREDICATE >
-  detail_n::find_if_value_t< CONTAINER, PREDICATE > *
-  select_if( CONTAINER &container, PREDICATE &&predicate )
+  constexpr detail_n::find_if_value_t< CONTAINER, PREDICATE > *
+  select_if( CONTAINER &container, PREDICATE &&predicate SELECT_N_LOCATION_PARAMETER )
   {
+    SELECT_N_PROBE( "select_if" );
     if ( const auto entry{ std::find_if( container.begin(), container.end(), std::forward< PREDICATE >( predicate ) ) }; entry != container.end() )
       // Element found -> return by pointer.
-      return &*entry;
+      return SELECT_N_HIT( &*entry );
     else
       // Nothing found -> return nullptr.
-      return nullptr;
+      return SELECT_N_MISS( nullptr );
+  }
+
+  /*!
+    \brief Select the first element matching each of several predicates, in a single pass over a container.
+
+    Like a \c select_if per predicate, but \c container is walked only once, instead of once per predicate.
+    Each element is tested only against the predicates, which no earlier element matched, and the walk stops as soon as all of them matched.
+    The results are returned as a tuple of pointers in the order of \c predicates , holding a \c nullptr for each predicate without a match.
+    With \c SELECT_N_STATS , all calls are recorded under a single site in this function, because a call site cannot follow the predicates. A call counts as hit, if every predicate matched.
+  */
+  template< typename CONTAINER, typename... PREDICATES > requires ( sizeof...( PREDICATES ) > 0 )
+  constexpr std::tuple< detail_n::find_if_value_t< CONTAINER, PREDICATES > *... >
+  select_if_each( CONTAINER &container, PREDICATES &&... predicates )
+  {
+    SELECT_N_FUNCTION_PROBE( "select_if_each" );
+    std::tuple< detail_n::find_if_value_t< CONTAINER, PREDICATES > *... > found{};
+    std::size_t unresolved{ sizeof...( PREDICATES ) };
+    for ( auto entry{ container.begin() }; unresolved != 0 && entry != container.end(); ++entry )
+      std::apply( [ & ]( auto *&... results ){ ( detail_n::match_unresolved( *entry, results, predicates, unresolved ), ... ); }, found );
+    return SELECT_N_HIT_IF( unresolved == 0, found );
   }
 }
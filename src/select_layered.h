@@ -0,0 +1,78 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "select.h"
+#include "select_or_default.h"
+#include "select_stats.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Pointer type returned by \c select_first for \c KEY on \c CONTAINERS , i.e. the common type of the pointers selected from each layer.
+    template< typename KEY, typename... CONTAINERS >
+    using select_first_result_t = std::common_type_t< decltype( select( std::declval< CONTAINERS & >(), std::declval< const KEY & >() ) )... >;
+
+    /*!
+      \brief Concept of layers of containers, which can be searched for \c KEY in order.
+
+      Each container has to return a plain pointer from \c select , and all those pointers need a common type, e.g. \c const \c T* for \c T* and \c const \c T* .
+    */
+    template< typename KEY, typename... CONTAINERS >
+    concept Layered = ( sizeof...( CONTAINERS ) > 0 ) && ( PointerSelectable< CONTAINERS, const KEY & > && ... ) && requires { typename select_first_result_t< KEY, CONTAINERS... >; };
+
+    //! Select \c key from the first of \c containers that has it, like \c select_first .
+    template< typename KEY, typename... CONTAINERS >
+    constexpr select_first_result_t< KEY, CONTAINERS... > select_first_layer( const KEY &key, CONTAINERS &... containers )
+    {
+      select_first_result_t< KEY, CONTAINERS... > entry{ nullptr };
+      // The fold stops at the first layer which has an entry.
+      ( ( entry = select( containers, key ) ) || ... );
+      return entry;
+    }
+  }
+
+  /*!
+    \brief Select an entry from the first of several containers that has one.
+
+    The containers are searched for \c key in order, each by its matching \c select overload, so they may be of different types.
+    The first entry found is returned by pointer, and the remaining containers are not searched at all.
+    If \c key is missing from all containers, a \c nullptr is returned.
+    Thus layers of overrides and defaults can be looked up without merging them, and a lookup probes each layer at most once.
+    With \c SELECT_N_STATS , all calls are recorded under a single site in this function, because a call site cannot follow the containers.
+  */
+  template< typename KEY, typename... CONTAINERS > requires detail_n::Layered< KEY, CONTAINERS... >
+  constexpr detail_n::select_first_result_t< KEY, CONTAINERS... > select_first( const KEY &key, CONTAINERS &... containers )
+  {
+    SELECT_N_FUNCTION_PROBE( "select_first" );
+    const auto entry{ detail_n::select_first_layer( key, containers... ) };
+    return SELECT_N_HIT_IF( entry, entry );
+  }
+
+  /*!
+    \brief Select an entry from the first of several containers that has one, or return a default value.
+
+    Like \c select_or_default , but the entry is selected by \c select_first , so \c def comes before the containers.
+    The result is returned as reference if \c def is a reference, adding a const if any of the containers or \c def is const.
+    A \c def of another type, which has to be converted, is returned by value, instead.
+    With \c SELECT_N_STATS , all calls are recorded under a single site in this function, like for \c select_first .
+  */
+  template< typename KEY, typename DEFAULT, typename CONTAINER, typename... CONTAINERS > requires detail_n::Layered< KEY, CONTAINER, CONTAINERS... >
+  constexpr typename detail_n::find_or_default_result_c< CONTAINER &, detail_n::select_first_result_t< KEY, CONTAINER, CONTAINERS... >, DEFAULT >::type
+  select_or_default_layered( const KEY &key, DEFAULT &&def, CONTAINER &container, CONTAINERS &... containers )
+  {
+    SELECT_N_FUNCTION_PROBE( "select_or_default_layered" );
+    if ( const auto existing{ detail_n::select_first_layer( key, container, containers... ) } )
+      // Key exists in any layer -> return value.
+      return SELECT_N_HIT( *existing );
+    else
+      // Key missing from all layers -> return the default value.
+      return SELECT_N_DEFAULT( std::forward< DEFAULT >( def ) );
+  }
+}
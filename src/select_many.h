@@ -0,0 +1,247 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+
+#include "select.h"
+#include "select_sorted.h"
+#include "select_stats.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Number of lookups that are interleaved to overlap their memory latencies.
+    inline constexpr std::size_t batch_size{ 16 };
+
+    /*!
+      \brief Concept of containers with a sorted layout of their keys.
+
+      A container like \c flat_map or \c sorted_view exposes its sorted keys by \c keys() , their order by \c key_comp() , and the entry at a position by \c nth() .
+      Lookups in such containers can be interleaved without knowing their internals.
+    */
+    template< typename CONTAINER >
+    concept SortedLayout = requires( CONTAINER &container, std::size_t index )
+    {
+      { container.keys().begin() } -> std::random_access_iterator;
+      { container.keys().size() } -> std::convertible_to< std::size_t >;
+      container.key_comp();
+      container.nth( index );
+    };
+
+    /*!
+      \brief Concept of containers which can prefetch the memory a lookup for \c KEY will touch.
+
+      Containers like hash tables know where a key will be found before actually looking at it.
+      The member functions \c hash( key ) and \c prefetch_hashed( hash ) allow to issue those loads for a whole batch of keys ahead of the lookups.
+      The hashes are then passed on to \c select_hashed , so each key is hashed only once.
+    */
+    template< typename CONTAINER, typename KEY >
+    concept Prefetchable = requires( CONTAINER &container, const KEY &key, const std::size_t hash )
+    {
+      { container.hash( key ) } -> std::convertible_to< std::size_t >;
+      container.prefetch_hashed( hash );
+    };
+
+    /*!
+      \brief Concept of hash containers with a bucket interface, like \c std::unordered_map .
+
+      The bucket of a key can be computed without touching the table, and \c begin( bucket ) loads only the table's slot for it.
+      Doing so for a whole batch of keys before comparing any of them lets their cache misses overlap.
+      \c bucket( key ) has no heterogeneous overload, though, so other keys would be converted to a temporary \c key_type .
+      Thus only keys of the \c key_type itself qualify, and others are looked up by \c select .
+    */
+    template< typename CONTAINER, typename KEY >
+    concept BucketLayout = std::same_as< std::remove_cvref_t< KEY >, typename std::remove_cvref_t< CONTAINER >::key_type > && requires( CONTAINER &container, const KEY &key, std::size_t bucket )
+    {
+      { container.bucket( key ) } -> std::convertible_to< std::size_t >;
+      { container.begin( bucket ) != container.end( bucket ) } -> std::convertible_to< bool >;
+      container.key_eq();
+    };
+
+    //! Pointer type returned by \c select on \c CONTAINER for keys of \c KEYS .
+    template< typename CONTAINER, typename KEYS >
+    using select_many_result_t = decltype( select( std::declval< CONTAINER & >(), *std::ranges::begin( std::declval< KEYS & >() ) ) );
+
+    /*!
+      \brief Run binary searches for the \c count keys at \c keys in lock step.
+
+      All searches on the same range take the same number of steps.
+      Each step prefetches the next probe of a search, which is then needed only after the steps of all other searches.
+      The resulting lower bounds are stored as indices in \c bounds .
+    */
+    template< typename DATA, typename KEY_ITERATOR, typename COMPARE >
+    void interleaved_lower_bound( const DATA data, const std::size_t size, const std::array< KEY_ITERATOR, batch_size > &keys, const std::size_t count, const COMPARE &compare, std::array< std::size_t, batch_size > &bounds )
+    {
+      bounds.fill( 0 );
+      if ( size == 0 )
+        return;
+
+      for ( auto remaining{ size }; remaining > 1; )
+      {
+        const auto half{ remaining / 2 };
+        remaining -= half;
+        for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+        {
+          auto &bound{ bounds[ lookup ] };
+          bound = compare( data[ bound + half ], *keys[ lookup ] ) ? bound + half : bound;
+          prefetch( &data[ bound + remaining / 2 ] );
+        }
+      }
+
+      for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+        bounds[ lookup ] += compare( data[ bounds[ lookup ] ], *keys[ lookup ] );
+    }
+
+    /*!
+      \brief Select the entries for all \c keys from \c container , and pass each result to \c consume in order.
+
+      Lookups are done in batches, using the best strategy for overlapping them the container supports.
+    */
+    template< typename CONTAINER, std::ranges::forward_range KEYS, typename CONSUMER >
+    void select_batches( CONTAINER &container, KEYS &keys, CONSUMER &&consume )
+    {
+      using key_iterator = std::ranges::iterator_t< KEYS & >;
+      using key_t = std::ranges::range_reference_t< KEYS & >;
+
+      std::array< key_iterator, batch_size > batch{};
+      auto next{ std::ranges::begin( keys ) };
+      const auto last{ std::ranges::end( keys ) };
+
+      while ( next != last )
+      {
+        // Collect the next batch of keys.
+        std::size_t count{ 0 };
+        for ( ; count < batch_size && next != last; ++count, ++next )
+          batch[ count ] = next;
+
+        if constexpr ( SortedLayout< CONTAINER > )
+        {
+          // Contiguous sorted keys -> interleave the binary searches.
+          const auto sorted{ container.keys() };
+          const auto size{ static_cast< std::size_t >( sorted.size() ) };
+          std::array< std::size_t, batch_size > bounds;
+          interleaved_lower_bound( sorted.begin(), size, batch, count, container.key_comp(), bounds );
+
+          for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+          {
+            const auto bound{ bounds[ lookup ] };
+            if ( bound == size || container.key_comp()( *batch[ lookup ], sorted.begin()[ bound ] ) )
+              // Key missing -> nullptr.
+              consume( select_many_result_t< CONTAINER, KEYS >{ nullptr } );
+            else if constexpr ( MapLike< CONTAINER, key_t > )
+              // Key exists in map -> pointer to mapped value.
+              consume( &container.nth( bound )->second );
+            else
+              // Key exists in set -> pointer to value.
+              consume( &*container.nth( bound ) );
+          }
+        }
+        else if constexpr ( Prefetchable< CONTAINER, std::remove_cvref_t< key_t > > || !BucketLayout< CONTAINER, key_t > )
+        {
+          if constexpr ( Prefetchable< CONTAINER, std::remove_cvref_t< key_t > > )
+          {
+            // Start loading the memory for all lookups, before waiting on the first one.
+            std::array< std::size_t, batch_size > hashes;
+            for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+              container.prefetch_hashed( hashes[ lookup ] = container.hash( *batch[ lookup ] ) );
+
+            for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+              consume( select_hashed( container, *batch[ lookup ], hashes[ lookup ] ) );
+          }
+          else
+            for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+              consume( select( container, *batch[ lookup ] ) );
+        }
+        else
+        {
+          // Hash buckets -> hash all keys, then load all buckets' first entries, and only then compare any of them.
+          std::array< std::size_t, batch_size > buckets;
+          for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+            buckets[ lookup ] = container.bucket( *batch[ lookup ] );
+
+          std::array< decltype( container.begin( std::size_t{} ) ), batch_size > entries;
+          for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+            if ( ( entries[ lookup ] = container.begin( buckets[ lookup ] ) ) != container.end( buckets[ lookup ] ) )
+              prefetch( std::addressof( *entries[ lookup ] ) );
+
+          for ( std::size_t lookup{ 0 }; lookup < count; ++lookup )
+          {
+            const auto &key{ *batch[ lookup ] };
+            auto entry{ entries[ lookup ] };
+            const auto end{ container.end( buckets[ lookup ] ) };
+            if constexpr ( MapLike< CONTAINER, key_t > )
+            {
+              while ( entry != end && !container.key_eq()( entry->first, key ) )
+                ++entry;
+              consume( entry != end ? &entry->second : select_many_result_t< CONTAINER, KEYS >{ nullptr } );
+            }
+            else
+            {
+              while ( entry != end && !container.key_eq()( *entry, key ) )
+                ++entry;
+              consume( entry != end ? &*entry : select_many_result_t< CONTAINER, KEYS >{ nullptr } );
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /*!
+    \brief Select the entries for all \c keys from \c container .
+
+    For each key in \c keys , the result of \c select is written to \c out , i.e. a pointer to the entry or a \c nullptr .
+    The lookups are interleaved to overlap their memory latencies, if \c container exposes a sorted layout, hash buckets like \c std::unordered_map , or supports prefetching.
+    Otherwise, this is equivalent to calling \c select for each key.
+    This includes tree maps like \c std::map , which do not expose their nodes, so their descents cannot be interleaved from outside.
+    Returns the output iterator past the last written result.
+    With \c SELECT_N_STATS , each call is recorded once, as a hit if all keys were found, whichever way the lookups are done.
+  */
+  template< typename CONTAINER, std::ranges::forward_range KEYS, std::output_iterator< detail_n::select_many_result_t< CONTAINER, KEYS > > OUTPUT >
+  OUTPUT select_many( CONTAINER &container, KEYS &&keys, OUTPUT out SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_many" );
+    bool found{ true };
+    detail_n::select_batches( container, keys, [ &out, &found ]( const auto entry ){ found = found && entry; *out++ = entry; } );
+    return SELECT_N_HIT_IF( found, out );
+  }
+
+  /*!
+    \brief Select the entries for all \c keys from \c container , or a default value.
+
+    For each key in \c keys , the selected entry is written to \c out , or \c def if the key is missing.
+    Lookups are batched like for \c select_many .
+    Returns the output iterator past the last written result.
+    With \c SELECT_N_STATS , each call is recorded once, as a default if any key was missing.
+  */
+  template< typename CONTAINER, std::ranges::forward_range KEYS, typename DEFAULT, std::output_iterator< const DEFAULT & > OUTPUT >
+    requires std::output_iterator< OUTPUT, decltype( *std::declval< detail_n::select_many_result_t< CONTAINER, KEYS > >() ) >
+  OUTPUT select_or_default_many( CONTAINER &container, KEYS &&keys, const DEFAULT &def, OUTPUT out SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_or_default_many" );
+    bool found{ true };
+    detail_n::select_batches( container, keys, [ &out, &def, &found ]( const auto entry )
+    {
+      if ( entry )
+        // Key exists -> write entry.
+        *out++ = *entry;
+      else
+      {
+        // Key missing -> write default.
+        *out++ = def;
+        found = false;
+      }
+    } );
+    return found ? SELECT_N_HIT( out ) : SELECT_N_DEFAULT( out );
+  }
+}
@@ -4,19 +4,40 @@
 
 #pragma once
 
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 #include "select.h"
+#include "select_stats.h"
 #include "select_util.h"
 
 namespace select_n
 {
   namespace detail_n
   {
-    //! Meta programming helper to deduce a suitable return type for \c select_or_default .
-    template< typename CONTAINER, typename KEY, typename DEFAULT >
+    /*!
+      \brief Whether a \c CONTAINER argument leaves its entries in place, so they must not be moved out.
+
+      This holds for lvalues, and for views like \c std::span or \c sorted_view , which only borrow the entries of another container, even if they are passed as rvalue.
+    */
+    template< typename CONTAINER >
+    inline constexpr bool persistent_input_v{ std::is_lvalue_reference_v< CONTAINER > || std::ranges::borrowed_range< CONTAINER > };
+
+    /*!
+      \brief Meta programming helper to deduce a suitable return type for \c select_or_default .
+
+      \c SELECTED is the type of the selection from \c CONTAINER , i.e. a pointer or a handle.
+    */
+    template< typename CONTAINER, typename SELECTED, typename DEFAULT >
     struct find_or_default_result_c
     {
       //! Value type (i.e. ignoring reference) if taken from the container.
-      using found_value = std::remove_reference_t< decltype( *select( std::declval< CONTAINER & >(), std::declval< KEY >() ) ) >;
+      using found_value = std::remove_reference_t< decltype( *std::declval< SELECTED >() ) >;
 
       //! Value type (i.e. ignoring reference) if falling back to the default.
       using default_value = std::remove_reference_t< DEFAULT >;
@@ -27,8 +48,14 @@ namespace select_n
       //! Deduced return value type for \c select_or_default . It already has the suitable const qualifier, but a reference may still be added.
       using return_value = conditional_const_t< return_const, found_value >;
 
-      //! If both sources are lvalue references, and conversion is possible, the result can be returned by lvalue reference, too.
-      static constexpr bool return_by_reference{ std::is_lvalue_reference_v< CONTAINER > && std::is_lvalue_reference_v< DEFAULT > };
+      //! Only a plain pointer stays valid beyond the lookup. A handle, as selected from concurrent containers, releases its entry when it is destroyed.
+      static constexpr bool select_by_pointer{ std::is_pointer_v< SELECTED > };
+
+      //! The default binds to a reference to the result without conversion, e.g. not a string literal to a \c std::string , which would be a temporary.
+      static constexpr bool default_binds{ std::is_convertible_v< default_value *, return_value * > };
+
+      //! If both sources are lvalue references, and the default binds to the result, the result can be returned by lvalue reference, too.
+      static constexpr bool return_by_reference{ std::is_lvalue_reference_v< CONTAINER > && std::is_lvalue_reference_v< DEFAULT > && select_by_pointer && default_binds };
 
       //! Final return type, deduced according to the rules above.
       using type = conditional_reference_t< return_by_reference, return_value >;
@@ -36,7 +63,119 @@ namespace select_n
 
     //! Deduce a suitable return type for \c select_or_default : reference if possible, const if necessary.
     template< typename CONTAINER, typename KEY, typename DEFAULT >
-    using find_or_default_result_t = typename find_or_default_result_c< CONTAINER, KEY, DEFAULT >::type;
+    using find_or_default_result_t = typename find_or_default_result_c< CONTAINER, decltype( select( std::declval< CONTAINER & >(), std::declval< KEY >() ) ), DEFAULT >::type;
+
+    //! Concept of maps that find or insert an entry in a single lookup, like \c std::map::try_emplace .
+    template< typename MAP, typename KEY, typename... ARGS >
+    concept TryEmplaceable = requires( MAP &map, KEY &&key, ARGS &&... args ){ { map.try_emplace( std::forward< KEY >( key ), std::forward< ARGS >( args )... ).first->second }; };
+
+    //! Concept of ordered maps that can insert an entry at the position found by \c lower_bound , like \c std::map::emplace_hint .
+    template< typename MAP, typename KEY, typename... ARGS >
+    concept HintEmplaceable = requires( MAP &map, KEY &&key, ARGS &&... args )
+    {
+      { map.key_comp()( key, map.lower_bound( key )->first ) } -> std::convertible_to< bool >;
+      { map.emplace_hint( map.lower_bound( key ), std::piecewise_construct, std::forward_as_tuple( std::forward< KEY >( key ) ), std::forward_as_tuple( std::forward< ARGS >( args )... ) )->second };
+    };
+
+    /*!
+      \brief Placeholder for a \c VALUE made from the result of \c factory .
+
+      It converts to \c VALUE , so a value constructed from it is created in place from the factory's result, without any copy or move of the value.
+      The factory is only called, if the conversion is actually needed.
+    */
+    template< typename FACTORY, typename VALUE = std::invoke_result_t< FACTORY & > >
+    struct lazy_value
+    {
+      FACTORY &factory;
+
+      constexpr operator VALUE() const { return static_cast< VALUE >( std::invoke( factory ) ); }
+    };
+
+    //! Stand-in for \c lazy_value without its conversion. A type constructible from it has a greedy constructor, which would take the \c lazy_value itself.
+    struct opaque_value {};
+
+    /*!
+      \brief Concept of values, which a \c lazy_value of \c FACTORY constructs only through its conversion.
+
+      This requires the value type to be constructible from the factory's result, and to have no constructor taking just anything, like \c std::any .
+    */
+    template< typename VALUE, typename FACTORY >
+    concept LazyConstructible = std::is_constructible_v< VALUE, std::invoke_result_t< FACTORY & > > && !std::is_constructible_v< VALUE, opaque_value >;
+
+    //! Placeholder, which \c find_or_insert_with constructs a value of \c MAP from.
+    template< typename MAP, typename FACTORY >
+    using lazy_mapped_t = lazy_value< FACTORY, typename MAP::mapped_type >;
+
+    //! Concept of ordered maps that can insert the result of \c factory at the position found by \c lower_bound .
+    template< typename MAP, typename KEY, typename FACTORY >
+    concept HintInsertable = requires( MAP &map, KEY &&key, FACTORY &factory )
+    {
+      { map.key_comp()( key, map.lower_bound( key )->first ) } -> std::convertible_to< bool >;
+      { map.emplace_hint( map.lower_bound( key ), std::forward< KEY >( key ), std::invoke( factory ) )->second };
+    };
+
+    //! Concept of maps that can find \c key , and insert the result of \c factory for it.
+    template< typename MAP, typename KEY, typename FACTORY >
+    concept FindInsertable = requires( MAP &map, KEY &&key, FACTORY &factory )
+    {
+      { map.find( key ) != map.end() } -> std::convertible_to< bool >;
+      { map.try_emplace( std::forward< KEY >( key ), std::invoke( factory ) ).first->second };
+    };
+
+    //! Find the value for \c key in \c map , or construct it from \c args , doing a single lookup.
+    template< typename MAP, typename KEY, typename... ARGS >
+    constexpr decltype( auto ) find_or_emplace( MAP &map, KEY &&key, ARGS &&... args )
+    {
+      if constexpr ( TryEmplaceable< MAP, KEY, ARGS... > )
+        // The map does it all by itself.
+        return ( map.try_emplace( std::forward< KEY >( key ), std::forward< ARGS >( args )... ).first->second );
+      else
+      {
+        // Find the position once, and use it as hint for the insertion.
+        const auto hint{ map.lower_bound( key ) };
+        if ( hint != map.end() && !map.key_comp()( key, hint->first ) )
+          // Key exists -> return the present value.
+          return ( hint->second );
+        else
+          // Key missing -> construct a new entry in place.
+          return ( map.emplace_hint( hint, std::piecewise_construct, std::forward_as_tuple( std::forward< KEY >( key ) ), std::forward_as_tuple( std::forward< ARGS >( args )... ) )->second );
+      }
+    }
+
+    //! Concept of maps, which \c find_or_insert_with can insert the result of \c factory into.
+    template< typename MAP, typename KEY, typename FACTORY >
+    concept InsertableWith = ( LazyConstructible< typename MAP::mapped_type, FACTORY > && ( TryEmplaceable< MAP, KEY, lazy_mapped_t< MAP, FACTORY > > || HintEmplaceable< MAP, KEY, lazy_mapped_t< MAP, FACTORY > > ) )
+                             || HintInsertable< MAP, KEY, FACTORY > || FindInsertable< MAP, KEY, FACTORY >;
+
+    //! Find the value for \c key in \c map , or insert the result of \c factory , calling it only if \c key is missing.
+    template< typename MAP, typename KEY, typename FACTORY >
+    constexpr decltype( auto ) find_or_insert_with( MAP &map, KEY &&key, FACTORY &factory )
+    {
+      if constexpr ( LazyConstructible< typename MAP::mapped_type, FACTORY > && ( TryEmplaceable< MAP, KEY, lazy_mapped_t< MAP, FACTORY > > || HintEmplaceable< MAP, KEY, lazy_mapped_t< MAP, FACTORY > > ) )
+        // Construct the value right from the factory's result.
+        return find_or_emplace( map, std::forward< KEY >( key ), lazy_mapped_t< MAP, FACTORY >{ factory } );
+      else if constexpr ( HintInsertable< MAP, KEY, FACTORY > )
+      {
+        // Find the position once, and use it as hint for the insertion.
+        const auto hint{ map.lower_bound( key ) };
+        if ( hint != map.end() && !map.key_comp()( key, hint->first ) )
+          // Key exists -> return the present value.
+          return ( hint->second );
+        else
+          // Key missing -> move the factory's result into a new entry.
+          return ( map.emplace_hint( hint, std::forward< KEY >( key ), std::invoke( factory ) )->second );
+      }
+      else
+      {
+        // A greedy value type in an unordered map -> a second lookup for the insertion.
+        if ( const auto existing{ map.find( key ) }; existing != map.end() )
+          // Key exists -> return the present value.
+          return ( existing->second );
+        else
+          // Key missing -> move the factory's result into a new entry.
+          return ( map.try_emplace( std::forward< KEY >( key ), std::invoke( factory ) ).first->second );
+      }
+    }
   }
 
   /*!
@@ -44,26 +183,30 @@ namespace select_n
 
     If an entry can be selected for \c key from \c container , it is returned. Otherwise, \c def is used as a default.
     The result is returned as reference if both \c container and \c def are references, adding a const if any of \c container or \c def is const.
+    A \c def of another type, which has to be converted, e.g. a string literal for a \c std::string , is returned by value, instead.
+    Entries of containers, which \c select returns a handle for instead of a pointer, are always returned by value.
     If \c container or \c def are moved in (i.e. passed as rvalue), and the result is taken from the rvalue input, then the result is moved out.
+    Views like \c sorted_view , which do not own their entries, are never moved out of.
   */
   template< typename CONTAINER, typename KEY, typename DEFAULT >
-  detail_n::find_or_default_result_t< CONTAINER, KEY, DEFAULT >
-  select_or_default( CONTAINER &&container, KEY &&key, DEFAULT &&def )
+  constexpr detail_n::find_or_default_result_t< CONTAINER, KEY, DEFAULT >
+  select_or_default( CONTAINER &&container, KEY &&key, DEFAULT &&def SELECT_N_LOCATION_PARAMETER )
   {
+    SELECT_N_PROBE( "select_or_default" );
     if ( auto existing{ select( container, std::forward< KEY >( key ) ) } )
     {
       // Key exists -> return value.
-      if constexpr ( std::is_lvalue_reference_v< CONTAINER > )
+      if constexpr ( detail_n::persistent_input_v< CONTAINER > )
         // Persistent input -> copy or reference entry.
-        return *existing;
+        return SELECT_N_HIT( *existing );
       else
         // Temporary input -> move entry.
-        return std::move( *existing );
+        return SELECT_N_HIT( std::move( *existing ) );
     }
     else
     {
       // Key missing -> return the default value.
-      return std::forward< DEFAULT >( def );
+      return SELECT_N_DEFAULT( std::forward< DEFAULT >( def ) );
     }
   }
 
@@ -77,9 +220,65 @@ namespace select_n
           Hence, the result is always returned as a const reference if \c container is passed by reference.
   */
   template< typename CONTAINER, typename KEY >
-  decltype( auto ) select_or_default( CONTAINER &&container, KEY &&key )
+  decltype( auto ) select_or_default( CONTAINER &&container, KEY &&key SELECT_N_LOCATION_PARAMETER )
+  {
+    using default_t = decltype( *select( container, std::forward< KEY >( key ) ) );
+    return select_or_default( std::forward< CONTAINER >( container ), std::forward< KEY >( key ), detail_n::static_default< default_t >() SELECT_N_LOCATION_ARGUMENT );
+  }
+
+  /*!
+    \brief Select an entry from a container by a precomputed hash, or return a default value.
+
+    Like \c select_or_default , but the entry is selected by \c select_hashed , so hash maps do not hash \c key again.
+    \c hash has to be the result of the container's hash function for \c key .
+  */
+  template< typename CONTAINER, typename KEY, typename DEFAULT >
+  constexpr detail_n::find_or_default_result_t< CONTAINER, KEY, DEFAULT >
+  select_or_default_hashed( CONTAINER &&container, KEY &&key, const std::size_t hash, DEFAULT &&def SELECT_N_LOCATION_PARAMETER )
+  {
+    SELECT_N_PROBE( "select_or_default_hashed" );
+    if ( auto existing{ select_hashed( container, std::forward< KEY >( key ), hash ) } )
+    {
+      // Key exists -> return value.
+      if constexpr ( detail_n::persistent_input_v< CONTAINER > )
+        // Persistent input -> copy or reference entry.
+        return SELECT_N_HIT( *existing );
+      else
+        // Temporary input -> move entry.
+        return SELECT_N_HIT( std::move( *existing ) );
+    }
+    else
+    {
+      // Key missing -> return the default value.
+      return SELECT_N_DEFAULT( std::forward< DEFAULT >( def ) );
+    }
+  }
+
+  /*!
+    \brief Select an entry from a map, or insert one constructed from \c args .
+
+    Unlike calling \c select and inserting on a \c nullptr , this does only a single lookup, using \c try_emplace if \c map provides it, or an insertion hinted by \c lower_bound otherwise.
+    The value is only constructed if \c key is missing, and \c args are left untouched otherwise.
+    The present or new value is returned by reference.
+  */
+  template< typename MAP, typename KEY, typename... ARGS > requires ( detail_n::TryEmplaceable< MAP, KEY, ARGS... > || detail_n::HintEmplaceable< MAP, KEY, ARGS... > )
+  constexpr decltype( auto ) select_or_emplace( MAP &map, KEY &&key, ARGS &&... args )
+  {
+    return detail_n::find_or_emplace( map, std::forward< KEY >( key ), std::forward< ARGS >( args )... );
+  }
+
+  /*!
+    \brief Select an entry from a map, or insert the result of \c factory .
+
+    Like \c select_or_emplace , but the new value is returned by \c factory , which is only called if \c key is missing.
+    If the map's value type can be constructed from the factory's result, and has no constructor taking just anything, like \c std::any , the value is constructed right in place, after a single lookup.
+    Otherwise, the result is moved into the map. Ordered maps still do a single lookup by \c lower_bound , but other maps do two, one by \c find and another one for the insertion.
+
+    \note Constructing in place relies on the conversion of the factory's result being elided (CWG 2327), which GCC does, but Clang does not, so there the result is moved once.
+  */
+  template< typename MAP, typename KEY, std::invocable FACTORY > requires detail_n::InsertableWith< MAP, KEY, FACTORY >
+  constexpr decltype( auto ) select_or_insert_with( MAP &map, KEY &&key, FACTORY &&factory )
   {
-    using default_t = decltype( *select( container, key ) );
-    return select_or_default( std::forward< CONTAINER >( container ), std::forward< KEY >( key ), detail_n::static_default< default_t >() );
+    return detail_n::find_or_insert_with( map, std::forward< KEY >( key ), factory );
   }
 }
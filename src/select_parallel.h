@@ -0,0 +1,160 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "select.h"
+#include "select_if.h"
+#include "select_sorted.h"
+
+namespace select_n
+{
+  /*!
+    \brief Execution policy for parallel selection.
+
+    Ranges shorter than \c threshold are searched sequentially, as starting threads would cost more than it saves.
+    Longer ranges are split into blocks of at least \c min_block_size elements, which are searched by up to \c threads threads.
+    A \c threads value of zero uses the hardware concurrency.
+  */
+  struct parallel_policy
+  {
+    std::size_t threshold{ 1 << 16 };
+    std::size_t min_block_size{ 1 << 12 };
+    unsigned threads{ 0 };
+  };
+
+  //! Default parallel policy.
+  inline constexpr parallel_policy parallel{};
+
+  namespace detail_n
+  {
+    /*!
+      \brief Find the first index in \c [0, size) accepted by \c scan , using multiple threads.
+
+      \c scan( first, last ) has to return the first accepted index in \c [first, last) , or \c last if there is none.
+      Blocks are handed out to the threads in ascending order.
+      Once a match is found, blocks behind it are skipped, while blocks before it are still searched, so the result is the same as for a sequential search.
+      Returns \c size if no index is accepted.
+    */
+    template< typename SCAN >
+    std::size_t parallel_find_index( const parallel_policy &policy, const std::size_t size, const SCAN &scan )
+    {
+      const auto threads{ static_cast< std::size_t >( policy.threads ? policy.threads : std::max( std::thread::hardware_concurrency(), 1u ) ) };
+      if ( size < policy.threshold || threads < 2 )
+        // Short range -> sequential search.
+        return scan( std::size_t{ 0 }, size );
+
+      // Use several blocks per thread, so work is balanced and a match stops the search early.
+      const auto block_size{ std::max( policy.min_block_size, ( size + 8 * threads - 1 ) / ( 8 * threads ) ) };
+
+      std::atomic< std::size_t > next_block{ 0 };
+      std::atomic< std::size_t > best{ size };
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      const auto work{ [ & ]
+      {
+        try
+        {
+          for ( auto first{ next_block++ * block_size }; first < best.load( std::memory_order_relaxed ); first = next_block++ * block_size )
+            if ( const auto last{ std::min( first + block_size, size ) }, found{ scan( first, last ) }; found < last )
+            {
+              // Publish the match, unless an earlier one is known already.
+              auto current{ best.load( std::memory_order_relaxed ) };
+              while ( found < current && !best.compare_exchange_weak( current, found, std::memory_order_relaxed ) ) {}
+              return;
+            }
+        }
+        catch ( ... )
+        {
+          const std::lock_guard lock{ error_mutex };
+          if ( !error )
+            error = std::current_exception();
+          best.store( 0, std::memory_order_relaxed );
+        }
+      } };
+
+      {
+        std::vector< std::jthread > workers;
+        workers.reserve( threads - 1 );
+        for ( std::size_t worker{ 1 }; worker < threads; ++worker )
+          workers.emplace_back( work );
+
+        // The calling thread takes part, too.
+        work();
+      }
+
+      if ( error )
+        std::rethrow_exception( error );
+      return best.load();
+    }
+  }
+
+  /*!
+    \brief Select an element from a random access container, searching in parallel.
+
+    Like \c select_if , but large containers are split into blocks that are searched concurrently, as described by \c policy .
+    The result is the first element in order accepted by \c predicate , just like for the sequential version.
+    \c predicate is shared by all threads and has to be safe to call concurrently.
+    If it throws, the first exception caught is rethrown after all threads stopped.
+  */
+  template< detail_n::RandomAccess CONTAINER, typename PREDICATE >
+  detail_n::find_if_value_t< CONTAINER, PREDICATE > *
+  select_if( const parallel_policy &policy, CONTAINER &container, PREDICATE &&predicate )
+  {
+    const auto first{ container.begin() };
+    const auto size{ static_cast< std::size_t >( container.end() - first ) };
+
+    const auto index{ detail_n::parallel_find_index( policy, size, [ & ]( const std::size_t from, const std::size_t to )
+    {
+      const auto begin{ first + static_cast< std::ptrdiff_t >( from ) };
+      return from + static_cast< std::size_t >( std::find_if( begin, first + static_cast< std::ptrdiff_t >( to ), std::ref( predicate ) ) - begin );
+    } ) };
+
+    if ( index < size )
+      // Element found -> return by pointer.
+      return &first[ static_cast< std::ptrdiff_t >( index ) ];
+    else
+      // Nothing found -> return nullptr.
+      return nullptr;
+  }
+
+  /*!
+    \brief Select an entry from a random access container, searching in parallel.
+
+    Like the generic \c select overload, but large containers are split into blocks that are searched concurrently, as described by \c policy .
+    Blocks of integral values are searched with SIMD instructions, if available.
+  */
+  template< detail_n::RandomAccess CONTAINER, typename VALUE > requires detail_n::Searchable< CONTAINER, VALUE >
+  auto select( const parallel_policy &policy, CONTAINER &container, const VALUE &value ) -> decltype( &*std::find( container.begin(), container.end(), value ) )
+  {
+    if constexpr ( detail_n::SimdSearchable< CONTAINER, VALUE > )
+    {
+      using element_t = std::remove_cvref_t< decltype( *container.begin() ) >;
+
+      const auto needle{ detail_n::simd_needle< element_t >( value ) };
+      if ( !needle )
+        return nullptr;
+
+      const auto data{ std::to_address( container.begin() ) };
+      const auto size{ static_cast< std::size_t >( container.end() - container.begin() ) };
+      const auto index{ detail_n::parallel_find_index( policy, size, [ & ]( const std::size_t from, const std::size_t to )
+      {
+        return from + detail_n::simd_find_index< element_t >( data + from, to - from, *needle );
+      } ) };
+      return index < size ? data + index : nullptr;
+    }
+    else
+      return select_if( policy, container, [ &value ]( const auto &element ){ return element == value; } );
+  }
+}
@@ -0,0 +1,106 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "select.h"
+#include "select_or_default.h"
+#include "select_stats.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Meta programming helper to deduce the pointer type returned by \c select_path , descending one level per key.
+    template< typename CONTAINER, typename... KEYS >
+    struct select_path_result_c;
+
+    template< typename CONTAINER >
+    struct select_path_result_c< CONTAINER >
+    {
+      using type = CONTAINER *;
+    };
+
+    template< typename CONTAINER, typename KEY, typename... KEYS > requires PointerSelectable< CONTAINER, KEY >
+    struct select_path_result_c< CONTAINER, KEY, KEYS... >
+    {
+      //! Entry selected on this level, which is the container of the next level.
+      using entry = std::remove_pointer_t< decltype( select( std::declval< CONTAINER & >(), std::declval< KEY >() ) ) >;
+
+      using type = typename select_path_result_c< entry, KEYS... >::type;
+    };
+
+    //! Pointer type returned by \c select_path on \c CONTAINER for the path of \c KEYS .
+    template< typename CONTAINER, typename... KEYS >
+    using select_path_result_t = typename select_path_result_c< CONTAINER, KEYS... >::type;
+
+    //! Descend from \c container by \c key and \c keys , like \c select_path .
+    template< typename CONTAINER, typename KEY, typename... KEYS >
+    constexpr select_path_result_t< CONTAINER, KEY, KEYS... > select_levels( CONTAINER &container, KEY &&key, KEYS &&... keys )
+    {
+      const auto entry{ select( container, std::forward< KEY >( key ) ) };
+      if constexpr ( sizeof...( KEYS ) == 0 )
+        // Last level -> return the entry itself.
+        return entry;
+      else
+      {
+        if ( entry )
+          // Key exists -> descend into the entry.
+          return select_levels( *entry, std::forward< KEYS >( keys )... );
+        else
+          // Key missing -> skip the remaining levels.
+          return nullptr;
+      }
+    }
+  }
+
+  /*!
+    \brief Select an entry from nested containers, by a path of keys.
+
+    The first key selects an entry from \c container , the next key selects from that entry, and so on, each level by the matching \c select overload.
+    The innermost entry is returned by pointer, or a \c nullptr is returned as soon as any key is missing, without looking at the remaining keys.
+    No level is copied, and every key is passed on as it is, like for \c select .
+    With \c SELECT_N_STATS , all calls are recorded under a single site in this function, because a call site cannot follow the keys.
+  */
+  template< typename CONTAINER, typename KEY, typename... KEYS >
+  constexpr detail_n::select_path_result_t< CONTAINER, KEY, KEYS... > select_path( CONTAINER &container, KEY &&key, KEYS &&... keys )
+  {
+    SELECT_N_FUNCTION_PROBE( "select_path" );
+    const auto entry{ detail_n::select_levels( container, std::forward< KEY >( key ), std::forward< KEYS >( keys )... ) };
+    return SELECT_N_HIT_IF( entry, entry );
+  }
+
+  /*!
+    \brief Select an entry from nested containers by a path of keys, or return a default value.
+
+    Like \c select_or_default , but the entry is selected by \c select_path , so \c def comes before the keys.
+    The result is returned as reference if both \c container and \c def are references, adding a const if any of them is const.
+    If \c container is moved in, and the result is taken from it, then the result is moved out, unless it is a view like \c std::span .
+    With \c SELECT_N_STATS , all calls are recorded under a single site in this function, like for \c select_path .
+  */
+  template< typename CONTAINER, typename DEFAULT, typename KEY, typename... KEYS >
+  constexpr typename detail_n::find_or_default_result_c< CONTAINER, detail_n::select_path_result_t< std::remove_reference_t< CONTAINER >, KEY, KEYS... >, DEFAULT >::type
+  select_path_or_default( CONTAINER &&container, DEFAULT &&def, KEY &&key, KEYS &&... keys )
+  {
+    SELECT_N_FUNCTION_PROBE( "select_path_or_default" );
+    if ( const auto existing{ detail_n::select_levels( container, std::forward< KEY >( key ), std::forward< KEYS >( keys )... ) } )
+    {
+      // Path exists -> return value.
+      if constexpr ( detail_n::persistent_input_v< CONTAINER > )
+        // Persistent input -> copy or reference entry.
+        return SELECT_N_HIT( *existing );
+      else
+        // Temporary input -> move entry.
+        return SELECT_N_HIT( std::move( *existing ) );
+    }
+    else
+    {
+      // Any key missing -> return the default value.
+      return SELECT_N_DEFAULT( std::forward< DEFAULT >( def ) );
+    }
+  }
+}
@@ -0,0 +1,264 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#if !defined( SELECT_N_NO_SIMD ) && ( defined( __GNUC__ ) || defined( __clang__ ) ) && defined( __x86_64__ )
+  #define SELECT_N_SIMD_X86 1
+  #include <immintrin.h>
+#endif
+
+namespace select_n::detail_n
+{
+  /*!
+    \brief Concept of element types that can be compared by bit pattern.
+
+    Integral types (but \c bool ) compare equal if and only if their object representations are equal.
+    Hence, a search for them can be done on raw memory, e.g. by SIMD instructions.
+  */
+  template< typename T >
+  concept SimdComparable = std::integral< T > && !std::same_as< T, bool > && ( sizeof( T ) == 1 || sizeof( T ) == 2 || sizeof( T ) == 4 || sizeof( T ) == 8 );
+
+  /*!
+    \brief Concept of containers suitable for a vectorized search for \c VALUE .
+
+    The container's elements have to be stored contiguously, and both the element type and \c VALUE have to be \c SimdComparable .
+  */
+  template< typename CONTAINER, typename VALUE >
+  concept SimdSearchable = requires( CONTAINER &container ){ { container.begin() } -> std::contiguous_iterator; { container.end() } -> std::contiguous_iterator; }
+                           && SimdComparable< std::remove_cvref_t< decltype( *std::declval< CONTAINER & >().begin() ) > >
+                           && SimdComparable< std::remove_cvref_t< VALUE > >;
+
+  //! Reference implementation of the search, used for short tails and on targets without SIMD support.
+  template< typename T >
+  std::size_t scalar_find_index( const T *data, const std::size_t size, const T value ) noexcept
+  {
+    std::size_t index{ 0 };
+    while ( index < size && data[ index ] != value )
+      ++index;
+    return index;
+  }
+
+#ifdef SELECT_N_SIMD_X86
+  //! Broadcast \c value to all lanes of a 128 bit register.
+  template< typename T >
+  __m128i sse2_broadcast( const T value ) noexcept
+  {
+    if constexpr ( sizeof( T ) == 1 )
+      return _mm_set1_epi8( static_cast< char >( value ) );
+    else if constexpr ( sizeof( T ) == 2 )
+      return _mm_set1_epi16( static_cast< short >( value ) );
+    else if constexpr ( sizeof( T ) == 4 )
+      return _mm_set1_epi32( static_cast< int >( value ) );
+    else
+      return _mm_set1_epi64x( static_cast< long long >( value ) );
+  }
+
+  //! Compare all lanes of \c block against \c needle and return a byte mask of equal lanes.
+  template< typename T >
+  unsigned sse2_match( const __m128i block, const __m128i needle ) noexcept
+  {
+    if constexpr ( sizeof( T ) == 1 )
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi8( block, needle ) ) );
+    else if constexpr ( sizeof( T ) == 2 )
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi16( block, needle ) ) );
+    else if constexpr ( sizeof( T ) == 4 )
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi32( block, needle ) ) );
+    else
+    {
+      // SSE2 lacks a 64 bit comparison: Both 32 bit halves have to match.
+      const auto halves{ _mm_cmpeq_epi32( block, needle ) };
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_and_si128( halves, _mm_shuffle_epi32( halves, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) ) );
+    }
+  }
+
+  //! Search \c data with 128 bit registers. SSE2 is part of the x86-64 baseline, so no dispatch is needed.
+  template< typename T >
+  std::size_t sse2_find_index( const T *data, const std::size_t size, const T value ) noexcept
+  {
+    constexpr std::size_t lanes{ sizeof( __m128i ) / sizeof( T ) };
+    const auto needle{ sse2_broadcast( value ) };
+
+    std::size_t index{ 0 };
+    for ( ; index + lanes <= size; index += lanes )
+      if ( const auto mask{ sse2_match< T >( _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + index ) ), needle ) } )
+        // Byte mask -> element index.
+        return index + static_cast< std::size_t >( __builtin_ctz( mask ) ) / sizeof( T );
+
+    return index + scalar_find_index( data + index, size - index, value );
+  }
+
+  //! Compare all lanes of \c block against \c needle and return a mask with one bit per equal lane.
+  template< typename T >
+  unsigned sse2_match_lanes( const __m128i block, const __m128i needle ) noexcept
+  {
+    if constexpr ( sizeof( T ) == 1 )
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_cmpeq_epi8( block, needle ) ) );
+    else if constexpr ( sizeof( T ) == 2 )
+      // Narrow the 16 bit lanes to bytes first.
+      return static_cast< unsigned >( _mm_movemask_epi8( _mm_packs_epi16( _mm_cmpeq_epi16( block, needle ), _mm_setzero_si128() ) ) );
+    else if constexpr ( sizeof( T ) == 4 )
+      return static_cast< unsigned >( _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( block, needle ) ) ) );
+    else
+    {
+      // SSE2 lacks a 64 bit comparison: Both 32 bit halves have to match.
+      const auto halves{ _mm_cmpeq_epi32( block, needle ) };
+      return static_cast< unsigned >( _mm_movemask_pd( _mm_castsi128_pd( _mm_and_si128( halves, _mm_shuffle_epi32( halves, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ) ) ) );
+    }
+  }
+
+  /*!
+    \brief Compare all \c SIZE elements of \c data against \c value , and return a mask with bit \c i set if element \c i matches.
+
+    The comparisons are unrolled at compile time, in blocks of 128 bits and single elements for the rest, so there is neither a loop nor an early exit.
+  */
+  template< typename T, std::size_t SIZE >
+  std::uint64_t sse2_unrolled_matches( const T *data, const T value ) noexcept
+  {
+    static_assert( SIZE <= 64, "The matches are collected in a 64 bit mask." );
+    constexpr std::size_t lanes{ sizeof( __m128i ) / sizeof( T ) };
+    constexpr std::size_t blocked{ SIZE / lanes * lanes };
+    const auto needle{ sse2_broadcast( value ) };
+
+    return [ data, needle ]< std::size_t... BLOCKS >( std::index_sequence< BLOCKS... > ) noexcept {
+      return ( std::uint64_t{ 0 } | ... | ( std::uint64_t{ sse2_match_lanes< T >( _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + BLOCKS * lanes ) ), needle ) } << ( BLOCKS * lanes ) ) );
+    }( std::make_index_sequence< SIZE / lanes >{} )
+    | [ data, value ]< std::size_t... TAIL >( std::index_sequence< TAIL... > ) noexcept {
+      return ( std::uint64_t{ 0 } | ... | ( static_cast< std::uint64_t >( data[ blocked + TAIL ] == value ) << ( blocked + TAIL ) ) );
+    }( std::make_index_sequence< SIZE - blocked >{} );
+  }
+
+  //! Broadcast \c value to all lanes of a 256 bit register.
+  template< typename T >
+  __attribute__(( target( "avx2" ) ))
+  __m256i avx2_broadcast( const T value ) noexcept
+  {
+    if constexpr ( sizeof( T ) == 1 )
+      return _mm256_set1_epi8( static_cast< char >( value ) );
+    else if constexpr ( sizeof( T ) == 2 )
+      return _mm256_set1_epi16( static_cast< short >( value ) );
+    else if constexpr ( sizeof( T ) == 4 )
+      return _mm256_set1_epi32( static_cast< int >( value ) );
+    else
+      return _mm256_set1_epi64x( static_cast< long long >( value ) );
+  }
+
+  //! Compare the 256 bit block at \c block against \c needle and return a byte mask of equal lanes.
+  template< typename T >
+  __attribute__(( target( "avx2" ) ))
+  unsigned avx2_match( const T *block, const __m256i needle ) noexcept
+  {
+    const auto loaded{ _mm256_loadu_si256( reinterpret_cast< const __m256i * >( block ) ) };
+    if constexpr ( sizeof( T ) == 1 )
+      return static_cast< unsigned >( _mm256_movemask_epi8( _mm256_cmpeq_epi8( loaded, needle ) ) );
+    else if constexpr ( sizeof( T ) == 2 )
+      return static_cast< unsigned >( _mm256_movemask_epi8( _mm256_cmpeq_epi16( loaded, needle ) ) );
+    else if constexpr ( sizeof( T ) == 4 )
+      return static_cast< unsigned >( _mm256_movemask_epi8( _mm256_cmpeq_epi32( loaded, needle ) ) );
+    else
+      return static_cast< unsigned >( _mm256_movemask_epi8( _mm256_cmpeq_epi64( loaded, needle ) ) );
+  }
+
+  //! Search \c data with 256 bit registers. Must only be called if the CPU supports AVX2.
+  template< typename T >
+  __attribute__(( target( "avx2" ) ))
+  std::size_t avx2_find_index( const T *data, const std::size_t size, const T value ) noexcept
+  {
+    constexpr std::size_t lanes{ sizeof( __m256i ) / sizeof( T ) };
+    const auto needle{ avx2_broadcast( value ) };
+
+    std::size_t index{ 0 };
+
+    // Unroll by two blocks to hide the latency of the comparisons.
+    for ( ; index + 2 * lanes <= size; index += 2 * lanes )
+    {
+      const auto low{ avx2_match( data + index, needle ) };
+      const auto high{ avx2_match( data + index + lanes, needle ) };
+      if ( low | high )
+        return index + ( low ? static_cast< std::size_t >( __builtin_ctz( low ) ) : sizeof( __m256i ) + static_cast< std::size_t >( __builtin_ctz( high ) ) ) / sizeof( T );
+    }
+
+    for ( ; index + lanes <= size; index += lanes )
+      if ( const auto mask{ avx2_match( data + index, needle ) } )
+        return index + static_cast< std::size_t >( __builtin_ctz( mask ) ) / sizeof( T );
+
+    return index + sse2_find_index( data + index, size - index, value );
+  }
+
+  //! Query the CPU once, whether AVX2 instructions may be used.
+  inline bool has_avx2() noexcept
+  {
+    static const bool avx2{ __builtin_cpu_supports( "avx2" ) != 0 };
+    return avx2;
+  }
+#endif
+
+  /*!
+    \brief Find the index of the first element in \c data equal to \c value .
+
+    Uses the widest instruction set available at runtime, falling back to a scalar loop.
+    If no element matches, \c size is returned.
+  */
+  template< SimdComparable T >
+  std::size_t simd_find_index( const T *data, const std::size_t size, const T value ) noexcept
+  {
+#ifdef SELECT_N_SIMD_X86
+    if ( has_avx2() )
+      return avx2_find_index( data, size, value );
+    else
+      return sse2_find_index( data, size, value );
+#else
+    return scalar_find_index( data, size, value );
+#endif
+  }
+
+  /*!
+    \brief Convert \c value to the element type \c ELEMENT for a comparison by bit pattern.
+
+    Elements are compared to \c value in their common type, just like \c std::find does.
+    Since the conversion from \c ELEMENT to the common type is injective, only the element value converting to the same common value as \c value can match.
+    If there is no such element value, nothing is returned.
+  */
+  template< SimdComparable ELEMENT, SimdComparable VALUE >
+  std::optional< ELEMENT > simd_needle( const VALUE value ) noexcept
+  {
+    using common_t = std::common_type_t< ELEMENT, VALUE >;
+
+    if ( const auto needle{ static_cast< ELEMENT >( static_cast< common_t >( value ) ) }; static_cast< common_t >( needle ) == static_cast< common_t >( value ) )
+      return needle;
+    else
+      return std::nullopt;
+  }
+
+  /*!
+    \brief Find the first element in \c container equal to \c value , using SIMD instructions if available.
+
+    The comparison follows the usual arithmetic conversions, just like \c std::find does.
+    Returns a pointer to the element, or \c nullptr if there is none.
+  */
+  template< typename CONTAINER, typename VALUE > requires SimdSearchable< CONTAINER, VALUE >
+  auto simd_find( CONTAINER &container, const VALUE value ) noexcept -> decltype( std::to_address( container.begin() ) )
+  {
+    using element_t = std::remove_cvref_t< decltype( *container.begin() ) >;
+
+    const auto needle{ simd_needle< element_t >( value ) };
+    if ( !needle )
+      return nullptr;
+
+    const auto first{ std::to_address( container.begin() ) };
+    const auto size{ static_cast< std::size_t >( container.end() - container.begin() ) };
+    if ( const auto index{ simd_find_index< element_t >( first, size, *needle ) }; index < size )
+      return first + index;
+    else
+      return nullptr;
+  }
+}
@@ -0,0 +1,304 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    //! Hint the CPU to load the cache line at \c address , if the compiler supports it.
+    inline void prefetch( const void *address ) noexcept
+    {
+#if defined( __GNUC__ ) || defined( __clang__ )
+      __builtin_prefetch( address );
+#else
+      static_cast< void >( address );
+#endif
+    }
+
+    //! Size of a cache line, as assumed by the prefetching searches.
+    inline constexpr std::size_t cache_line_size{ 64 };
+
+    //! Allocator which places every allocation at the start of a cache line.
+    template< typename T >
+    struct cache_aligned_allocator
+    {
+      using value_type = T;
+
+      cache_aligned_allocator() = default;
+      template< typename U >
+      constexpr cache_aligned_allocator( const cache_aligned_allocator< U > & ) noexcept {}
+
+      T *allocate( const std::size_t count )
+      {
+        if ( count > std::size_t( -1 ) / sizeof( T ) )
+          throw std::bad_array_new_length{};
+        return static_cast< T * >( ::operator new( count * sizeof( T ), alignment ) );
+      }
+
+      void deallocate( T *const pointer, std::size_t ) noexcept { ::operator delete( pointer, alignment ); }
+
+      template< typename U >
+      friend constexpr bool operator==( const cache_aligned_allocator &, const cache_aligned_allocator< U > & ) noexcept { return true; }
+
+    private:
+      static constexpr std::align_val_t alignment{ std::max( cache_line_size, alignof( T ) ) };
+    };
+
+    /*!
+      \brief Branchless variant of \c std::lower_bound on the \c size elements starting at \c first .
+
+      Every step halves the range by a conditional move instead of a jump, so the search does not suffer from branch mispredictions.
+      The number of steps only depends on \c size .
+    */
+    template< std::random_access_iterator ITERATOR, typename KEY, typename COMPARE >
+    constexpr ITERATOR branchless_lower_bound( ITERATOR first, std::size_t size, const KEY &key, COMPARE &&compare )
+    {
+      if ( size == 0 )
+        return first;
+
+      while ( size > 1 )
+      {
+        const auto half{ size / 2 };
+        first = compare( first[ half ], key ) ? first + half : first;
+        size -= half;
+      }
+      return first + compare( *first, key );
+    }
+
+    //! Widen \c value to the largest integer type of its signedness, as \c std::cmp_less and friends reject \c bool and the character types.
+    template< std::integral INTEGER >
+    constexpr auto widen( const INTEGER value ) noexcept
+    {
+      if constexpr ( std::is_signed_v< INTEGER > )
+        return static_cast< std::intmax_t >( value );
+      else
+        return static_cast< std::uintmax_t >( value );
+    }
+
+    //! Concept of containers with random access to their elements.
+    template< typename CONTAINER >
+    concept RandomAccess = requires( CONTAINER &container ){ { container.begin() } -> std::random_access_iterator; };
+  }
+
+  /*!
+    \brief Select an entry from a sorted container, using a binary search.
+
+    \c container has to be sorted with respect to \c compare .
+    If it has an entry equivalent to \c key , it is returned by pointer.
+    If \c key is missing from \c container , a \c nullptr is returned, instead.
+  */
+  template< detail_n::RandomAccess CONTAINER, typename KEY, typename COMPARE = std::less<> >
+  auto select_sorted( CONTAINER &container, const KEY &key, COMPARE compare = {} ) -> decltype( &*container.begin() )
+  {
+    const auto first{ container.begin() };
+    const auto size{ static_cast< std::size_t >( container.end() - first ) };
+
+    if ( const auto entry{ detail_n::branchless_lower_bound( first, size, key, compare ) }; entry != container.end() && !compare( key, *entry ) )
+      // Key exists -> return by pointer.
+      return &*entry;
+    else
+      // Key missing -> return nullptr.
+      return nullptr;
+  }
+
+  /*!
+    \brief Select an entry from a sorted container of integers, using an interpolation search.
+
+    For uniformly distributed keys, the position of \c key is estimated from the values at the bounds of the search range, taking O(log log n) steps on average.
+    If the estimates do not converge fast enough, the remaining range is searched by bisection, so the worst case stays O(log n).
+  */
+  template< detail_n::RandomAccess CONTAINER, std::integral KEY >
+    requires std::integral< std::remove_cvref_t< decltype( *std::declval< CONTAINER & >().begin() ) > >
+  auto select_interpolated( CONTAINER &container, const KEY key_value ) -> decltype( &*container.begin() )
+  {
+    // Compare integers of any type, including characters, without sign conversion surprises.
+    const auto key{ detail_n::widen( key_value ) };
+    const auto first{ container.begin() };
+    std::size_t low{ 0 };
+    std::size_t high{ static_cast< std::size_t >( container.end() - first ) };
+
+    // Estimates have to shrink the range fast, or the search falls back to bisection.
+    for ( auto remaining_guesses{ std::bit_width( high ) }; remaining_guesses > 0 && high - low > 2; --remaining_guesses )
+    {
+      const auto min{ detail_n::widen( first[ low ] ) };
+      const auto max{ detail_n::widen( first[ high - 1 ] ) };
+      if ( std::cmp_less( key, min ) || std::cmp_greater( key, max ) )
+        // Key outside of range -> missing.
+        return nullptr;
+      if ( std::cmp_equal( min, max ) )
+        break;
+
+      const auto fraction{ ( static_cast< long double >( key ) - static_cast< long double >( min ) ) / ( static_cast< long double >( max ) - static_cast< long double >( min ) ) };
+      const auto guess{ low + static_cast< std::size_t >( fraction * static_cast< long double >( high - 1 - low ) ) };
+
+      if ( std::cmp_less( detail_n::widen( first[ guess ] ), key ) )
+        low = guess + 1;
+      else if ( std::cmp_greater( detail_n::widen( first[ guess ] ), key ) )
+        high = guess;
+      else
+        return &first[ guess ];
+    }
+
+    const auto compare{ []( const auto &a, const auto &b ){ return std::cmp_less( detail_n::widen( a ), detail_n::widen( b ) ); } };
+    if ( const auto entry{ detail_n::branchless_lower_bound( first + low, high - low, key, compare ) }; entry != first + high && std::cmp_equal( detail_n::widen( *entry ), key ) )
+      return &*entry;
+    else
+      return nullptr;
+  }
+
+  /*!
+    \brief View a sorted container as a set.
+
+    The view provides a \c find member that does a branchless binary search, so \c select and \c select_or_default can be used on it like on a \c std::set .
+    The view does not own the container, which has to be kept alive and sorted with respect to \c COMPARE .
+  */
+  template< detail_n::RandomAccess CONTAINER, typename COMPARE = std::less<> >
+  class sorted_view
+  {
+  public:
+    using iterator = decltype( std::declval< CONTAINER & >().begin() );
+
+    explicit sorted_view( CONTAINER &container, COMPARE compare = {} ) : _container{ &container }, _compare{ std::move( compare ) } {}
+
+    iterator begin() const { return _container->begin(); }
+    iterator end() const { return _container->end(); }
+    std::size_t size() const { return static_cast< std::size_t >( end() - begin() ); }
+
+    //! The sorted elements, used as keys.
+    std::ranges::subrange< iterator > keys() const { return { begin(), end() }; }
+
+    //! The element at position \c index .
+    iterator nth( const std::size_t index ) const { return begin() + static_cast< std::ptrdiff_t >( index ); }
+
+    //! Find an element equivalent to \c key , or return the end iterator.
+    template< typename KEY >
+    iterator find( const KEY &key ) const
+    {
+      if ( const auto entry{ detail_n::branchless_lower_bound( begin(), size(), key, _compare ) }; entry != end() && !_compare( key, *entry ) )
+        return entry;
+      else
+        return end();
+    }
+
+    const COMPARE &key_comp() const noexcept { return _compare; }
+
+  private:
+    CONTAINER *_container;
+    COMPARE _compare;
+  };
+
+  /*!
+    \brief Sorted set of values, stored in Eytzinger (breadth first) order.
+
+    The implicit binary search tree places both children of a node at neighbouring indices, and the first few levels of the tree close to each other.
+    A lookup can therefore prefetch the descendants a few levels ahead, which makes it much more cache friendly than a binary search on a sorted array.
+    Iteration visits the values in layout order, not in sorted order.
+  */
+  template< typename T, typename COMPARE = std::less<> >
+  class eytzinger_set
+  {
+  public:
+    using value_type = T;
+    using const_iterator = const T *;
+    using iterator = const_iterator;
+
+    eytzinger_set() = default;
+
+    //! Build the set from the (not necessarily sorted) range \c [first, last) . Duplicates are dropped.
+    template< std::input_iterator ITERATOR >
+    eytzinger_set( ITERATOR first, ITERATOR last, COMPARE compare = {} ) : _compare{ std::move( compare ) }
+    {
+      std::vector< T > sorted( first, last );
+      std::sort( sorted.begin(), sorted.end(), _compare );
+      sorted.erase( std::unique( sorted.begin(), sorted.end(), [ this ]( const T &a, const T &b ){ return !_compare( a, b ); } ), sorted.end() );
+
+      // Slot 0 is unused, so the children of node k are 2k and 2k+1.
+      _values.resize( sorted.size() + 1 );
+      auto source{ sorted.begin() };
+      fill( source, 1 );
+    }
+
+    eytzinger_set( std::initializer_list< T > values, COMPARE compare = {} ) : eytzinger_set( values.begin(), values.end(), std::move( compare ) ) {}
+
+    const_iterator begin() const noexcept { return _values.data() + 1; }
+    const_iterator end() const noexcept { return _values.data() + _values.size(); }
+    std::size_t size() const noexcept { return _values.size() - 1; }
+    bool empty() const noexcept { return size() == 0; }
+
+    //! Find a value equivalent to \c key , or return the end iterator.
+    template< typename KEY >
+    const_iterator find( const KEY &key ) const
+    {
+      const auto data{ _values.data() };
+      const auto count{ _values.size() };
+
+      std::size_t node{ 1 };
+      while ( node < count )
+      {
+        if ( const auto ahead{ node * prefetch_stride }; ahead < count )
+        {
+          detail_n::prefetch( data + ahead );
+          detail_n::prefetch( data + std::min( ahead + prefetch_stride, count ) - 1 );
+        }
+        node = 2 * node + _compare( data[ node ], key );
+      }
+
+      // Undo the right turns after the last left turn, which went to the lower bound.
+      node >>= std::countr_one( node ) + 1;
+
+      if ( node != 0 && !_compare( key, data[ node ] ) )
+        return data + node;
+      else
+        return end();
+    }
+
+    const COMPARE &key_comp() const noexcept { return _compare; }
+
+  private:
+    /*!
+      The \c prefetch_stride descendants \c log2( prefetch_stride ) levels below node \c i are stored contiguously, starting at index \c i*prefetch_stride .
+      \c find prefetches the lines holding the first and the last of them.
+      As \c _values starts on a cache line, the block is exactly one line if \c sizeof( T ) is a power of two up to half a line, and at most two lines for other values of at most half a line.
+      Blocks of larger values span more lines, of which only the first and the last one are prefetched.
+    */
+    static constexpr std::size_t prefetch_stride{ std::bit_floor( std::max< std::size_t >( detail_n::cache_line_size / sizeof( T ), 2 ) ) };
+
+    template< typename ITERATOR >
+    void fill( ITERATOR &source, const std::size_t node )
+    {
+      if ( node < _values.size() )
+      {
+        // In-order traversal of the implicit tree visits the nodes in sorted order.
+        fill( source, 2 * node );
+        _values[ node ] = std::move( *source++ );
+        fill( source, 2 * node + 1 );
+      }
+    }
+
+    std::vector< T, detail_n::cache_aligned_allocator< T > > _values = std::vector< T, detail_n::cache_aligned_allocator< T > >( 1 );
+    COMPARE _compare;
+  };
+}
+
+//! A \c sorted_view only refers to its container, so its elements outlive the view, like those of a \c std::span .
+template< typename CONTAINER, typename COMPARE >
+inline constexpr bool std::ranges::enable_borrowed_range< select_n::sorted_view< CONTAINER, COMPARE > >{ true };
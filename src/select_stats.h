@@ -0,0 +1,425 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+/*!
+  \file
+  \brief Opt-in instrumentation of \c select , \c select_if and \c select_or_default .
+
+  Define \c SELECT_N_STATS before including any of the select headers to record, per call site, how often lookups hit or miss, how often defaults are used, and a sampled histogram of their latency.
+  Without \c SELECT_N_STATS , the instrumentation macros expand to nothing, and the functions keep their plain signatures.
+
+  Variadic functions cannot take a call site after their parameter pack. They record all their calls under a single site in the function itself, instead.
+
+  Each thread counts into its own table, so recording takes no locks and writes no shared cache lines.
+  When a thread exits, its counters are folded into a table shared by all finished threads, and its table is freed.
+  \c stats_n::snapshot() sums the tables of all running threads and the one of the finished threads.
+*/
+
+#ifdef SELECT_N_STATS
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//! Every this many instrumented calls per thread, the latency is measured.
+#ifndef SELECT_N_STATS_SAMPLE_PERIOD
+  #define SELECT_N_STATS_SAMPLE_PERIOD 64
+#endif
+
+/*!
+  Number of call sites a single thread can record. Calls from further sites are only counted as dropped.
+  Each recording thread allocates a table of this many sites of about 400 bytes each, i.e. about 100 KB with the default, until it exits.
+*/
+#ifndef SELECT_N_STATS_CAPACITY
+  #define SELECT_N_STATS_CAPACITY 256
+#endif
+
+namespace select_n::stats_n
+{
+  //! Number of latency histogram buckets. Bucket \c i counts latencies of less than \c 2^i nanoseconds.
+  inline constexpr std::size_t histogram_size{ 40 };
+
+  //! Statistics of a single call site.
+  struct site_stats
+  {
+    std::string_view file;
+    std::string_view function;
+    std::uint_least32_t line;
+    std::uint_least32_t column;
+    std::string_view operation;
+
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t defaults;
+
+    std::uint64_t samples;
+    std::array< std::uint64_t, histogram_size > latency_histogram;
+  };
+
+  namespace detail_n
+  {
+    //! Counters of a call site, written only by the owning thread.
+    struct site_counters
+    {
+      std::atomic< bool > used{ false };
+      const char *file{ nullptr };
+      const char *function{ nullptr };
+      const char *operation{ nullptr };
+      std::uint_least32_t line{ 0 };
+      std::uint_least32_t column{ 0 };
+
+      std::atomic< std::uint64_t > hits{ 0 };
+      std::atomic< std::uint64_t > misses{ 0 };
+      std::atomic< std::uint64_t > defaults{ 0 };
+      std::atomic< std::uint64_t > samples{ 0 };
+      std::array< std::atomic< std::uint64_t >, histogram_size > histogram{};
+    };
+
+    //! Add to a counter with a single writer, which needs no atomic read-modify-write.
+    inline void add( std::atomic< std::uint64_t > &counter, const std::uint64_t value ) noexcept
+    {
+      counter.store( counter.load( std::memory_order_relaxed ) + value, std::memory_order_relaxed );
+    }
+
+    inline void increment( std::atomic< std::uint64_t > &counter ) noexcept { add( counter, 1 ); }
+
+    //! Open addressing table of the call sites of one thread.
+    struct thread_table
+    {
+      std::array< site_counters, SELECT_N_STATS_CAPACITY > sites{};
+      std::atomic< std::uint64_t > dropped{ 0 };
+
+      //! Find or add the counters of a call site. Returns \c nullptr , and counts the call as dropped, if the table is full.
+      site_counters *site( const std::source_location &location, const char *operation ) noexcept
+      {
+        auto *slot{ find_or_add( location.file_name(), location.function_name(), location.line(), location.column(), operation ) };
+        if ( !slot )
+          increment( dropped );
+        return slot;
+      }
+
+      //! Find or add the counters of a call site. Returns \c nullptr if the table is full.
+      site_counters *find_or_add( const char *file, const char *function, const std::uint_least32_t line, const std::uint_least32_t column, const char *operation ) noexcept
+      {
+        const auto hash{ std::hash< const void * >{}( file ) ^ ( std::size_t{ line } << 16 ) ^ column };
+        for ( std::size_t probe{ 0 }; probe < sites.size(); ++probe )
+        {
+          auto &slot{ sites[ ( hash + probe ) % sites.size() ] };
+          if ( !slot.used.load( std::memory_order_relaxed ) )
+          {
+            slot.file = file;
+            slot.function = function;
+            slot.operation = operation;
+            slot.line = line;
+            slot.column = column;
+            // Publish the site description to snapshot readers.
+            slot.used.store( true, std::memory_order_release );
+            return &slot;
+          }
+          if ( slot.line == line && slot.column == column && slot.file == file && slot.operation == operation )
+            return &slot;
+        }
+        return nullptr;
+      }
+
+      //! Add the counters of \c other to this table. Sites that do not fit any more are counted as dropped.
+      void fold( const thread_table &other ) noexcept
+      {
+        add( dropped, other.dropped.load( std::memory_order_relaxed ) );
+        for ( const auto &slot : other.sites )
+          if ( slot.used.load( std::memory_order_relaxed ) )
+          {
+            auto *target{ find_or_add( slot.file, slot.function, slot.line, slot.column, slot.operation ) };
+            if ( !target )
+            {
+              add( dropped, slot.hits.load( std::memory_order_relaxed ) + slot.misses.load( std::memory_order_relaxed ) );
+              continue;
+            }
+
+            add( target->hits, slot.hits.load( std::memory_order_relaxed ) );
+            add( target->misses, slot.misses.load( std::memory_order_relaxed ) );
+            add( target->defaults, slot.defaults.load( std::memory_order_relaxed ) );
+            add( target->samples, slot.samples.load( std::memory_order_relaxed ) );
+            for ( std::size_t bucket{ 0 }; bucket < histogram_size; ++bucket )
+              add( target->histogram[ bucket ], slot.histogram[ bucket ].load( std::memory_order_relaxed ) );
+          }
+      }
+
+      //! Zero all counters. Call sites stay registered.
+      void reset() noexcept
+      {
+        dropped.store( 0, std::memory_order_relaxed );
+        for ( auto &slot : sites )
+        {
+          for ( auto *counter : { &slot.hits, &slot.misses, &slot.defaults, &slot.samples } )
+            counter->store( 0, std::memory_order_relaxed );
+          for ( auto &bucket : slot.histogram )
+            bucket.store( 0, std::memory_order_relaxed );
+        }
+      }
+    };
+
+    //! Tables of all running threads that recorded statistics, and the summed up counters of the finished ones.
+    struct registry
+    {
+      std::mutex mutex;
+      std::vector< std::unique_ptr< thread_table > > tables;
+      thread_table retired;
+
+      //! Call \c function with the table of each running thread, and the one of the finished threads. The caller has to hold \c mutex .
+      template< typename FUNCTION >
+      void for_each_table( FUNCTION &&function )
+      {
+        for ( const auto &table : tables )
+          function( *table );
+        function( retired );
+      }
+
+      //! Fold the counters of a finished thread into \c retired , and free its table.
+      void retire( const thread_table *table ) noexcept
+      {
+        const std::lock_guard lock{ mutex };
+        const auto entry{ std::find_if( tables.begin(), tables.end(), [ table ]( const auto &owned ){ return owned.get() == table; } ) };
+        retired.fold( **entry );
+        tables.erase( entry );
+      }
+
+      static registry &instance()
+      {
+        static registry instance;
+        return instance;
+      }
+    };
+
+    //! Recording state of the current thread.
+    struct thread_state
+    {
+      thread_table *table{ nullptr };
+      std::size_t depth{ 0 };
+      std::uint64_t calls{ 0 };
+
+      thread_state() = default;
+      thread_state( const thread_state & ) = delete;
+      thread_state &operator=( const thread_state & ) = delete;
+
+      ~thread_state()
+      {
+        if ( table )
+          registry::instance().retire( std::exchange( table, nullptr ) );
+      }
+
+      thread_table &get_table()
+      {
+        if ( !table )
+        {
+          auto &instance{ registry::instance() };
+          const std::lock_guard lock{ instance.mutex };
+          table = instance.tables.emplace_back( std::make_unique< thread_table >() ).get();
+        }
+        return *table;
+      }
+
+      static thread_state &current() noexcept
+      {
+        thread_local thread_state state;
+        return state;
+      }
+    };
+
+    //! Outcome of an instrumented call.
+    enum class outcome
+    {
+      HIT,
+      MISS,
+      DEFAULT,
+    };
+
+    /*!
+      \brief Records a single instrumented call.
+
+      Only the outermost probe of a thread records, so e.g. the \c select inside \c select_or_default is not counted twice.
+      During constant evaluation, probes do nothing.
+    */
+    class probe
+    {
+    public:
+      constexpr probe( const std::source_location &location, const char *operation ) noexcept : _location{ location }, _operation{ operation }
+      {
+        if ( !std::is_constant_evaluated() )
+        {
+          auto &state{ thread_state::current() };
+          _outermost = state.depth++ == 0;
+          if ( _outermost && ++state.calls % SELECT_N_STATS_SAMPLE_PERIOD == 0 )
+            _start = std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+      }
+
+      constexpr ~probe()
+      {
+        if ( !std::is_constant_evaluated() )
+          --thread_state::current().depth;
+      }
+
+      probe( const probe & ) = delete;
+      probe &operator=( const probe & ) = delete;
+
+      //! Record the outcome, and pass \c result through.
+      template< typename RESULT >
+      constexpr RESULT &&record( const outcome kind, RESULT &&result ) const noexcept
+      {
+        if ( !std::is_constant_evaluated() && _outermost )
+          record( kind );
+        return std::forward< RESULT >( result );
+      }
+
+    private:
+      void record( const outcome kind ) const noexcept
+      {
+        const auto end{ _start ? std::chrono::steady_clock::now().time_since_epoch().count() : 0 };
+
+        try
+        {
+          auto *site{ thread_state::current().get_table().site( _location, _operation ) };
+          if ( !site )
+            return;
+
+          switch ( kind )
+          {
+            case outcome::HIT: increment( site->hits ); break;
+            case outcome::MISS: increment( site->misses ); break;
+            case outcome::DEFAULT: increment( site->misses ); increment( site->defaults ); break;
+          }
+
+          if ( _start )
+          {
+            const auto nanoseconds{ std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::duration{ end - _start } ).count() };
+            increment( site->samples );
+            increment( site->histogram[ std::min< std::size_t >( std::bit_width( static_cast< std::uint64_t >( std::max< decltype( nanoseconds ) >( nanoseconds, 0 ) ) ), histogram_size - 1 ) ] );
+          }
+        }
+        catch ( ... )
+        {
+          // Registering the thread failed -> lose this record, rather than the lookup.
+        }
+      }
+
+      std::source_location _location;
+      const char *_operation;
+      bool _outermost{ false };
+      std::chrono::steady_clock::rep _start{ 0 };
+    };
+  }
+
+  //! Sum up the statistics of all threads, per call site.
+  inline std::vector< site_stats > snapshot()
+  {
+    using key_t = std::tuple< std::string_view, std::uint_least32_t, std::uint_least32_t, std::string_view >;
+    std::map< key_t, site_stats > sites;
+
+    auto &registry{ detail_n::registry::instance() };
+    const std::lock_guard lock{ registry.mutex };
+    registry.for_each_table( [ &sites ]( const detail_n::thread_table &table ) {
+      for ( const auto &slot : table.sites )
+        if ( slot.used.load( std::memory_order_acquire ) )
+        {
+          auto [ entry, added ]{ sites.try_emplace( key_t{ slot.file, slot.line, slot.column, slot.operation } ) };
+          auto &stats{ entry->second };
+          if ( added )
+            stats = { slot.file, slot.function, slot.line, slot.column, slot.operation, 0, 0, 0, 0, {} };
+
+          stats.hits += slot.hits.load( std::memory_order_relaxed );
+          stats.misses += slot.misses.load( std::memory_order_relaxed );
+          stats.defaults += slot.defaults.load( std::memory_order_relaxed );
+          stats.samples += slot.samples.load( std::memory_order_relaxed );
+          for ( std::size_t bucket{ 0 }; bucket < histogram_size; ++bucket )
+            stats.latency_histogram[ bucket ] += slot.histogram[ bucket ].load( std::memory_order_relaxed );
+        }
+    } );
+
+    std::vector< site_stats > result;
+    for ( auto &[ key, stats ] : sites )
+      result.push_back( stats );
+    return result;
+  }
+
+  //! Number of calls, which could not be recorded, because a thread's table was full.
+  inline std::uint64_t dropped()
+  {
+    auto &registry{ detail_n::registry::instance() };
+    const std::lock_guard lock{ registry.mutex };
+
+    std::uint64_t result{ 0 };
+    registry.for_each_table( [ &result ]( const detail_n::thread_table &table ) { result += table.dropped.load( std::memory_order_relaxed ); } );
+    return result;
+  }
+
+  //! Reset all counters. Call sites stay registered.
+  inline void reset()
+  {
+    auto &registry{ detail_n::registry::instance() };
+    const std::lock_guard lock{ registry.mutex };
+    registry.for_each_table( []( detail_n::thread_table &table ) { table.reset(); } );
+  }
+
+  //! Write a human readable report of \c snapshot() to \c stream , sites with most misses first.
+  inline void dump( std::ostream &stream )
+  {
+    auto sites{ snapshot() };
+    std::sort( sites.begin(), sites.end(), []( const site_stats &a, const site_stats &b ){ return a.misses > b.misses; } );
+
+    for ( const auto &site : sites )
+    {
+      stream << site.file << ':' << site.line << ':' << site.column << ' ' << site.operation
+             << " hits=" << site.hits << " misses=" << site.misses << " defaults=" << site.defaults << " latency[ns<]={";
+      for ( std::size_t bucket{ 0 }; bucket < histogram_size; ++bucket )
+        if ( site.latency_histogram[ bucket ] )
+          stream << ' ' << ( std::uint64_t{ 1 } << bucket ) << ':' << site.latency_histogram[ bucket ];
+      stream << " }\n";
+    }
+  }
+}
+
+//! Trailing parameter capturing the call site of an instrumented function.
+#define SELECT_N_LOCATION_PARAMETER , const std::source_location location = std::source_location::current()
+//! Pass the captured call site on to another instrumented function.
+#define SELECT_N_LOCATION_ARGUMENT , location
+//! Start recording the call of \c operation .
+#define SELECT_N_PROBE( operation ) const ::select_n::stats_n::detail_n::probe select_n_probe{ location, operation }
+//! Record the outcome of the call, and evaluate to \c result .
+#define SELECT_N_HIT( result ) select_n_probe.record( ::select_n::stats_n::detail_n::outcome::HIT, result )
+#define SELECT_N_MISS( result ) select_n_probe.record( ::select_n::stats_n::detail_n::outcome::MISS, result )
+#define SELECT_N_DEFAULT( result ) select_n_probe.record( ::select_n::stats_n::detail_n::outcome::DEFAULT, result )
+//! Record a hit if \c found , or a miss otherwise, and evaluate to \c result .
+#define SELECT_N_HIT_IF( found, result ) select_n_probe.record( ( found ) ? ::select_n::stats_n::detail_n::outcome::HIT : ::select_n::stats_n::detail_n::outcome::MISS, result )
+//! Start recording the call of \c operation under the site of the function itself, for functions which cannot take a call site.
+#define SELECT_N_FUNCTION_PROBE( operation ) const ::select_n::stats_n::detail_n::probe select_n_probe{ std::source_location::current(), operation }
+
+#else
+
+#define SELECT_N_LOCATION_PARAMETER
+#define SELECT_N_LOCATION_ARGUMENT
+#define SELECT_N_PROBE( operation )
+#define SELECT_N_FUNCTION_PROBE( operation )
+#define SELECT_N_HIT( result ) result
+#define SELECT_N_MISS( result ) result
+#define SELECT_N_DEFAULT( result ) result
+#define SELECT_N_HIT_IF( found, result ) result
+
+#endif
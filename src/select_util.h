@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 
 namespace select_n::detail_n
@@ -30,4 +34,69 @@ namespace select_n::detail_n
   //! Make reference or non-reference version of \c T depending on \c condition .
   template< bool condition, typename T >
   using conditional_reference_t = std::conditional_t< condition, std::add_lvalue_reference_t< T >, std::remove_reference_t< T > >;
+
+  //! Finalizer of the SplitMix64 generator, spreading the bits of \c value over the whole word.
+  constexpr std::uint64_t mix( std::uint64_t value ) noexcept
+  {
+    value = ( value ^ ( value >> 30 ) ) * 0xbf58476d1ce4e5b9u;
+    value = ( value ^ ( value >> 27 ) ) * 0x94d049bb133111ebu;
+    return value ^ ( value >> 31 );
+  }
+
+  //! Inline storage for up to \c N objects, which are constructed and destroyed explicitly.
+  template< typename T, std::size_t N >
+  union uninitialized_array
+  {
+    uninitialized_array() noexcept {}
+    ~uninitialized_array() {}
+
+    T items[ N ];
+  };
+
+  //! Number of stripes of \c striped_counters , i.e. of threads counting without sharing a cache line.
+  inline constexpr std::size_t counter_stripes{ 16 };
+
+  //! Stripe of \c striped_counters the current thread counts in, assigned round robin on first use.
+  inline std::size_t counter_stripe() noexcept
+  {
+    static std::atomic< std::size_t > next{ 0 };
+    thread_local const std::size_t stripe{ next.fetch_add( 1, std::memory_order_relaxed ) % counter_stripes };
+    return stripe;
+  }
+
+  /*!
+    \brief \c N statistics counters, striped over cache lines per thread.
+
+    Each thread increments the counters of its own stripe, so concurrent readers counting their lookups neither contend, nor evict the cache lines of the counted container.
+    Reading a counter sums it over all stripes.
+  */
+  template< std::size_t N >
+  class striped_counters
+  {
+  public:
+    void increment( const std::size_t counter ) noexcept { _stripes[ counter_stripe() ].counts[ counter ].fetch_add( 1, std::memory_order_relaxed ); }
+
+    std::uint64_t sum( const std::size_t counter ) const noexcept
+    {
+      std::uint64_t result{ 0 };
+      for ( const auto &stripe : _stripes )
+        result += stripe.counts[ counter ].load( std::memory_order_relaxed );
+      return result;
+    }
+
+    void reset() noexcept
+    {
+      for ( auto &stripe : _stripes )
+        for ( auto &count : stripe.counts )
+          count.store( 0, std::memory_order_relaxed );
+    }
+
+  private:
+    struct alignas( 64 ) stripe_t
+    {
+      std::array< std::atomic< std::uint64_t >, N > counts{};
+    };
+
+    std::array< stripe_t, counter_stripes > _stripes{};
+  };
 }
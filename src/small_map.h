@@ -0,0 +1,531 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "flat_map.h"
+#include "key_hash.h"
+#include "select_simd.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    /*!
+      \brief Open addressing hash index over the positions of entries stored elsewhere.
+
+      Each slot holds the high half of an entry's hash and its position plus one, so zero marks empty slots.
+      Collisions are resolved by linear probing, and erasure shifts the following slots back, so there are no tombstones.
+      As the hashes are stored, growing the index does not hash any key again.
+    */
+    class position_index
+    {
+    public:
+      static constexpr std::size_t npos{ std::numeric_limits< std::size_t >::max() };
+
+      position_index() = default;
+
+      //! Index with \c slots slots, which has to be a power of two.
+      explicit position_index( const std::size_t slots ) : _slots{ std::make_unique< slot_t[] >( slots ) }, _mask{ slots - 1 } {}
+
+      std::size_t slot_count() const noexcept { return _slots ? _mask + 1 : 0; }
+
+      //! Slot of the position with \c hash , for which \c match returns \c true , or \c npos if there is none.
+      template< typename MATCH >
+      std::size_t find( const std::uint32_t hash, const MATCH &match ) const
+      {
+        for ( auto slot{ hash & _mask }; _slots[ slot ].position != 0; slot = ( slot + 1 ) & _mask )
+          if ( _slots[ slot ].hash == hash && match( std::size_t{ _slots[ slot ].position - 1u } ) )
+            return slot;
+        return npos;
+      }
+
+      std::size_t position( const std::size_t slot ) const noexcept { return _slots[ slot ].position - 1u; }
+
+      //! Let \c slot refer to another position, e.g. after the entry moved.
+      void relocate( const std::size_t slot, const std::size_t position ) noexcept { _slots[ slot ].position = static_cast< std::uint32_t >( position + 1 ); }
+
+      //! Add \c position with \c hash . There has to be an empty slot.
+      void insert( const std::uint32_t hash, const std::size_t position ) noexcept
+      {
+        auto slot{ hash & _mask };
+        while ( _slots[ slot ].position != 0 )
+          slot = ( slot + 1 ) & _mask;
+        _slots[ slot ] = { hash, static_cast< std::uint32_t >( position + 1 ) };
+      }
+
+      //! Empty \c slot , and move back following slots, which would not be found anymore otherwise.
+      void erase( std::size_t slot ) noexcept
+      {
+        for ( auto next{ ( slot + 1 ) & _mask }; _slots[ next ].position != 0; next = ( next + 1 ) & _mask )
+          if ( const auto home{ _slots[ next ].hash & _mask }; ( ( next - home ) & _mask ) >= ( ( next - slot ) & _mask ) )
+          {
+            // Home of the slot is at or before the gap -> fill the gap.
+            _slots[ slot ] = _slots[ next ];
+            slot = next;
+          }
+        _slots[ slot ] = {};
+      }
+
+      //! Index of \c slots slots with the same positions.
+      position_index resized( const std::size_t slots ) const
+      {
+        position_index result{ slots };
+        for ( std::size_t slot{ 0 }; slot < slot_count(); ++slot )
+          if ( _slots[ slot ].position != 0 )
+            result.insert( _slots[ slot ].hash, _slots[ slot ].position - 1u );
+        return result;
+      }
+
+    private:
+      struct slot_t
+      {
+        std::uint32_t hash;
+        std::uint32_t position;
+      };
+
+      std::unique_ptr< slot_t[] > _slots;
+      std::size_t _mask{ 0 };
+    };
+  }
+
+  /*!
+    \brief Associative container for mostly small maps, storing up to \c N entries inline, and switching to a hash index beyond.
+
+    Up to \c N entries, keys and mapped values are stored in inline arrays, and a lookup is a linear scan over the keys.
+    Integral keys compared by \c std::equal_to are scanned with SIMD instructions, if available.
+    So neither building nor querying a small map allocates, and \c select and \c select_or_default on it touch no heap memory.
+
+    Once the map grows beyond \c N entries, the entries migrate to heap allocated arrays, indexed by an open addressing hash table.
+    The map stays hashed until it is cleared.
+
+    Like \c flat_map , iterators dereference to proxies holding references to the key and mapped value, so \c select_if has to be applied to \c keys() or \c values() .
+    Lookups by other types than \c KEY convert the key once the map is hashed, unless \c HASH is transparent, like the default \c key_hash for strings.
+    Erasure moves the last entry into the gap, so it invalidates iterators and references to the last entry.
+  */
+  template< typename KEY, typename T, std::size_t N = 16, typename HASH = key_hash< KEY >, typename EQUAL = std::equal_to<> >
+    requires ( N > 0 )
+  class small_map
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = T;
+    using hasher = HASH;
+    using key_equal = EQUAL;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using reference = detail_n::split_reference< KEY, T, false >;
+    using const_reference = detail_n::split_reference< KEY, T, true >;
+    using iterator = detail_n::split_iterator< KEY, T, false >;
+    using const_iterator = detail_n::split_iterator< KEY, T, true >;
+
+    //! Number of entries stored inline.
+    static constexpr size_type inline_capacity{ N };
+
+    small_map() = default;
+
+    explicit small_map( HASH hash, EQUAL equal = {} ) : _hash{ std::move( hash ) }, _equal{ std::move( equal ) } {}
+
+    //! Build the map from \c entries . For duplicate keys, the first entry is kept.
+    small_map( std::initializer_list< std::pair< KEY, T > > entries, HASH hash = {}, EQUAL equal = {} ) : small_map( entries.begin(), entries.end(), std::move( hash ), std::move( equal ) ) {}
+
+    //! Build the map from the range \c [first, last) of key value pairs. For duplicate keys, the first entry is kept.
+    template< std::input_iterator ITERATOR >
+    small_map( ITERATOR first, ITERATOR last, HASH hash = {}, EQUAL equal = {} ) : small_map( std::move( hash ), std::move( equal ) )
+    {
+      for ( ; first != last; ++first )
+        try_emplace( first->first, first->second );
+    }
+
+    small_map( const small_map &other ) : small_map( other._hash, other._equal )
+    {
+      for ( const auto &entry : other )
+        try_emplace( entry.first, entry.second );
+    }
+
+    //! Take over the entries of \c other , which is left empty.
+    small_map( small_map &&other ) noexcept( std::is_nothrow_move_constructible_v< KEY > && std::is_nothrow_move_constructible_v< T > ) : small_map( other._hash, other._equal )
+    {
+      take( std::move( other ) );
+    }
+
+    small_map &operator=( const small_map &other )
+    {
+      if ( this != &other )
+        *this = small_map{ other };
+      return *this;
+    }
+
+    small_map &operator=( small_map &&other ) noexcept( std::is_nothrow_move_constructible_v< KEY > && std::is_nothrow_move_constructible_v< T > )
+    {
+      if ( this != &other )
+      {
+        clear();
+        _hash = other._hash;
+        _equal = other._equal;
+        take( std::move( other ) );
+      }
+      return *this;
+    }
+
+    ~small_map() { destroy_inline(); }
+
+    iterator begin() noexcept { return { keys_data(), values_data() }; }
+    iterator end() noexcept { return begin() + static_cast< difference_type >( size() ); }
+    const_iterator begin() const noexcept { return { keys_data(), values_data() }; }
+    const_iterator end() const noexcept { return begin() + static_cast< difference_type >( size() ); }
+
+    size_type size() const noexcept { return hashed() ? _keys.size() : _size; }
+    bool empty() const noexcept { return size() == 0; }
+
+    //! The keys, stored contiguously in the order of insertion, up to erasures.
+    std::span< const KEY > keys() const noexcept { return { keys_data(), size() }; }
+    //! The mapped values, in the order of their keys.
+    std::span< T > values() noexcept { return { values_data(), size() }; }
+    std::span< const T > values() const noexcept { return { values_data(), size() }; }
+
+    const HASH &hash_function() const noexcept { return _hash; }
+    const EQUAL &key_eq() const noexcept { return _equal; }
+
+    //! Hash of \c key , to be passed to \c find or \c select_hashed .
+    template< typename OTHER >
+    std::size_t hash( const OTHER &key ) const
+    {
+      if constexpr ( std::same_as< OTHER, KEY > || requires { typename HASH::is_transparent; } )
+        return static_cast< std::size_t >( _hash( key ) );
+      else
+        // Hash is not transparent -> convert to the key type.
+        return static_cast< std::size_t >( _hash( static_cast< KEY >( key ) ) );
+    }
+
+    //! Whether the entries migrated to the heap and are found by hash.
+    bool hashed() const noexcept { return _index.slot_count() != 0; }
+
+    //! Find an entry for \c key , or return the end iterator.
+    template< typename OTHER >
+    iterator find( const OTHER &key ) { return begin() + static_cast< difference_type >( find_position( key ) ); }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return begin() + static_cast< difference_type >( find_position( key ) ); }
+
+    //! Find an entry for \c key , whose \c hash has been computed by \c hash_function() already. Inline entries are scanned, ignoring \c hash .
+    template< typename OTHER >
+    iterator find( const OTHER &key, const std::size_t hash ) { return begin() + static_cast< difference_type >( hashed() ? find_hashed( key, hash ) : scan( key ) ); }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key, const std::size_t hash ) const { return begin() + static_cast< difference_type >( hashed() ? find_hashed( key, hash ) : scan( key ) ); }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find_position( key ) < size(); }
+
+    template< typename OTHER >
+    size_type count( const OTHER &key ) const { return contains( key ) ? 1 : 0; }
+
+    template< typename OTHER >
+    T &at( const OTHER &key )
+    {
+      if ( const auto position{ find_position( key ) }; position < size() )
+        return values_data()[ position ];
+      else
+        throw std::out_of_range{ "small_map::at" };
+    }
+
+    template< typename OTHER >
+    const T &at( const OTHER &key ) const
+    {
+      if ( const auto position{ find_position( key ) }; position < size() )
+        return values_data()[ position ];
+      else
+        throw std::out_of_range{ "small_map::at" };
+    }
+
+    //! Insert an entry constructed from \c args for \c key , unless \c key already exists.
+    template< typename... ARGS >
+    std::pair< iterator, bool > try_emplace( const KEY &key, ARGS &&... args )
+    {
+      if ( !hashed() )
+      {
+        if ( const auto position{ scan( key ) }; position < _size )
+          return { begin() + static_cast< difference_type >( position ), false };
+
+        if ( _size < N )
+        {
+          // Room left -> append inline.
+          std::construct_at( &_inline_keys.items[ _size ], key );
+          try
+          {
+            std::construct_at( &_inline_values.items[ _size ], std::forward< ARGS >( args )... );
+          }
+          catch ( ... )
+          {
+            std::destroy_at( &_inline_keys.items[ _size ] );
+            throw;
+          }
+          return { begin() + static_cast< difference_type >( _size++ ), true };
+        }
+
+        // Inline storage exhausted -> switch to the hash index.
+        migrate();
+        return { append( hash_of( key ), key, std::forward< ARGS >( args )... ), true };
+      }
+
+      const auto digest{ hash_of( key ) };
+      if ( const auto slot{ find_slot( digest, key ) }; slot != detail_n::position_index::npos )
+        return { begin() + static_cast< difference_type >( _index.position( slot ) ), false };
+      else
+        return { append( digest, key, std::forward< ARGS >( args )... ), true };
+    }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > emplace( const KEY &key, VALUE &&value ) { return try_emplace( key, std::forward< VALUE >( value ) ); }
+
+    std::pair< iterator, bool > insert( std::pair< KEY, T > entry ) { return try_emplace( entry.first, std::move( entry.second ) ); }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > insert_or_assign( const KEY &key, VALUE &&value )
+    {
+      if ( const auto position{ find_position( key ) }; position < size() )
+      {
+        values_data()[ position ] = std::forward< VALUE >( value );
+        return { begin() + static_cast< difference_type >( position ), false };
+      }
+      else
+        return try_emplace( key, std::forward< VALUE >( value ) );
+    }
+
+    T &operator[]( const KEY &key ) { return try_emplace( key ).first->second; }
+
+    //! Remove the entry for \c key , and return the number of removed entries. The last entry moves into the gap.
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      if ( !hashed() )
+      {
+        const auto position{ scan( key ) };
+        if ( position == _size )
+          return 0;
+
+        if ( const auto last{ _size - 1 }; position != last )
+        {
+          _inline_keys.items[ position ] = std::move( _inline_keys.items[ last ] );
+          _inline_values.items[ position ] = std::move( _inline_values.items[ last ] );
+        }
+        --_size;
+        std::destroy_at( &_inline_keys.items[ _size ] );
+        std::destroy_at( &_inline_values.items[ _size ] );
+        return 1;
+      }
+
+      const auto slot{ find_slot( hash_of( key ), key ) };
+      if ( slot == detail_n::position_index::npos )
+        return 0;
+
+      const auto position{ _index.position( slot ) };
+      if ( const auto last{ _keys.size() - 1 }; position != last )
+      {
+        // Hash and move, which may throw, before the index changes.
+        const auto last_hash{ hash_of( _keys[ last ] ) };
+        _keys[ position ] = std::move( _keys[ last ] );
+        _values[ position ] = std::move( _values[ last ] );
+
+        // Let the slot of the last entry refer to the gap.
+        _index.erase( slot );
+        _index.relocate( _index.find( last_hash, [ last ]( const size_type other ) noexcept { return other == last; } ), position );
+      }
+      else
+        _index.erase( slot );
+      _keys.pop_back();
+      _values.pop_back();
+      return 1;
+    }
+
+    //! Remove all entries, and release the heap storage, so the map starts over inline.
+    void clear() noexcept
+    {
+      destroy_inline();
+      _keys = {};
+      _values = {};
+      _index = {};
+    }
+
+  private:
+    //! Keys compared by their bit patterns are scanned by SIMD instructions.
+    template< typename OTHER >
+    static constexpr bool simd_scan{ detail_n::SimdComparable< KEY > && detail_n::SimdComparable< OTHER > && ( std::same_as< EQUAL, std::equal_to<> > || std::same_as< EQUAL, std::equal_to< KEY > > ) };
+
+    const KEY *keys_data() const noexcept { return hashed() ? _keys.data() : _inline_keys.items; }
+    const T *values_data() const noexcept { return hashed() ? _values.data() : _inline_values.items; }
+    T *values_data() noexcept { return hashed() ? _values.data() : _inline_values.items; }
+
+    //! The high half of the mixed hash. Positions are stored in 32 bits as well, so slots stay small.
+    static std::uint32_t index_hash( const std::size_t hash ) noexcept { return static_cast< std::uint32_t >( detail_n::mix( static_cast< std::uint64_t >( hash ) ) >> 32 ); }
+
+    template< typename OTHER >
+    std::uint32_t hash_of( const OTHER &key ) const { return index_hash( hash( key ) ); }
+
+    //! Position of the inline entry for \c key , or the number of inline entries if there is none.
+    template< typename OTHER >
+    size_type scan( const OTHER &key ) const
+    {
+      const auto *keys{ _inline_keys.items };
+      if constexpr ( simd_scan< OTHER > )
+      {
+        const auto needle{ detail_n::simd_needle< KEY >( key ) };
+        return needle ? detail_n::simd_find_index( keys, _size, *needle ) : _size;
+      }
+      else
+      {
+        size_type position{ 0 };
+        while ( position < _size && !_equal( keys[ position ], key ) )
+          ++position;
+        return position;
+      }
+    }
+
+    template< typename OTHER >
+    size_type find_slot( const std::uint32_t hash, const OTHER &key ) const
+    {
+      return _index.find( hash, [ this, &key ]( const size_type position ){ return _equal( _keys[ position ], key ); } );
+    }
+
+    //! Position of the entry for \c key , or the size of the map if there is none.
+    template< typename OTHER >
+    size_type find_position( const OTHER &key ) const { return hashed() ? find_hashed( key, hash( key ) ) : scan( key ); }
+
+    template< typename OTHER >
+    size_type find_hashed( const OTHER &key, const std::size_t hash ) const
+    {
+      if ( const auto slot{ find_slot( index_hash( hash ), key ) }; slot != detail_n::position_index::npos )
+        return _index.position( slot );
+      else
+        return _keys.size();
+    }
+
+    //! Add an entry for the missing \c key to the heap arrays, growing the index if needed.
+    template< typename... ARGS >
+    iterator append( const std::uint32_t hash, const KEY &key, ARGS &&... args )
+    {
+      const auto position{ _keys.size() };
+      if ( position >= std::numeric_limits< std::uint32_t >::max() - 1 )
+        throw std::length_error{ "small_map::try_emplace" };
+      if ( 2 * ( position + 1 ) > _index.slot_count() )
+        // Keep the load factor at one half at most, for short probe sequences.
+        _index = _index.resized( 2 * _index.slot_count() );
+
+      _keys.push_back( key );
+      try
+      {
+        _values.emplace_back( std::forward< ARGS >( args )... );
+      }
+      catch ( ... )
+      {
+        // Keep keys and values in sync.
+        _keys.pop_back();
+        throw;
+      }
+      _index.insert( hash, position );
+      return begin() + static_cast< difference_type >( position );
+    }
+
+    //! Move the inline entries to the heap arrays, and index them. Leaves the map unchanged if this throws.
+    void migrate()
+    {
+      // Allocate and hash before anything is moved out of the inline entries.
+      detail_n::position_index index{ std::bit_ceil( 4 * N ) };
+      for ( size_type position{ 0 }; position < _size; ++position )
+        index.insert( hash_of( _inline_keys.items[ position ] ), position );
+
+      std::vector< KEY > keys;
+      std::vector< T > values;
+      keys.reserve( 2 * N );
+      values.reserve( 2 * N );
+
+      const auto transfer{ [ this ]< typename ITEM >( std::vector< ITEM > &target, ITEM *items )
+      {
+        for ( size_type position{ 0 }; position < _size; ++position )
+          target.push_back( std::move_if_noexcept( items[ position ] ) );
+      } };
+      if constexpr ( std::is_nothrow_move_constructible_v< KEY > )
+      {
+        // Values may be copied, which may throw -> transfer them while the keys are untouched.
+        transfer( values, _inline_values.items );
+        transfer( keys, _inline_keys.items );
+      }
+      else
+      {
+        // Keys are copied, so the inline entries stay intact until the values are moved.
+        transfer( keys, _inline_keys.items );
+        transfer( values, _inline_values.items );
+      }
+
+      destroy_inline();
+      _keys = std::move( keys );
+      _values = std::move( values );
+      _index = std::move( index );
+    }
+
+    //! Take over the entries of \c other , while this map is empty. Leaves \c other empty.
+    void take( small_map &&other )
+    {
+      if ( other.hashed() )
+      {
+        _keys = std::move( other._keys );
+        _values = std::move( other._values );
+        _index = std::move( other._index );
+      }
+      else
+      {
+        for ( ; _size < other._size; ++_size )
+        {
+          std::construct_at( &_inline_keys.items[ _size ], std::move( other._inline_keys.items[ _size ] ) );
+          try
+          {
+            std::construct_at( &_inline_values.items[ _size ], std::move( other._inline_values.items[ _size ] ) );
+          }
+          catch ( ... )
+          {
+            std::destroy_at( &_inline_keys.items[ _size ] );
+            throw;
+          }
+        }
+      }
+      other.clear();
+    }
+
+    void destroy_inline() noexcept
+    {
+      std::destroy_n( _inline_keys.items, _size );
+      std::destroy_n( _inline_values.items, _size );
+      _size = 0;
+    }
+
+    HASH _hash;
+    EQUAL _equal;
+
+    //! Storage up to \c N entries.
+    size_type _size{ 0 };
+    detail_n::uninitialized_array< KEY, N > _inline_keys;
+    detail_n::uninitialized_array< T, N > _inline_values;
+
+    //! Storage beyond \c N entries.
+    std::vector< KEY > _keys;
+    std::vector< T > _values;
+    detail_n::position_index _index;
+  };
+}
@@ -0,0 +1,167 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include "epoch.h"
+#include "select.h"
+#include "select_handle.h"
+
+namespace select_n
+{
+  /*!
+    \brief Read mostly map, publishing immutable versions of a \c MAP .
+
+    Readers \c load a \c snapshot , i.e. the current version of the map, which stays valid and unchanged while the snapshot exists.
+    Taking a snapshot is an atomic load within an epoch critical section, so readers take no locks and write no shared cache lines.
+    Writers \c store a new version, or \c update a copy of the current one.
+    Each publication reclaims the replaced versions, which no snapshot refers to anymore.
+    Replaced versions are handed to all threads, so a version that is still held by a snapshot when it is replaced stays allocated
+    until a later \c store or \c update on any thread, or another reclamation of the epoch domain, even after the snapshot is released.
+
+    A \c snapshot is \c MapLike itself, so \c select and \c select_or_default on it work just like on \c MAP .
+    For single lookups, \c select on the \c snapshot_map returns a \c select_handle , which holds the snapshot.
+  */
+  template< typename MAP >
+  class snapshot_map
+  {
+  public:
+    using map_type = MAP;
+
+    //! Immutable version of the map. It must be released on the thread that loaded it.
+    class snapshot
+    {
+    public:
+      snapshot() = default;
+
+      const MAP &operator*() const noexcept { return *_map; }
+      const MAP *operator->() const noexcept { return _map; }
+
+      //! Number of the version, counting from zero for the map that the \c snapshot_map was constructed with.
+      std::uint64_t version() const noexcept { return _version; }
+
+      auto begin() const { return _map->begin(); }
+      auto end() const { return _map->end(); }
+      auto size() const { return _map->size(); }
+      bool empty() const { return _map->empty(); }
+
+      template< typename KEY >
+      auto find( KEY &&key ) const -> decltype( std::declval< const MAP & >().find( std::forward< KEY >( key ) ) ) { return _map->find( std::forward< KEY >( key ) ); }
+
+      //! Give up the snapshot, but keep the critical section, e.g. to hand it on to a \c select_handle .
+      detail_n::epoch_guard release() && noexcept
+      {
+        _map = nullptr;
+        return std::move( _guard );
+      }
+
+    private:
+      friend snapshot_map;
+
+      snapshot( detail_n::epoch_guard guard, const MAP *map, const std::uint64_t version ) noexcept : _guard{ std::move( guard ) }, _map{ map }, _version{ version } {}
+
+      detail_n::epoch_guard _guard;
+      const MAP *_map{ nullptr };
+      std::uint64_t _version{ 0 };
+    };
+
+    explicit snapshot_map( MAP map = {} ) : _current{ new version_t{ std::move( map ), 0 } } {}
+
+    snapshot_map( const snapshot_map & ) = delete;
+    snapshot_map &operator=( const snapshot_map & ) = delete;
+
+    //! No other thread may access the map anymore, so the current version is destroyed right away.
+    ~snapshot_map() { delete _current.load( std::memory_order_relaxed ); }
+
+    //! Take a snapshot of the current version.
+    snapshot load() const
+    {
+      auto guard{ detail_n::epoch_guard::enter() };
+      const auto *current{ _current.load( std::memory_order_acquire ) };
+      return { std::move( guard ), &current->map, current->version };
+    }
+
+    //! Number of the current version.
+    std::uint64_t version() const noexcept { return _current.load( std::memory_order_acquire )->version; }
+
+    //! Publish \c map as the new version.
+    void store( MAP map )
+    {
+      const std::lock_guard lock{ _writer_mutex };
+      publish( std::move( map ) );
+    }
+
+    /*!
+      \brief Publish a modified copy of the current version.
+
+      \c update is called with a copy of the current map, to modify it before it is published.
+      Concurrent updates are serialized, so none of them is lost.
+    */
+    template< typename UPDATE > requires std::invocable< UPDATE &, MAP & >
+    void update( UPDATE &&update )
+    {
+      const std::lock_guard lock{ _writer_mutex };
+      MAP map{ _current.load( std::memory_order_relaxed )->map };
+      std::invoke( update, map );
+      publish( std::move( map ) );
+    }
+
+  private:
+    struct version_t
+    {
+      const MAP map;
+      std::uint64_t version;
+    };
+
+    //! Replace the current version. Must be called by the writer.
+    void publish( MAP map )
+    {
+      const auto *old{ _current.load( std::memory_order_relaxed ) };
+      auto added{ std::make_unique< const version_t >( std::move( map ), old->version + 1 ) };
+      auto &domain{ detail_n::epoch_domain::instance() };
+      // Allocate all that retiring and reclaiming need up front, so nothing throws once the new version is live.
+      // Attach first, so a failure leaves no unused reservation behind.
+      domain.attach();
+      domain.reserve_shared( 1 );
+      _current.store( added.release(), std::memory_order_release );
+
+      // Versions are large and published rarely -> reclaim right away, rather than waiting for a batch of retired objects.
+      // Writers may be different threads, so the next publication of any of them has to find the old version.
+      domain.retire_shared( old );
+      domain.reclaim();
+    }
+
+    std::atomic< const version_t * > _current;
+    std::mutex _writer_mutex;
+  };
+
+  /*!
+    \brief Select an entry from the current version of a \c snapshot_map .
+
+    A \c select_handle is returned instead of a plain pointer, which keeps the version alive while other threads publish new ones.
+    For multiple lookups in the same version, \c select from a snapshot, instead.
+  */
+  template< typename MAP, typename KEY > requires detail_n::MapLike< const MAP, KEY >
+  auto select( const snapshot_map< MAP > &map, KEY &&key )
+  {
+    using entry_t = std::remove_pointer_t< decltype( select( std::declval< const MAP & >(), std::forward< KEY >( key ) ) ) >;
+
+    auto snapshot{ map.load() };
+    if ( auto *entry{ select( *snapshot, std::forward< KEY >( key ) ) } )
+      // Key exists -> keep the version alive along with the handle.
+      return select_handle< entry_t, detail_n::epoch_guard >{ std::move( snapshot ).release(), entry };
+    else
+      // Key missing -> leave the critical section right away.
+      return select_handle< entry_t, detail_n::epoch_guard >{};
+  }
+}
@@ -0,0 +1,511 @@
+// Copyright David Lichti 2022.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "flat_map.h"
+#include "key_hash.h"
+#include "select_simd.h"
+#include "select_sorted.h"
+#include "select_util.h"
+
+namespace select_n
+{
+  namespace detail_n
+  {
+    /*!
+      \brief Control bytes of a group of slots of a \c swiss_map .
+
+      A full slot holds the low seven bits of its entry's hash, so the sign bit is clear.
+      Empty and deleted slots have the sign bit set.
+      All bytes of a group are compared at once, by SIMD instructions if available.
+    */
+    struct alignas( 16 ) control_group
+    {
+      static constexpr std::size_t size{ 16 };
+      static constexpr std::int8_t empty{ -128 };
+      static constexpr std::int8_t deleted{ -2 };
+
+      std::int8_t bytes[ size ];
+
+      //! Bit mask of the slots with control byte \c byte .
+      std::uint32_t match( const std::int8_t byte ) const noexcept
+      {
+#ifdef SELECT_N_SIMD_X86
+        const auto group{ _mm_load_si128( reinterpret_cast< const __m128i * >( bytes ) ) };
+        return static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( group, _mm_set1_epi8( byte ) ) ) );
+#else
+        std::uint32_t result{ 0 };
+        for ( std::size_t slot{ 0 }; slot < size; ++slot )
+          result |= std::uint32_t{ bytes[ slot ] == byte } << slot;
+        return result;
+#endif
+      }
+
+      //! Bit mask of the empty or deleted slots, i.e. the ones with the sign bit set.
+      std::uint32_t match_free() const noexcept
+      {
+#ifdef SELECT_N_SIMD_X86
+        return static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_load_si128( reinterpret_cast< const __m128i * >( bytes ) ) ) );
+#else
+        std::uint32_t result{ 0 };
+        for ( std::size_t slot{ 0 }; slot < size; ++slot )
+          result |= std::uint32_t{ bytes[ slot ] < 0 } << slot;
+        return result;
+#endif
+      }
+    };
+  }
+
+  /*!
+    \brief Open addressing hash map, probing groups of 16 slots at once, in the style of a Swiss table.
+
+    Each slot has a control byte holding seven bits of its entry's hash.
+    A lookup compares the control bytes of a whole group with a single SIMD comparison, and only compares keys whose hash bits match.
+    As keys, mapped values and control bytes are stored in separate flat arrays, a lookup touches few cache lines, and the map allocates only when it grows.
+
+    A key's hash can be computed once by \c hash_function() , and passed to \c find or \c select_hashed , to look it up in several maps without hashing it again.
+    The default \c key_hash hashes strings as \c std::string_view , so a \c std::string_view looks up \c std::string keys without allocating.
+    Lookups by other types than \c KEY convert the key, unless \c HASH is transparent.
+
+    Like \c flat_map , iterators dereference to proxies holding references to the key and mapped value.
+    Growing the map invalidates all iterators and references, erasing an entry only the ones to it.
+  */
+  template< typename KEY, typename T, typename HASH = key_hash< KEY >, typename EQUAL = std::equal_to<> >
+  class swiss_map
+  {
+  public:
+    using key_type = KEY;
+    using mapped_type = T;
+    using hasher = HASH;
+    using key_equal = EQUAL;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    using reference = detail_n::split_reference< KEY, T, false >;
+    using const_reference = detail_n::split_reference< KEY, T, true >;
+
+    //! Forward iterator over the full slots of a \c swiss_map .
+    template< bool CONST >
+    class basic_iterator
+    {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = detail_n::split_reference< KEY, T, CONST >;
+      using difference_type = std::ptrdiff_t;
+      using reference = detail_n::split_reference< KEY, T, CONST >;
+      using pointer = typename detail_n::split_iterator< KEY, T, CONST >::pointer;
+
+      basic_iterator() = default;
+      basic_iterator( detail_n::conditional_const_t< CONST, swiss_map > *map, const size_type slot ) noexcept : _map{ map }, _slot{ slot } {}
+
+      //! Allow conversion from mutable to const iterators.
+      operator basic_iterator< true >() const noexcept requires ( !CONST ) { return { _map, _slot }; }
+
+      reference operator*() const noexcept { return { _map->key_at( _slot ), _map->value_at( _slot ) }; }
+      pointer operator->() const noexcept { return { **this }; }
+
+      basic_iterator &operator++() noexcept { _slot = _map->next_full( _slot + 1 ); return *this; }
+      basic_iterator operator++( int ) noexcept { auto old{ *this }; ++*this; return old; }
+
+      friend bool operator==( const basic_iterator &a, const basic_iterator &b ) noexcept { return a._slot == b._slot; }
+
+    private:
+      detail_n::conditional_const_t< CONST, swiss_map > *_map{ nullptr };
+      size_type _slot{ 0 };
+    };
+
+    using iterator = basic_iterator< false >;
+    using const_iterator = basic_iterator< true >;
+
+    swiss_map() = default;
+
+    explicit swiss_map( HASH hash, EQUAL equal = {} ) : _hash{ std::move( hash ) }, _equal{ std::move( equal ) } {}
+
+    //! Build the map from \c entries . For duplicate keys, the first entry is kept.
+    swiss_map( std::initializer_list< std::pair< KEY, T > > entries, HASH hash = {}, EQUAL equal = {} ) : swiss_map( entries.begin(), entries.end(), std::move( hash ), std::move( equal ) ) {}
+
+    //! Build the map from the range \c [first, last) of key value pairs. For duplicate keys, the first entry is kept.
+    template< std::input_iterator ITERATOR >
+    swiss_map( ITERATOR first, ITERATOR last, HASH hash = {}, EQUAL equal = {} ) : swiss_map( std::move( hash ), std::move( equal ) )
+    {
+      if constexpr ( std::forward_iterator< ITERATOR > )
+        reserve( static_cast< size_type >( std::distance( first, last ) ) );
+      for ( ; first != last; ++first )
+        try_emplace( first->first, first->second );
+    }
+
+    //! Copy the slots of \c other as they are, so nothing is hashed.
+    swiss_map( const swiss_map &other ) : swiss_map( other._hash, other._equal )
+    {
+      if ( other._groups == 0 )
+        return;
+
+      allocate( other._groups );
+      for ( auto slot{ other.next_full( 0 ) }; slot < other.capacity(); slot = other.next_full( slot + 1 ) )
+      {
+        construct( slot, other.key_at( slot ), other.value_at( slot ) );
+        control_of( slot ) = other.control_of( slot );
+        ++_size;
+      }
+
+      // All entries constructed -> take over the deleted slots, too.
+      std::copy_n( other._control.get(), _groups, _control.get() );
+      _deleted = other._deleted;
+    }
+
+    swiss_map( swiss_map &&other ) noexcept : _hash{ other._hash }, _equal{ other._equal } { swap( other ); }
+
+    swiss_map &operator=( swiss_map other ) noexcept
+    {
+      swap( other );
+      return *this;
+    }
+
+    ~swiss_map() { destroy_entries(); }
+
+    void swap( swiss_map &other ) noexcept
+    {
+      using std::swap;
+      swap( _hash, other._hash );
+      swap( _equal, other._equal );
+      swap( _control, other._control );
+      swap( _keys, other._keys );
+      swap( _values, other._values );
+      swap( _groups, other._groups );
+      swap( _size, other._size );
+      swap( _deleted, other._deleted );
+    }
+
+    iterator begin() noexcept { return { this, next_full( 0 ) }; }
+    iterator end() noexcept { return { this, capacity() }; }
+    const_iterator begin() const noexcept { return { this, next_full( 0 ) }; }
+    const_iterator end() const noexcept { return { this, capacity() }; }
+
+    size_type size() const noexcept { return _size; }
+    bool empty() const noexcept { return _size == 0; }
+
+    //! Number of slots. At most seven eighths of them are used, so every probe sequence ends at an empty slot.
+    size_type capacity() const noexcept { return _groups * group_size; }
+
+    const HASH &hash_function() const noexcept { return _hash; }
+    const EQUAL &key_eq() const noexcept { return _equal; }
+
+    //! Hash of \c key , to be passed to \c find or \c select_hashed .
+    template< typename OTHER >
+    std::size_t hash( const OTHER &key ) const
+    {
+      if constexpr ( std::same_as< OTHER, KEY > || requires { typename HASH::is_transparent; } )
+        return static_cast< std::size_t >( _hash( key ) );
+      else
+        // Hash is not transparent -> convert to the key type.
+        return static_cast< std::size_t >( _hash( static_cast< KEY >( key ) ) );
+    }
+
+    //! Find an entry for \c key , or return the end iterator.
+    template< typename OTHER >
+    iterator find( const OTHER &key ) { return { this, find_slot( key, hash( key ) ) }; }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key ) const { return { this, find_slot( key, hash( key ) ) }; }
+
+    //! Find an entry for \c key , whose \c hash has been computed by \c hash_function() already.
+    template< typename OTHER >
+    iterator find( const OTHER &key, const std::size_t hash ) { return { this, find_slot( key, hash ) }; }
+    template< typename OTHER >
+    const_iterator find( const OTHER &key, const std::size_t hash ) const { return { this, find_slot( key, hash ) }; }
+
+    template< typename OTHER >
+    bool contains( const OTHER &key ) const { return find_slot( key, hash( key ) ) < capacity(); }
+
+    template< typename OTHER >
+    size_type count( const OTHER &key ) const { return contains( key ) ? 1 : 0; }
+
+    template< typename OTHER >
+    T &at( const OTHER &key )
+    {
+      if ( const auto slot{ find_slot( key, hash( key ) ) }; slot < capacity() )
+        return value_at( slot );
+      else
+        throw std::out_of_range{ "swiss_map::at" };
+    }
+
+    template< typename OTHER >
+    const T &at( const OTHER &key ) const
+    {
+      if ( const auto slot{ find_slot( key, hash( key ) ) }; slot < capacity() )
+        return value_at( slot );
+      else
+        throw std::out_of_range{ "swiss_map::at" };
+    }
+
+    //! Fetch the first group probed for \c key into the cache, e.g. a few lookups ahead of a batch.
+    template< typename OTHER >
+    void prefetch( const OTHER &key ) const { prefetch_hashed( hash( key ) ); }
+
+    //! Like \c prefetch , but by the hash of a key computed beforehand, which \c select_many then passes on to \c select_hashed .
+    void prefetch_hashed( const std::size_t hash ) const noexcept
+    {
+      if ( _groups != 0 )
+        detail_n::prefetch( &_control[ home_group( detail_n::mix( hash ) ) ] );
+    }
+
+    //! Insert an entry constructed from \c args for \c key , unless \c key already exists.
+    template< typename... ARGS >
+    std::pair< iterator, bool > try_emplace( const KEY &key, ARGS &&... args )
+    {
+      const auto raw{ hash( key ) };
+      if ( const auto slot{ find_slot( key, raw ) }; slot < capacity() )
+        return { { this, slot }, false };
+
+      if ( ( _size + _deleted + 1 ) * 8 > capacity() * 7 )
+        // Too few free slots -> grow, or just drop the deleted slots, if they take up much space.
+        rehash( _deleted > _size ? _groups : std::max< size_type >( 2 * _groups, 1 ) );
+
+      const auto mixed{ detail_n::mix( raw ) };
+      const auto slot{ free_slot( mixed ) };
+      construct( slot, key, std::forward< ARGS >( args )... );
+      if ( control_of( slot ) == detail_n::control_group::deleted )
+        --_deleted;
+      control_of( slot ) = tag( mixed );
+      ++_size;
+      return { { this, slot }, true };
+    }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > emplace( const KEY &key, VALUE &&value ) { return try_emplace( key, std::forward< VALUE >( value ) ); }
+
+    std::pair< iterator, bool > insert( std::pair< KEY, T > entry ) { return try_emplace( entry.first, std::move( entry.second ) ); }
+
+    template< typename VALUE >
+    std::pair< iterator, bool > insert_or_assign( const KEY &key, VALUE &&value )
+    {
+      if ( const auto slot{ find_slot( key, hash( key ) ) }; slot < capacity() )
+      {
+        value_at( slot ) = std::forward< VALUE >( value );
+        return { { this, slot }, false };
+      }
+      else
+        return try_emplace( key, std::forward< VALUE >( value ) );
+    }
+
+    T &operator[]( const KEY &key ) { return try_emplace( key ).first->second; }
+
+    //! Remove the entry for \c key , and return the number of removed entries.
+    template< typename OTHER >
+    size_type erase( const OTHER &key )
+    {
+      const auto slot{ find_slot( key, hash( key ) ) };
+      if ( slot == capacity() )
+        return 0;
+
+      std::destroy_at( &key_at( slot ) );
+      std::destroy_at( &value_at( slot ) );
+      --_size;
+      if ( _control[ slot / group_size ].match( detail_n::control_group::empty ) )
+        // Probes stop at this group anyway -> the slot can become empty again.
+        control_of( slot ) = detail_n::control_group::empty;
+      else
+      {
+        // Probes may have passed this group -> keep them going.
+        control_of( slot ) = detail_n::control_group::deleted;
+        ++_deleted;
+      }
+      return 1;
+    }
+
+    //! Remove all entries, but keep the capacity.
+    void clear() noexcept
+    {
+      destroy_entries();
+      if ( _control )
+        std::fill_n( &_control[ 0 ].bytes[ 0 ], capacity(), detail_n::control_group::empty );
+      _size = 0;
+      _deleted = 0;
+    }
+
+    //! Make room for \c count entries, so inserting them does not rehash.
+    void reserve( const size_type count )
+    {
+      if ( const auto groups{ groups_for( count ) }; groups > _groups )
+        rehash( groups );
+    }
+
+  private:
+    static constexpr size_type group_size{ detail_n::control_group::size };
+
+    using key_group_t = detail_n::uninitialized_array< KEY, group_size >;
+    using value_group_t = detail_n::uninitialized_array< T, group_size >;
+
+    //! Smallest power of two of groups, which holds \c count entries at a load factor of seven eighths.
+    static size_type groups_for( const size_type count ) noexcept { return count == 0 ? 0 : std::bit_ceil( ( count * 8 / 7 + group_size ) / group_size ); }
+
+    //! The high bits of the mixed hash select the first group, the low seven bits are stored in the control byte.
+    size_type home_group( const std::uint64_t mixed ) const noexcept { return static_cast< size_type >( mixed >> 7 ) & ( _groups - 1 ); }
+    static std::int8_t tag( const std::uint64_t mixed ) noexcept { return static_cast< std::int8_t >( mixed & 0x7f ); }
+
+    const KEY &key_at( const size_type slot ) const noexcept { return _keys[ slot / group_size ].items[ slot % group_size ]; }
+    KEY &key_at( const size_type slot ) noexcept { return _keys[ slot / group_size ].items[ slot % group_size ]; }
+    const T &value_at( const size_type slot ) const noexcept { return _values[ slot / group_size ].items[ slot % group_size ]; }
+    T &value_at( const size_type slot ) noexcept { return _values[ slot / group_size ].items[ slot % group_size ]; }
+    std::int8_t control_of( const size_type slot ) const noexcept { return _control[ slot / group_size ].bytes[ slot % group_size ]; }
+    std::int8_t &control_of( const size_type slot ) noexcept { return _control[ slot / group_size ].bytes[ slot % group_size ]; }
+
+    //! First full slot at or after \c slot , or the capacity if there is none.
+    size_type next_full( size_type slot ) const noexcept
+    {
+      while ( slot < capacity() && control_of( slot ) < 0 )
+        ++slot;
+      return slot;
+    }
+
+    /*!
+      \brief Slot of the entry for \c key , or the capacity if there is none.
+
+      Groups are probed in triangular steps, which visit all groups of a power of two count.
+      The search ends at the first group with an empty slot, as an insertion would have used it.
+    */
+    template< typename OTHER >
+    size_type find_slot( const OTHER &key, const std::size_t hash ) const
+    {
+      if ( _groups == 0 )
+        return 0;
+
+      const auto mixed{ detail_n::mix( hash ) };
+      const auto byte{ tag( mixed ) };
+      for ( size_type group{ home_group( mixed ) }, step{ 1 }; ; group = ( group + step++ ) & ( _groups - 1 ) )
+      {
+        const auto &control{ _control[ group ] };
+        for ( auto matches{ control.match( byte ) }; matches; matches &= matches - 1 )
+          if ( const auto slot{ group * group_size + static_cast< size_type >( std::countr_zero( matches ) ) }; _equal( key_at( slot ), key ) )
+            // Key exists -> return its slot.
+            return slot;
+
+        if ( control.match( detail_n::control_group::empty ) )
+          // Key missing -> end of the probe sequence.
+          return capacity();
+      }
+    }
+
+    //! First empty or deleted slot in the probe sequence of \c mixed . There has to be one.
+    size_type free_slot( const std::uint64_t mixed ) const noexcept
+    {
+      for ( size_type group{ home_group( mixed ) }, step{ 1 }; ; group = ( group + step++ ) & ( _groups - 1 ) )
+        if ( const auto free{ _control[ group ].match_free() } )
+          return group * group_size + static_cast< size_type >( std::countr_zero( free ) );
+    }
+
+    template< typename OTHER, typename... ARGS >
+    void construct( const size_type slot, OTHER &&key, ARGS &&... args )
+    {
+      std::construct_at( &key_at( slot ), std::forward< OTHER >( key ) );
+      try
+      {
+        std::construct_at( &value_at( slot ), std::forward< ARGS >( args )... );
+      }
+      catch ( ... )
+      {
+        std::destroy_at( &key_at( slot ) );
+        throw;
+      }
+    }
+
+    void allocate( const size_type groups )
+    {
+      _control = std::make_unique< detail_n::control_group[] >( groups );
+      _keys = std::make_unique< key_group_t[] >( groups );
+      _values = std::make_unique< value_group_t[] >( groups );
+      _groups = groups;
+      std::fill_n( &_control[ 0 ].bytes[ 0 ], capacity(), detail_n::control_group::empty );
+    }
+
+    //! Entries are moved to a new table only if neither key nor value can throw on it. Otherwise, both are copied, unless one of them cannot be copied.
+    static constexpr bool nothrow_relocatable{ std::is_nothrow_move_constructible_v< KEY > && std::is_nothrow_move_constructible_v< T > };
+    static constexpr bool relocate_by_copy{ !nothrow_relocatable && std::is_copy_constructible_v< KEY > && std::is_copy_constructible_v< T > };
+
+    /*!
+      \brief Move all entries to a table of \c groups groups.
+
+      Leaves the map unchanged if this throws, unless a key or value can neither be copied nor moved without throwing.
+      When moving, all entries are hashed before the first one is moved, so a throwing hash function leaves none of them moved-from.
+    */
+    void rehash( const size_type groups )
+    {
+      swiss_map rehashed{ _hash, _equal };
+      rehashed.allocate( groups );
+
+      if constexpr ( nothrow_relocatable )
+      {
+        const auto targets{ std::make_unique_for_overwrite< size_type[] >( _size ) };
+        try
+        {
+          size_type index{ 0 };
+          for ( auto slot{ next_full( 0 ) }; slot < capacity(); slot = next_full( slot + 1 ) )
+          {
+            const auto mixed{ detail_n::mix( hash( key_at( slot ) ) ) };
+            const auto target{ rehashed.free_slot( mixed ) };
+            // Claim the slot, so the following entries go elsewhere.
+            rehashed.control_of( target ) = tag( mixed );
+            targets[ index++ ] = target;
+          }
+        }
+        catch ( ... )
+        {
+          // No entry has been moved into the claimed slots.
+          std::fill_n( &rehashed._control[ 0 ].bytes[ 0 ], rehashed.capacity(), detail_n::control_group::empty );
+          throw;
+        }
+
+        size_type index{ 0 };
+        for ( auto slot{ next_full( 0 ) }; slot < capacity(); slot = next_full( slot + 1 ) )
+          rehashed.construct( targets[ index++ ], std::move( key_at( slot ) ), std::move( value_at( slot ) ) );
+        rehashed._size = _size;
+      }
+      else
+        for ( auto slot{ next_full( 0 ) }; slot < capacity(); slot = next_full( slot + 1 ) )
+        {
+          const auto mixed{ detail_n::mix( hash( key_at( slot ) ) ) };
+          const auto target{ rehashed.free_slot( mixed ) };
+          if constexpr ( relocate_by_copy )
+            rehashed.construct( target, std::as_const( key_at( slot ) ), std::as_const( value_at( slot ) ) );
+          else
+            rehashed.construct( target, std::move( key_at( slot ) ), std::move( value_at( slot ) ) );
+          rehashed.control_of( target ) = tag( mixed );
+          ++rehashed._size;
+        }
+
+      swap( rehashed );
+    }
+
+    void destroy_entries() noexcept
+    {
+      for ( auto slot{ next_full( 0 ) }; slot < capacity(); slot = next_full( slot + 1 ) )
+      {
+        std::destroy_at( &key_at( slot ) );
+        std::destroy_at( &value_at( slot ) );
+      }
+    }
+
+    HASH _hash;
+    EQUAL _equal;
+    std::unique_ptr< detail_n::control_group[] > _control;
+    std::unique_ptr< key_group_t[] > _keys;
+    std::unique_ptr< value_group_t[] > _values;
+    size_type _groups{ 0 };
+    size_type _size{ 0 };
+    size_type _deleted{ 0 };
+  };
+}
@@ -0,0 +1,140 @@
+#include <cassert>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cached_map.h"
+#include "select.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using map_t = cached_map< std::unordered_map< int, std::string > >;
+
+  map_t make_test_map( const int count )
+  {
+    map_t map;
+    for ( int i{ 0 }; i < count; ++i )
+      map.try_emplace( i, std::to_string( i ) );
+    return map;
+  }
+
+  void testRepeatedLookupsHit()
+  {
+    const auto map{ make_test_map( 10 ) };
+
+    assert( *select( map, 3 ) == "3" );
+    assert( ( map.stats().hits == 0 && map.stats().misses == 1 ) );
+    for ( int i{ 0 }; i < 9; ++i )
+      assert( select( map, 3 ) == &map.map().find( 3 )->second );
+    assert( ( map.stats().hits == 9 && map.stats().misses == 1 ) );
+    assert( map.stats().hit_rate() == 0.9 );
+
+    // Missing keys are never cached.
+    assert( select( map, 10 ) == nullptr );
+    assert( select( map, 10 ) == nullptr );
+    assert( map.stats().misses == 3 );
+  }
+
+  void testMutationsInvalidate()
+  {
+    auto map{ make_test_map( 4 ) };
+    assert( *select( map, 1 ) == "1" );
+
+    map.erase( 1 );
+    assert( select( map, 1 ) == nullptr );
+
+    map.insert_or_assign( 1, "one" );
+    assert( *select( map, 1 ) == "one" );
+    assert( *select( map, 1 ) == "one" );
+
+    // Growing the map rehashes it, which moves no entry, but invalidates all iterators.
+    for ( int i{ 4 }; i < 1000; ++i )
+      map[ i ] = std::to_string( i );
+    for ( int i{ 0 }; i < 1000; ++i )
+      assert( select( map, i ) == &map.map().find( i )->second );
+
+    map.reset_stats();
+    map.clear();
+    assert( select( map, 1 ) == nullptr );
+    assert( map.stats().hits == 0 );
+  }
+
+  void testMapsDoNotShareEntries()
+  {
+    const map_t first{ { 1, "first" } };
+    const map_t second{ { 1, "second" } };
+    auto copy{ first };
+
+    for ( int i{ 0 }; i < 3; ++i )
+    {
+      assert( *select( first, 1 ) == "first" );
+      assert( *select( second, 1 ) == "second" );
+      assert( select( copy, 1 ) == &copy.map().find( 1 )->second );
+    }
+
+    copy = second;
+    assert( *select( copy, 1 ) == "second" );
+  }
+
+  void testStringViewDoesNotAllocate()
+  {
+    const cached_map< std::map< std::string, int, std::less<> > > map{ { std::string{ test_n::long_key }, 1 }, { "b", 2 } };
+    const std::string_view key{ test_n::long_key };
+    const test_n::AllocationCounter counter;
+
+    assert( *select( map, key ) == 1 );
+    assert( *select( map, key ) == 1 );
+    assert( select( map, key.substr( 1 ) ) == nullptr );
+    assert( counter.allocations() == 0 );
+    assert( map.stats().hits == 1 );
+  }
+
+  void testSelectOrDefault()
+  {
+    auto map{ make_test_map( 5 ) };
+    const std::string def{ "default" };
+
+    auto &existing{ select_or_default( map, 2, def ) };
+    auto &cached{ select_or_default( map, 2, def ) };
+    auto &missing{ select_or_default( map, 20, def ) };
+
+    assert( &existing == &map.map().find( 2 )->second );
+    assert( &cached == &existing );
+    assert( &missing == &def );
+    assert( map.stats().hits == 1 );
+  }
+
+  void testThreadsHaveOwnCaches()
+  {
+    const auto map{ make_test_map( 100 ) };
+    std::vector< std::thread > threads;
+    for ( int t{ 0 }; t < 4; ++t )
+      threads.emplace_back( [ &map, t ]()
+      {
+        for ( int round{ 0 }; round < 100; ++round )
+          assert( *select( map, t ) == std::to_string( t ) );
+      } );
+    for ( auto &thread : threads )
+      thread.join();
+
+    // The first lookup of each thread misses.
+    assert( ( map.stats().hits == 396 && map.stats().misses == 4 ) );
+  }
+}
+
+int main()
+{
+  testRepeatedLookupsHit();
+  testMutationsInvalidate();
+  testMapsDoNotShareEntries();
+  testStringViewDoesNotAllocate();
+  testSelectOrDefault();
+  testThreadsHaveOwnCaches();
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "column_table.h"
+#include "select_all.h"
+#include "select_expression.h"
+#include "select_if.h"
+
+using namespace select_n;
+
+namespace
+{
+  struct record
+  {
+    int price;
+    int quantity;
+    double weight;
+    std::string name;
+  };
+
+  using table_t = column_table< &record::price, &record::quantity, &record::weight, &record::name >;
+
+  std::vector< record > make_test_records( const int count )
+  {
+    std::vector< record > records;
+    for ( int i{ 0 }; i < count; ++i )
+      records.push_back( { ( i * 37 ) % 101, i % 7, i * 0.5, std::to_string( i ) } );
+    return records;
+  }
+
+  //! Indices of all rows of \c records matching \c predicate , as found by the plain record predicate.
+  template< typename PREDICATE >
+  std::vector< std::size_t > find_all( const std::vector< record > &records, const PREDICATE &predicate )
+  {
+    std::vector< std::size_t > indices;
+    for ( std::size_t index{ 0 }; index < records.size(); ++index )
+      if ( predicate( records[ index ] ) )
+        indices.push_back( index );
+    return indices;
+  }
+
+  template< typename EXPRESSION >
+  void checkScan( const table_t &table, const std::vector< record > &records, const EXPRESSION &expression )
+  {
+    const auto expected{ find_all( records, expression ) };
+
+    const auto first{ select_if( table, expression ) };
+    assert( first.has_value() == !expected.empty() );
+    if ( first )
+      assert( first->index() == expected.front() );
+
+    std::vector< std::size_t > indices;
+    for ( const auto row : select_all( table, expression ) )
+      indices.push_back( row.index() );
+    assert( indices == expected );
+  }
+
+  void testExpressionsOnRecords()
+  {
+    const auto records{ make_test_records( 100 ) };
+    const auto cheap_and_out{ field( &record::price ) < 10 && field( &record::quantity ) == 0 };
+
+    auto found{ select_if( records, cheap_and_out ) };
+
+    assert( found == &*std::find_if( records.begin(), records.end(), []( const record &r ){ return r.price < 10 && r.quantity == 0; } ) );
+    assert( ( !( field( &record::name ) == std::string{ "3" } ) )( records[ 4 ] ) );
+  }
+
+  void testColumnarScans()
+  {
+    for ( const int count : { 0, 1, 63, 64, 65, 1000 } )
+    {
+      const auto records{ make_test_records( count ) };
+      const table_t table( records.begin(), records.end() );
+      assert( table.size() == records.size() );
+
+      checkScan( table, records, field( &record::price ) < 10 && field( &record::quantity ) == 0 );
+      checkScan( table, records, field( &record::price ) >= 100 || field( &record::weight ) <= 1.0 );
+      checkScan( table, records, !( field( &record::quantity ) != 3 ) );
+      checkScan( table, records, field( &record::price ) > 1000 );
+      checkScan( table, records, field( &record::quantity ) < 100 );
+      checkScan( table, records, field( &record::name ) == std::string{ "64" } );
+    }
+  }
+
+  void testSelectAllStopsEarly()
+  {
+    const auto records{ make_test_records( 1000 ) };
+    const table_t table( records.begin(), records.end() );
+
+    std::vector< int > prices;
+    for ( const auto row : select_all( table, field( &record::quantity ) == 2 ) | std::views::take( 3 ) )
+      prices.push_back( row.get< &record::price >() );
+
+    assert( ( prices == std::vector{ records[ 2 ].price, records[ 9 ].price, records[ 16 ].price } ) );
+  }
+
+  void testOpaquePredicates()
+  {
+    const auto records{ make_test_records( 200 ) };
+    const table_t table( records.begin(), records.end() );
+    const auto heavy{ []( const record &r ){ return r.weight > 50.0 && r.name.size() == 3; } };
+
+    const auto first{ select_if( table, heavy ) };
+    assert( first && first->index() == find_all( records, heavy ).front() );
+    assert( std::ranges::distance( select_all( table, heavy ) ) == static_cast< std::ptrdiff_t >( find_all( records, heavy ).size() ) );
+    assert( !select_if( table, []( const table_t::const_row &row ){ return row.get< &record::price >() < 0; } ) );
+  }
+
+  void testMutableRows()
+  {
+    table_t table{ { 1, 0, 0.0, "a" }, { 2, 0, 0.0, "b" }, { 3, 1, 0.0, "c" } };
+
+    for ( auto row : select_all( table, field( &record::quantity ) == 0 ) )
+      row.get< &record::price >() *= 10;
+
+    auto found{ select_if( table, field( &record::price ) == 20 ) };
+    assert( found );
+    found->get< &record::name >() = "z";
+
+    const record second{ table[ 1 ] };
+    assert( second.price == 20 );
+    assert( second.name == "z" );
+    assert( table.column< &record::price >()[ 2 ] == 3 );
+  }
+
+  void testFieldOutsideTable()
+  {
+    column_table< &record::price > table{ { 1, 2, 3.0, "x" } };
+
+    assert( table[ 0 ].price == 1 );
+    assert( table[ 0 ].quantity == 0 );
+
+    bool thrown{ false };
+    try
+    {
+      select_if( table, field( &record::quantity ) == 2 );
+    }
+    catch ( const std::invalid_argument & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+  }
+}
+
+int main()
+{
+  testExpressionsOnRecords();
+  testColumnarScans();
+  testSelectAllStopsEarly();
+  testOpaquePredicates();
+  testMutableRows();
+  testFieldOutsideTable();
+}
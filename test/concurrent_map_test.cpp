@@ -0,0 +1,234 @@
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent_map.h"
+#include "select.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  //! Counts its destructions, to observe when entries are reclaimed.
+  struct Counted
+  {
+    static inline std::atomic< std::size_t > destructions{ 0 };
+
+    explicit Counted( const int value ) noexcept : value{ value } {}
+    Counted( const Counted & ) = default;
+    ~Counted() { ++destructions; }
+
+    int value;
+  };
+
+  void reclaim()
+  {
+    for ( int round{ 0 }; round < 4; ++round )
+      detail_n::epoch_domain::instance().reclaim();
+  }
+
+  void testSelectFromConcurrentMap()
+  {
+    concurrent_map< int, std::string > map;
+    assert( map.try_emplace( 1, "one" ) );
+    assert( !map.try_emplace( 1, "other" ) );
+    assert( map.insert_or_assign( 2, "two" ) );
+
+    auto existing{ select( map, 1 ) };
+    auto missing{ select( map, 3 ) };
+
+    assert( ( std::is_same_v< decltype( existing ), select_handle< const std::string, detail_n::epoch_guard > > ) );
+    assert( existing && *existing == "one" );
+    assert( existing->size() == 3 );
+    assert( !missing );
+    assert( map.size() == 2 );
+  }
+
+  void testSelectOrDefaultFromConcurrentMap()
+  {
+    concurrent_map< int, std::string > map;
+    map.insert_or_assign( 1, "one" );
+    const std::string def{ "default" };
+
+    assert( ( !std::is_reference_v< decltype( select_or_default( map, 1, def ) ) > ) );
+    assert( select_or_default( map, 1, def ) == "one" );
+    assert( select_or_default( map, 2, def ) == "default" );
+    assert( select_or_default( map, 2 ).empty() );
+  }
+
+  void testGrowAndErase()
+  {
+    concurrent_map< int, int, std::hash< int >, std::equal_to< int >, 4 > map;
+    for ( int key{ 0 }; key < 1000; ++key )
+      map.insert_or_assign( key, 2 * key );
+    for ( int key{ 0 }; key < 1000; key += 2 )
+      assert( map.erase( key ) == 1 );
+
+    assert( map.size() == 500 );
+    for ( int key{ 0 }; key < 1000; ++key )
+      assert( select_or_default( map, key, -1 ) == ( key % 2 ? 2 * key : -1 ) );
+
+    map.clear();
+    assert( map.empty() );
+    assert( !select( map, 1 ) );
+  }
+
+  /*!
+    \brief Run \c operation on a new thread, letting its allocation after \c failing others throw \c std::bad_alloc .
+
+    A new thread has no room for retired objects yet, so retiring allocates, too.
+    Returns whether \c operation completed.
+  */
+  template< typename OPERATION >
+  bool completesFailingAllocation( const std::size_t failing, const OPERATION &operation )
+  {
+    bool completed{ false };
+    std::thread{ [ & ] {
+      test_n::AllocationCounter counter;
+      counter.fail_after( failing );
+      try
+      {
+        operation();
+        completed = true;
+      }
+      catch ( const std::bad_alloc & ) {}
+    } }.join();
+    return completed;
+  }
+
+  void testFailedAllocationKeepsEntry()
+  {
+    concurrent_map< int, int > map;
+    map.insert_or_assign( 1, 10 );
+
+    // Fail each allocation in turn, until none is left to fail.
+    std::size_t failing{ 0 };
+    for ( ; !completesFailingAllocation( failing, [ &map ] { map.insert_or_assign( 1, 20 ); } ); ++failing )
+    {
+      assert( map.size() == 1 );
+      assert( select_or_default( map, 1, -1 ) == 10 );
+    }
+    // Replacing the entry allocates a new one.
+    assert( failing > 0 );
+    assert( select_or_default( map, 1, -1 ) == 20 );
+
+    std::size_t erased{ 0 };
+    for ( failing = 0; !completesFailingAllocation( failing, [ &map, &erased ] { erased = map.erase( 1 ); } ); ++failing )
+    {
+      assert( map.size() == 1 );
+      assert( select_or_default( map, 1, -1 ) == 20 );
+    }
+    assert( erased == 1 );
+    assert( map.empty() );
+  }
+
+  void testThreadExitDoesNotAllocate()
+  {
+    concurrent_map< int, int > map;
+    for ( int key{ 0 }; key < 100; ++key )
+      map.insert_or_assign( key, key );
+
+    {
+      // Keep the replaced entries from being reclaimed, so the thread still has them at its exit.
+      const auto handle{ select( map, 0 ) };
+      test_n::AllocationCounter counter;
+      std::thread{ [ &map, &counter ] {
+        for ( int key{ 0 }; key < 100; ++key )
+          map.insert_or_assign( key, -key );
+        // Handing the retired entries over at the exit of the thread must not allocate.
+        counter.fail_after( 0 );
+      } }.join();
+      assert( *handle == 0 );
+    }
+
+    reclaim();
+    for ( int key{ 0 }; key < 100; ++key )
+      assert( select_or_default( map, key, 1 ) == -key );
+  }
+
+  void testHandleKeepsEntryAlive()
+  {
+    reclaim();
+    concurrent_map< int, Counted > map;
+    map.try_emplace( 1, 10 );
+    const auto destructions{ Counted::destructions.load() };
+
+    auto handle{ select( map, 1 ) };
+    map.insert_or_assign( 1, Counted{ 20 } );
+    const auto replaced{ Counted::destructions.load() };
+    reclaim();
+
+    // The temporary is gone, but the replaced entry is still in use.
+    assert( replaced == destructions + 1 );
+    assert( Counted::destructions == replaced );
+    assert( handle->value == 10 );
+    assert( select( map, 1 )->value == 20 );
+
+    handle = {};
+    reclaim();
+    assert( Counted::destructions == replaced + 1 );
+  }
+
+  void testConcurrentReadersAndWriters()
+  {
+    constexpr int keys{ 1000 };
+    concurrent_map< int, std::string > map;
+    for ( int key{ 0 }; key < keys; ++key )
+      map.insert_or_assign( key, std::to_string( key ) );
+
+    std::atomic< bool > stop{ false };
+    std::atomic< std::size_t > hits{ 0 };
+    {
+      std::vector< std::jthread > threads;
+      for ( int reader{ 0 }; reader < 4; ++reader )
+        threads.emplace_back( [ & ]
+        {
+          std::size_t found{ 0 };
+          while ( !stop.load( std::memory_order_relaxed ) )
+            for ( int key{ 0 }; key < keys; ++key )
+              if ( const auto entry{ select( map, key ) } )
+              {
+                // Entries are replaced and erased concurrently, but never torn.
+                assert( *entry == std::to_string( key ) || *entry == std::to_string( -key ) );
+                ++found;
+              }
+          hits += found;
+        } );
+
+      std::vector< std::jthread > writers;
+      for ( int writer{ 0 }; writer < 2; ++writer )
+        writers.emplace_back( [ &map, writer ]
+        {
+          for ( int round{ 0 }; round < 20; ++round )
+            for ( int key{ writer }; key < keys; key += 2 )
+            {
+              if ( round % 3 == 2 )
+                map.erase( key );
+              else
+                map.insert_or_assign( key, std::to_string( round % 2 ? -key : key ) );
+            }
+        } );
+
+      writers.clear();
+      stop = true;
+    }
+
+    assert( hits > 0 );
+  }
+}
+
+int main()
+{
+  testSelectFromConcurrentMap();
+  testSelectOrDefaultFromConcurrentMap();
+  testGrowAndErase();
+  testFailedAllocationKeepsEntry();
+  testThreadExitDoesNotAllocate();
+  testHandleKeepsEntryAlive();
+  testConcurrentReadersAndWriters();
+}
@@ -0,0 +1,137 @@
+#include <cassert>
+#include <string>
+
+#include "enum_map.h"
+#include "select.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using test_n::Tracer;
+  using entry_t = test_n::test_map_entry;
+  using test_enum_map_t = enum_map< entry_t, Tracer, 2 >;
+
+  enum class color
+  {
+    RED,
+    GREEN,
+    BLUE,
+    COUNT,
+  };
+
+  test_enum_map_t make_test_enum_map()
+  {
+    Tracer::Silencer silencer;
+    return { { entry_t::EXISTING, {} } };
+  }
+
+  void testSelectFromConstantEnumMap()
+  {
+    const auto map{ make_test_enum_map() };
+    Tracer::clear_log();
+
+    auto existing{ select( map, entry_t::EXISTING ) };
+    auto missing{ select( map, entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer * > ) );
+    assert( existing == &map.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultFromMutableEnumMap()
+  {
+    auto map{ make_test_enum_map() };
+    const auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default( map, entry_t::EXISTING, def ) };
+    auto &missing{ select_or_default( map, entry_t::MISSING, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testInsertAndErase()
+  {
+    enum_map< color, std::string > map{ { color::BLUE, "blue" }, { color::RED, "red" } };
+
+    assert( sizeof( map ) < 4 * sizeof( std::string ) + 2 * sizeof( std::size_t ) );
+    assert( map.size() == 2 );
+    assert( map.begin()->first == color::RED );
+    assert( std::next( map.begin() )->first == color::BLUE );
+
+    assert( !map.try_emplace( color::RED, "other" ).second );
+    map[ color::GREEN ] = "green";
+    assert( *select( map, color::GREEN ) == "green" );
+    assert( map.size() == 3 );
+
+    assert( map.erase( color::RED ) == 1 );
+    assert( map.erase( color::RED ) == 0 );
+    assert( select( map, color::RED ) == nullptr );
+    assert( map.size() == 2 );
+
+    bool thrown{ false };
+    try
+    {
+      map[ color::COUNT ];
+    }
+    catch ( const std::out_of_range & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+  }
+
+  void testCopyAndMove()
+  {
+    const auto map{ make_test_enum_map() };
+
+    auto copy{ map };
+    assert( copy.size() == 1 );
+    assert( copy.at( entry_t::EXISTING ) == map.at( entry_t::EXISTING ) );
+
+    const auto moved{ std::move( copy ) };
+    assert( copy.empty() );
+    assert( moved.at( entry_t::EXISTING ) == map.at( entry_t::EXISTING ) );
+  }
+
+  void testSelectFromIntMap()
+  {
+    int_map< std::string, -2, 100 > map{ { -2, "first" }, { 70, "middle" }, { 100, "last" } };
+
+    assert( *select( map, -2 ) == "first" );
+    assert( *select( map, 70 ) == "middle" );
+    assert( *select( map, 100 ) == "last" );
+    assert( select( map, 0 ) == nullptr );
+    assert( select( map, -3 ) == nullptr );
+    assert( select( map, 101 ) == nullptr );
+    assert( select_or_default( map, 1000 ).empty() );
+
+    std::size_t count{ 0 };
+    for ( const auto &[ key, value ] : map )
+      count += !value.empty() && key >= -2;
+    assert( count == 3 );
+  }
+
+  constexpr int selectAtCompileTime()
+  {
+    enum_map< color, int > map{ { color::GREEN, 1 } };
+    return *select( map, color::GREEN ) + ( select( map, color::RED ) == nullptr );
+  }
+  static_assert( selectAtCompileTime() == 2 );
+}
+
+int main()
+{
+  testSelectFromConstantEnumMap();
+  testSelectOrDefaultFromMutableEnumMap();
+  testInsertAndErase();
+  testCopyAndMove();
+  testSelectFromIntMap();
+}
@@ -0,0 +1,231 @@
+#include <cassert>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "filtered_map.h"
+#include "select.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using test_n::Tracer;
+  using entry_t = test_n::test_map_entry;
+
+  void testSelectFromFilteredMap()
+  {
+    const filtered_map< test_n::testMap_t > map{ test_n::make_test_map() };
+    const auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default( map, entry_t::EXISTING, def ) };
+    auto &missing{ select_or_default( map, entry_t::MISSING, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer & > ) );
+    assert( &existing == &map.map().at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+    assert( map.stats().filtered + map.stats().false_positives == 1 );
+  }
+
+  void testSelectByStringView()
+  {
+    filtered_map< std::map< std::string, int, std::less<> > > map{ { "one", 1 }, { "two", 2 } };
+
+    assert( *select( map, std::string_view{ "one" } ) == 1 );
+    assert( *select( map, std::string{ "two" } ) == 2 );
+    assert( select( map, "three" ) == nullptr );
+
+    map[ "three" ] = 3;
+    assert( *select( map, "three" ) == 3 );
+  }
+
+  void testSelectFromFilteredUnorderedMap()
+  {
+    const filtered_map< std::unordered_map< std::string, int > > map{ { "one", 1 } };
+
+    assert( *select( map, std::string{ "one" } ) == 1 );
+    assert( select_or_default( map, std::string{ "two" }, 2 ) == 2 );
+  }
+
+  void testFalsePositiveRate()
+  {
+    filtered_map< std::map< int, int > > map;
+    for ( int key{ 0 }; key < 10'000; ++key )
+      map.try_emplace( 2 * key, key );
+
+    for ( int key{ 0 }; key < 10'000; ++key )
+    {
+      assert( *select( map, 2 * key ) == key );
+      assert( select( map, 2 * key + 1 ) == nullptr );
+    }
+
+    const auto stats{ map.stats() };
+    assert( stats.filtered + stats.false_positives == 10'000 );
+    assert( stats.false_positive_rate() < 0.05 );
+
+    map.reset_stats();
+    assert( map.stats().filtered == 0 );
+  }
+
+  //! Hash of \c int , which fails once after a number of further calls.
+  struct failing_hash
+  {
+    static inline int calls_left{ -1 };
+
+    std::size_t operator()( const int key ) const
+    {
+      if ( calls_left >= 0 && calls_left-- == 0 )
+        throw std::runtime_error{ "hash failed" };
+      return std::hash< int >{}( key );
+    }
+  };
+
+  void testFailedResizeKeepsKeysFiltered()
+  {
+    filtered_map< std::map< int, int >, failing_hash > map;
+
+    // Without a filter to fall back on, the insertion is undone.
+    failing_hash::calls_left = 1;
+    bool thrown{ false };
+    try
+    {
+      map.try_emplace( 0, 0 );
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+    assert( map.empty() );
+
+    failing_hash::calls_left = -1;
+    map.try_emplace( 0, 0 );
+    for ( int key{ 1 }; key < 1000; ++key )
+    {
+      // Fail any resize after hashing the new key -> the key goes into the old filter.
+      failing_hash::calls_left = 1;
+      assert( map.try_emplace( key, key ).second );
+    }
+    failing_hash::calls_left = -1;
+
+    for ( int key{ 0 }; key < 1000; ++key )
+      assert( *select( map, key ) == key );
+    assert( select( map, 1000 ) == nullptr );
+  }
+
+  void testFailedAllocationKeepsKeysFiltered()
+  {
+    filtered_map< std::map< int, int > > map;
+    int key{ 0 };
+    for ( ; map.size() < 64; ++key )
+      map.try_emplace( key, key );
+
+    // Fail each allocation of an insertion, which grows the filter, in turn, until none is left to fail.
+    for ( std::size_t failing{ 0 }; ; ++failing )
+    {
+      bool inserted{ false };
+      {
+        test_n::AllocationCounter counter;
+        counter.fail_after( failing );
+        try
+        {
+          inserted = map.try_emplace( key, key ).second;
+        }
+        catch ( const std::bad_alloc & ) {}
+      }
+
+      // Each key is either missing, or can be found through the filter.
+      for ( int other{ 0 }; other < key; ++other )
+        assert( *select( map, other ) == other );
+      if ( map.size() > static_cast< std::size_t >( key ) )
+        assert( *select( map, key ) == key );
+      else
+        assert( select( map, key ) == nullptr );
+      if ( inserted )
+        break;
+    }
+    assert( *select( map, key ) == key );
+  }
+
+  void testEraseAndRebuild()
+  {
+    filtered_map< std::map< int, int > > map;
+    for ( int key{ 0 }; key < 1000; ++key )
+      map.insert_or_assign( key, key );
+    for ( int key{ 0 }; key < 1000; key += 2 )
+      assert( map.erase( key ) == 1 );
+
+    for ( int key{ 0 }; key < 1000; ++key )
+      assert( select_or_default( map, key, -1 ) == ( key % 2 ? key : -1 ) );
+
+    map.rebuild();
+    map.clear();
+    assert( map.empty() );
+    assert( select( map, 1 ) == nullptr );
+  }
+
+  void testReuseAfterMove()
+  {
+    filtered_map< std::map< int, int > > map{ { 1, 1 }, { 2, 2 } };
+    const auto moved{ std::move( map ) };
+    assert( *select( moved, 2 ) == 2 );
+
+    map.clear();
+    assert( map.try_emplace( 3, 3 ).second );
+    assert( *select( map, 3 ) == 3 );
+    assert( select( map, 1 ) == nullptr );
+
+    filtered_map< std::map< int, int > > assigned;
+    assigned = std::move( map );
+    map.clear();
+    for ( int key{ 0 }; key < 100; ++key )
+      map.try_emplace( key, key );
+    for ( int key{ 0 }; key < 100; ++key )
+      assert( *select( map, key ) == key );
+    assert( *select( assigned, 3 ) == 3 );
+  }
+
+  void testFailedRebuildKeepsErasure()
+  {
+    filtered_map< std::map< int, int > > map;
+    for ( int key{ 0 }; key < 1000; ++key )
+      map.insert_or_assign( key, key );
+
+    // Enough erasures to trigger rebuilds, each of which fails to allocate its filter.
+    for ( int key{ 0 }; key < 600; ++key )
+    {
+      test_n::AllocationCounter counter;
+      counter.fail_after( 0 );
+      assert( map.erase( key ) == 1 );
+    }
+
+    assert( map.size() == 400 );
+    for ( int key{ 0 }; key < 1000; ++key )
+      assert( select_or_default( map, key, -1 ) == ( key < 600 ? -1 : key ) );
+
+    // With allocations working again, the next erasure rebuilds the filter.
+    assert( map.erase( 600 ) == 1 );
+    assert( select( map, 600 ) == nullptr );
+    assert( *select( map, 601 ) == 601 );
+  }
+}
+
+int main()
+{
+  testSelectFromFilteredMap();
+  testSelectByStringView();
+  testSelectFromFilteredUnorderedMap();
+  testFalsePositiveRate();
+  testFailedResizeKeepsKeysFiltered();
+  testFailedAllocationKeepsKeysFiltered();
+  testEraseAndRebuild();
+  testReuseAfterMove();
+  testFailedRebuildKeepsErasure();
+}
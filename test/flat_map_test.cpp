@@ -0,0 +1,134 @@
+#include <cassert>
+#include <string>
+
+#include "flat_map.h"
+#include "select.h"
+#include "select_if.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using test_n::Tracer;
+  using entry_t = test_n::test_map_entry;
+
+  flat_map< entry_t, Tracer > make_test_flat_map()
+  {
+    Tracer::Silencer silencer;
+    return flat_map< entry_t, Tracer >{ { { entry_t::EXISTING, {} } } };
+  }
+
+  void testBuildFromUnsortedEntries()
+  {
+    const flat_map< int, std::string > map{ { 3, "c" }, { 1, "a" }, { 2, "b" }, { 1, "duplicate" } };
+
+    assert( map.size() == 3 );
+    assert( ( std::vector< int >( map.keys().begin(), map.keys().end() ) == std::vector{ 1, 2, 3 } ) );
+    assert( map.at( 1 ) == "a" );
+    assert( map.at( 2 ) == "b" );
+    assert( map.at( 3 ) == "c" );
+  }
+
+  void testSelectFromConstantFlatMap()
+  {
+    const auto map{ make_test_flat_map() };
+    Tracer::clear_log();
+
+    auto existing{ select( map, entry_t::EXISTING ) };
+    auto missing{ select( map, entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer * > ) );
+    assert( existing == &map.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectFromMutableFlatMap()
+  {
+    auto map{ make_test_flat_map() };
+    Tracer::clear_log();
+
+    auto existing{ select( map, entry_t::EXISTING ) };
+    auto missing{ select( map, entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer * > ) );
+    assert( existing == &map.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultFromFlatMap()
+  {
+    auto map{ make_test_flat_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default( map, entry_t::EXISTING, def ) };
+    auto &missing{ select_or_default( map, entry_t::MISSING, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectIfFromFlatMapValues()
+  {
+    flat_map< int, std::string > map{ { 3, "c" }, { 1, "a" }, { 2, "b" } };
+
+    auto values{ map.values() };
+    auto existing{ select_if( values, []( const std::string &value ){ return value == "b"; } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), std::string * > ) );
+    assert( existing == &map.at( 2 ) );
+  }
+
+  void testInsertAndEraseFlatMap()
+  {
+    flat_map< std::string, int > map;
+    map[ "b" ] = 2;
+    map[ "a" ] = 1;
+    assert( !map.try_emplace( "a", 5 ).second );
+    assert( map.insert( { "c", 3 } ).second );
+
+    // Heterogeneous lookup with the default transparent comparator.
+    assert( *select( map, "a" ) == 1 );
+    assert( *select( map, std::string_view{ "c" } ) == 3 );
+
+    assert( map.erase( "b" ) == 1 );
+    assert( map.erase( "b" ) == 0 );
+    assert( select( map, "b" ) == nullptr );
+    assert( map.size() == 2 );
+  }
+
+  void testSelectFromFlatSet()
+  {
+    const flat_set< int > set{ 5, 3, 9, 3, 1 };
+
+    auto existing{ select( set, 9 ) };
+    auto missing{ select( set, 4 ) };
+    auto predicated{ select_if( set, []( const int value ){ return value > 4; } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const int * > ) );
+    assert( set.size() == 4 );
+    assert( existing != nullptr && *existing == 9 );
+    assert( missing == nullptr );
+    assert( predicated != nullptr && *predicated == 5 );
+    assert( &select_or_default( set, 4 ) == &detail_n::static_default< int >() );
+  }
+}
+
+int main()
+{
+  testBuildFromUnsortedEntries();
+
+  testSelectFromConstantFlatMap();
+  testSelectFromMutableFlatMap();
+  testSelectOrDefaultFromFlatMap();
+  testSelectIfFromFlatMapValues();
+  testInsertAndEraseFlatMap();
+
+  testSelectFromFlatSet();
+}
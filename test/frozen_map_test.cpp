@@ -0,0 +1,87 @@
+#include <cassert>
+#include <string_view>
+
+#include "frozen_map.h"
+#include "select.h"
+#include "select_if.h"
+#include "select_or_default.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using entry_t = test_n::test_map_entry;
+
+  enum class opcode
+  {
+    NOP, LOAD, STORE, ADD, SUB, MUL, DIV, JMP, JZ, JNZ, CALL, RET, PUSH, POP, AND, OR, XOR, NOT, SHL, SHR, HALT,
+  };
+
+  constexpr auto small_map{ make_frozen_map< entry_t, std::string_view >( { { entry_t::EXISTING, "existing" } } ) };
+
+  constexpr auto opcode_names{ make_frozen_map< opcode, std::string_view >( {
+    { opcode::NOP, "nop" }, { opcode::LOAD, "load" }, { opcode::STORE, "store" }, { opcode::ADD, "add" }, { opcode::SUB, "sub" },
+    { opcode::MUL, "mul" }, { opcode::DIV, "div" }, { opcode::JMP, "jmp" }, { opcode::JZ, "jz" }, { opcode::JNZ, "jnz" },
+    { opcode::CALL, "call" }, { opcode::RET, "ret" }, { opcode::PUSH, "push" }, { opcode::POP, "pop" }, { opcode::AND, "and" },
+    { opcode::OR, "or" }, { opcode::XOR, "xor" }, { opcode::NOT, "not" }, { opcode::SHL, "shl" }, { opcode::SHR, "shr" },
+  } ) };
+
+  constexpr auto keywords{ make_frozen_set< std::string_view >( {
+    "alignas", "auto", "bool", "break", "case", "catch", "char", "class", "const", "constexpr", "continue", "default", "delete",
+    "do", "double", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline",
+  } ) };
+
+  // Lookups with constant keys are evaluated at compile time.
+  static_assert( *select( small_map, entry_t::EXISTING ) == "existing" );
+  static_assert( select( small_map, entry_t::MISSING ) == nullptr );
+  static_assert( decltype( opcode_names.size() ){ 20 } == opcode_names.size() );
+  static_assert( *select( opcode_names, opcode::XOR ) == "xor" );
+  static_assert( select( opcode_names, opcode::HALT ) == nullptr );
+  static_assert( select_or_default( opcode_names, opcode::HALT, std::string_view{ "?" } ) == "?" );
+  static_assert( select( keywords, "constexpr" ) != nullptr );
+  static_assert( select( keywords, "volatile" ) == nullptr );
+
+  void testSelectFromFrozenMap()
+  {
+    auto existing{ select( opcode_names, opcode::LOAD ) };
+    auto missing{ select( opcode_names, opcode::HALT ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const std::string_view * > ) );
+    assert( existing == &opcode_names.at( opcode::LOAD ) );
+    assert( missing == nullptr );
+
+    for ( const auto &[ key, name ] : opcode_names )
+      assert( select( opcode_names, key ) == &name );
+  }
+
+  void testSelectOrDefaultFromFrozenMap()
+  {
+    const auto &def{ detail_n::static_default< std::string_view >() };
+
+    assert( &select_or_default( small_map, entry_t::EXISTING ) == &small_map.at( entry_t::EXISTING ) );
+    assert( &select_or_default( small_map, entry_t::MISSING ) == &def );
+  }
+
+  void testSelectIfFromFrozenMap()
+  {
+    auto existing{ select_if( opcode_names, []( const auto &entry ){ return entry.second.size() == 5; } ) };
+
+    assert( existing != nullptr && existing->second == "store" );
+  }
+
+  void testSelectFromFrozenSet()
+  {
+    for ( const auto &keyword : keywords )
+      assert( select( keywords, keyword ) == &keyword );
+    assert( select( keywords, std::string_view{ "while" } ) == nullptr );
+  }
+}
+
+int main()
+{
+  testSelectFromFrozenMap();
+  testSelectOrDefaultFromFrozenMap();
+  testSelectIfFromFrozenMap();
+  testSelectFromFrozenSet();
+}
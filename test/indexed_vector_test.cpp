@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "indexed_vector.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  struct record
+  {
+    int id;
+    std::string owner;
+    int status;
+  };
+
+  struct by_id {};
+  struct by_owner {};
+  struct by_status {};
+  struct by_bucket {};
+
+  using records_t = indexed_vector< record,
+                                    hashed_index< by_id, &record::id >,
+                                    hashed_index< by_owner, &record::owner >,
+                                    ordered_index< by_status, &record::status >,
+                                    ordered_index< by_bucket, []( const record &r ){ return r.id % 10; } > >;
+
+  //! Owner names longer than any small string buffer, so a temporary \c std::string of them would allocate.
+  std::string make_owner( const int index )
+  {
+    return "an owner with a rather long name #" + std::to_string( index );
+  }
+
+  records_t make_test_records( const int count )
+  {
+    records_t records;
+    for ( int i{ 0 }; i < count; ++i )
+      records.push_back( { i, make_owner( i % 13 ), i % 5 } );
+    return records;
+  }
+
+  //! Check that all indexes agree with a linear scan of \c records .
+  void checkIndexes( const records_t &records )
+  {
+    for ( int key{ -1 }; key < 120; ++key )
+    {
+      const auto owner{ make_owner( key ) };
+      const auto by_id_entry{ std::find_if( records.begin(), records.end(), [ key ]( const record &r ){ return r.id == key; } ) };
+      const auto by_owner_entry{ std::find_if( records.begin(), records.end(), [ &owner ]( const record &r ){ return r.owner == owner; } ) };
+      const auto by_status_entry{ std::find_if( records.begin(), records.end(), [ key ]( const record &r ){ return r.status == key; } ) };
+
+      assert( select_by( records, by_id{}, key ) == ( by_id_entry != records.end() ? &*by_id_entry : nullptr ) );
+      // Both kinds of index find the first element with the key.
+      assert( select_by( records, by_owner{}, owner ) == ( by_owner_entry != records.end() ? &*by_owner_entry : nullptr ) );
+      assert( select_by( records, by_status{}, key ) == ( by_status_entry != records.end() ? &*by_status_entry : nullptr ) );
+    }
+  }
+
+  void testSelectBy()
+  {
+    const auto records{ make_test_records( 100 ) };
+
+    assert( select_by( records, by_id{}, 42 ) == &records[ 42 ] );
+    assert( select_by( records, by_id{}, 100 ) == nullptr );
+    assert( select_by( records, by_owner{}, make_owner( 3 ) )->owner == make_owner( 3 ) );
+    assert( select_by( records, by_status{}, 4 ) == &records[ 4 ] );
+    assert( select_by( records, by_status{}, 5 ) == nullptr );
+    assert( select_by( records, by_bucket{}, 7 ) == &records[ 7 ] );
+    checkIndexes( records );
+  }
+
+  void testSelectByStringViewDoesNotAllocate()
+  {
+    const auto records{ make_test_records( 20 ) };
+    const auto owner{ make_owner( 5 ) };
+    const std::string_view key{ owner };
+    const test_n::AllocationCounter counter;
+
+    assert( select_by( records, by_owner{}, key )->owner == owner );
+    assert( select_by( records, by_owner{}, key.substr( 1 ) ) == nullptr );
+    assert( counter.allocations() == 0 );
+  }
+
+  void testEraseKeepsIndexes()
+  {
+    auto records{ make_test_records( 100 ) };
+
+    // Erase from the middle, the front and the back.
+    for ( const std::size_t position : { 50u, 0u, 97u, 13u, 13u, 60u } )
+    {
+      const auto id{ records[ position ].id };
+      records.erase( position );
+      assert( select_by( records, by_id{}, id ) == nullptr );
+      checkIndexes( records );
+    }
+    assert( records.size() == 94 );
+
+    while ( !records.empty() )
+      records.erase( records.size() / 2 );
+    checkIndexes( records );
+  }
+
+  void testModifyKeepsIndexes()
+  {
+    auto records{ make_test_records( 50 ) };
+
+    records.modify( 10, []( record &r ){ r.id = 110; r.owner = make_owner( 99 ); r.status = 7; } );
+
+    assert( select_by( records, by_id{}, 10 ) == nullptr );
+    assert( select_by( records, by_id{}, 110 ) == &records[ 10 ] );
+    assert( select_by( records, by_owner{}, make_owner( 99 ) ) == &records[ 10 ] );
+    assert( select_by( records, by_status{}, 7 ) == &records[ 10 ] );
+    checkIndexes( records );
+
+    bool thrown{ false };
+    try
+    {
+      records.modify( 20, []( record &r ){ r.id = 120; throw std::runtime_error{ "failed" }; } );
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+    assert( select_by( records, by_id{}, 120 ) == &records[ 20 ] );
+    checkIndexes( records );
+  }
+
+  struct by_checked_status {};
+
+  //! Status key, which fails to be extracted for negative status.
+  constexpr auto checked_status{ []( const record &r )
+  {
+    if ( r.status < 0 )
+      throw std::invalid_argument{ "negative status" };
+    return r.status;
+  } };
+
+  void testFailedReindexErases()
+  {
+    indexed_vector< record, hashed_index< by_id, &record::id >, ordered_index< by_checked_status, checked_status > > records;
+    for ( int i{ 0 }; i < 10; ++i )
+      records.push_back( { i, make_owner( i ), i % 3 } );
+
+    bool thrown{ false };
+    try
+    {
+      records.modify( 4, []( record &r ){ r.id = 40; r.status = -1; } );
+    }
+    catch ( const std::invalid_argument & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+
+    // The element cannot be indexed, so it is gone, and the last element took its place.
+    assert( records.size() == 9 );
+    assert( select_by( records, by_id{}, 40 ) == nullptr );
+    assert( select_by( records, by_id{}, 4 ) == nullptr );
+    assert( select_by( records, by_id{}, 9 ) == &records[ 4 ] );
+    for ( const auto &r : records )
+      assert( select_by( records, by_id{}, r.id ) == &r );
+
+    while ( !records.empty() )
+      records.erase( 0 );
+    assert( select_by( records, by_checked_status{}, 0 ) == nullptr );
+  }
+
+  void testSelectOrDefaultBy()
+  {
+    const auto records{ make_test_records( 10 ) };
+    const record def{ -1, "nobody", -1 };
+
+    auto &existing{ select_or_default_by( records, by_id{}, 3, def ) };
+    auto &missing{ select_or_default_by( records, by_id{}, 30, def ) };
+    auto copied{ select_or_default_by( records, by_id{}, 30, record{ -2, "temporary", -2 } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const record & > ) );
+    assert( &existing == &records[ 3 ] );
+    assert( &missing == &def );
+    assert( ( std::is_same_v< decltype( copied ), record > ) );
+    assert( copied.id == -2 );
+  }
+
+  void testClear()
+  {
+    auto records{ make_test_records( 10 ) };
+    records.clear();
+
+    assert( records.empty() );
+    assert( select_by( records, by_id{}, 1 ) == nullptr );
+
+    records.push_back( { 1, "one", 1 } );
+    assert( select_by( records, by_owner{}, std::string_view{ "one" } ) == &records[ 0 ] );
+  }
+}
+
+int main()
+{
+  testSelectBy();
+  testSelectByStringViewDoesNotAllocate();
+  testEraseKeepsIndexes();
+  testModifyKeepsIndexes();
+  testFailedReindexErases();
+  testSelectOrDefaultBy();
+  testClear();
+}
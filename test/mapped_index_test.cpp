@@ -0,0 +1,175 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "mapped_index.h"
+#include "select.h"
+#include "select_if.h"
+#include "select_or_default.h"
+
+using namespace select_n;
+
+namespace
+{
+  //! Path of a temporary index file, removed on destruction.
+  struct temporary_path
+  {
+    std::filesystem::path path{ std::filesystem::temp_directory_path() / ( "select_n_mapped_index_test_" + std::to_string( ::getpid() ) ) };
+    ~temporary_path() { std::filesystem::remove( path ); }
+  };
+
+  //! Check whether \c pointer points into the mapping of \c index .
+  template< typename INDEX >
+  bool is_mapped( const INDEX &index, const void *pointer )
+  {
+    const auto bytes{ index.bytes() };
+    return pointer >= bytes.data() && pointer < bytes.data() + bytes.size();
+  }
+
+  void testSelectFromIntegerIndex()
+  {
+    const temporary_path file;
+    mapped_index_builder< std::uint64_t, std::int32_t > builder;
+    for ( std::uint64_t key{ 0 }; key < 1000; ++key )
+      builder.add( 3 * key, static_cast< std::int32_t >( key ) );
+    builder.add( 3, -1 );
+    builder.write( file.path );
+
+    const mapped_index< std::uint64_t, std::int32_t > index{ file.path };
+    assert( index.size() == 1000 );
+
+    auto existing{ select( index, std::uint64_t{ 300 } ) };
+    auto missing{ select( index, std::uint64_t{ 301 } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const std::int32_t * > ) );
+    assert( existing && *existing == 100 );
+    assert( is_mapped( index, existing ) );
+    assert( missing == nullptr );
+
+    // The first entry of a duplicate key is kept.
+    assert( *select( index, std::uint64_t{ 3 } ) == 1 );
+    assert( select_or_default( index, std::uint64_t{ 4 }, -1 ) == -1 );
+
+    const auto large{ select_if( index, []( const auto &record ){ return record.second > 500; } ) };
+    assert( large && large->first == 3 * 501 );
+  }
+
+  void testSelectFromStringIndex()
+  {
+    const temporary_path file;
+    mapped_index_builder< relative_string, relative_string > builder;
+    builder.add( "timeout", "30s" );
+    builder.add( "host", "localhost" );
+    builder.add( "empty", "" );
+    builder.write( file.path );
+
+    const mapped_index< relative_string, relative_string > index{ file.path };
+    const relative_string def;
+
+    auto &existing{ select_or_default( index, std::string_view{ "host" }, def ) };
+    auto &missing{ select_or_default( index, std::string_view{ "port" }, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const relative_string & > ) );
+    assert( existing.view() == "localhost" );
+    assert( is_mapped( index, existing.view().data() ) );
+    assert( &missing == &def );
+    assert( select( index, std::string{ "timeout" } )->view() == "30s" );
+    assert( select( index, "empty" )->empty() );
+    assert( index.begin()->first == "empty" );
+  }
+
+  void testSelectFromStringSet()
+  {
+    const temporary_path file;
+    mapped_index_builder< relative_string > builder;
+    builder.add( "b" );
+    builder.add( "a" );
+    builder.write( file.path );
+
+    const mapped_set< relative_string > set{ file.path };
+    assert( set.size() == 2 );
+    assert( *select( set, "a" ) == "a" );
+    assert( select( set, "c" ) == nullptr );
+  }
+
+  void testRejectInvalidFiles()
+  {
+    const temporary_path file;
+
+    bool thrown{ false };
+    try
+    {
+      mapped_index< std::uint64_t > index{ file.path };
+    }
+    catch ( const std::system_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+
+    std::ofstream{ file.path } << std::string( 100, 'x' );
+    thrown = false;
+    try
+    {
+      mapped_index< std::uint64_t > index{ file.path };
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+
+    mapped_index_builder< std::uint64_t > builder;
+    builder.add( 1 );
+    builder.write( file.path );
+    thrown = false;
+    try
+    {
+      // Wrong record type.
+      mapped_index< std::uint32_t > index{ file.path };
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+  }
+
+  void testFailedWriteLeavesNoTemporaryFile()
+  {
+    // A file cannot replace a directory, so the rename fails.
+    const temporary_path directory;
+    std::filesystem::create_directory( directory.path );
+
+    mapped_index_builder< std::uint64_t > builder;
+    builder.add( 1 );
+    bool thrown{ false };
+    try
+    {
+      builder.write( directory.path );
+    }
+    catch ( const std::system_error & )
+    {
+      thrown = true;
+    }
+    assert( thrown );
+    assert( std::filesystem::is_directory( directory.path ) );
+
+    auto temporary{ directory.path };
+    temporary += ".tmp";
+    assert( !std::filesystem::exists( temporary ) );
+  }
+}
+
+int main()
+{
+  testSelectFromIntegerIndex();
+  testSelectFromStringIndex();
+  testSelectFromStringSet();
+  testRejectInvalidFiles();
+  testFailedWriteLeavesNoTemporaryFile();
+}
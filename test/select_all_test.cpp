@@ -0,0 +1,122 @@
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <ranges>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "select_all.h"
+#include "test_util.h"
+
+using namespace select_n;
+using test_n::Tracer;
+
+namespace
+{
+  std::vector< Tracer > make_test_tracers( const std::size_t count )
+  {
+    Tracer::Silencer silencer;
+    return std::vector< Tracer >( count );
+  }
+
+  void testSelectAllFromVector()
+  {
+    auto tracers{ make_test_tracers( 10 ) };
+    Tracer::clear_log();
+
+    std::vector< const Tracer * > selected;
+    for ( auto &tracer : select_all( tracers, []( const Tracer &tracer ){ return tracer.id() % 3 == 0; } ) )
+      selected.push_back( &tracer );
+
+    assert( !selected.empty() );
+    for ( const auto &tracer : tracers )
+      assert( ( std::ranges::find( selected, &tracer ) != selected.end() ) == ( tracer.id() % 3 == 0 ) );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectAllStopsEarly()
+  {
+    const std::vector< int > numbers{ 1, 2, 3, 4, 5, 6, 7, 8 };
+    std::size_t tests{ 0 };
+
+    auto even{ select_all( numbers, [ &tests ]( const int number ){ ++tests; return number % 2 == 0; } ) };
+    assert( tests == 0 );
+
+    auto first{ even.begin() };
+    assert( *first == 2 );
+    assert( &*first == &numbers[ 1 ] );
+    assert( tests == 2 );
+    assert( std::ranges::distance( even ) == 4 );
+  }
+
+  void testSelectAllComposes()
+  {
+    const std::vector< int > numbers{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    const auto is_even{ []( const int number ){ return number % 2 == 0; } };
+
+    std::vector< int > taken;
+    for ( const int number : numbers | std::views::reverse | views::select_all( is_even ) | std::views::take( 2 ) )
+      taken.push_back( number );
+
+    assert( ( taken == std::vector{ 10, 8 } ) );
+    assert( std::ranges::distance( select_all( std::vector{ 1, 2, 3, 4 }, is_even ) ) == 2 );
+  }
+
+  void testSelectAllFromMultimap()
+  {
+    std::multimap< int, Tracer > map;
+    {
+      Tracer::Silencer silencer;
+      map.emplace( 1, Tracer{} );
+      map.emplace( 2, Tracer{} );
+      map.emplace( 2, Tracer{} );
+    }
+    Tracer::clear_log();
+
+    auto existing{ select_all( map, 2 ) };
+    auto missing{ select_all( map, 3 ) };
+
+    std::size_t count{ 0 };
+    for ( Tracer &tracer : existing )
+    {
+      assert( &tracer == &std::next( map.begin(), static_cast< std::ptrdiff_t >( 1 + count ) )->second );
+      ++count;
+    }
+    assert( count == 2 );
+    assert( std::ranges::empty( missing ) );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectAllFromUnorderedMultimap()
+  {
+    const std::unordered_multimap< std::string, int > map{ { "a", 1 }, { "b", 2 }, { "b", 3 } };
+
+    int sum{ 0 };
+    for ( const int &value : select_all( map, std::string{ "b" } ) )
+      sum += value;
+
+    assert( sum == 5 );
+  }
+
+  void testSelectAllFromMultiset()
+  {
+    const std::multiset< int > set{ 1, 2, 2, 2, 3 };
+
+    auto existing{ select_all( set, 2 ) };
+
+    assert( std::ranges::distance( existing ) == 3 );
+    assert( &*existing.begin() == &*set.find( 2 ) );
+  }
+}
+
+int main()
+{
+  testSelectAllFromVector();
+  testSelectAllStopsEarly();
+  testSelectAllComposes();
+  testSelectAllFromMultimap();
+  testSelectAllFromUnorderedMultimap();
+  testSelectAllFromMultiset();
+}
@@ -1,4 +1,9 @@
 #include <cassert>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 #include "select_if.h"
 #include "test_util.h"
@@ -9,6 +14,8 @@ namespace
 {
   using test_n::Tracer;
 
+  using test_n::long_key;
+
   template< auto c >
   struct constant_function
   {
@@ -43,10 +50,83 @@ namespace
     assert( missing == nullptr );
     assert( Tracer::log().empty() );
   }
+
+  void testSelectEachInOnePass()
+  {
+    const std::vector< int > vec{ 1, 3, 8, 5, 6, 9, 12, 7 };
+    std::size_t even_tests{ 0 };
+    std::size_t large_tests{ 0 };
+    std::size_t negative_tests{ 0 };
+
+    auto [ even, large, negative ]{ select_if_each( vec,
+                                                    [ & ]( const int value ){ ++even_tests; return value % 2 == 0; },
+                                                    [ & ]( const int value ){ ++large_tests; return value > 5; },
+                                                    [ & ]( const int value ){ ++negative_tests; return value < 0; } ) };
+
+    assert( ( std::is_same_v< decltype( even ), const int * > ) );
+    assert( even == &vec[ 2 ] );
+    assert( large == &vec[ 2 ] );
+    assert( negative == nullptr );
+    // Matched predicates are not tested again, and the unmatched one sees each element once.
+    assert( even_tests == 3 );
+    assert( large_tests == 3 );
+    assert( negative_tests == vec.size() );
+  }
+
+  void testSelectEachStopsEarly()
+  {
+    std::vector< int > vec{ 4, 1, 2, 3, 4 };
+    std::size_t visited{ 0 };
+
+    const auto found{ select_if_each( vec, [ & ]( const int value ){ ++visited; return value == 1; }, constant_function< true >{} ) };
+
+    assert( ( std::is_same_v< decltype( found ), const std::tuple< int *, int * > > ) );
+    assert( std::get< 0 >( found ) == &vec[ 1 ] );
+    assert( std::get< 1 >( found ) == &vec[ 0 ] );
+    assert( visited == 2 );
+
+    *std::get< 0 >( found ) = 10;
+    assert( vec[ 1 ] == 10 );
+  }
+
+  void testSelectEachFromMapAndConstant()
+  {
+    const std::map< int, std::string > map{ { 1, "one" }, { 2, "two" }, { 3, "three" } };
+    const auto [ long_name, odd ]{ select_if_each( map, []( const auto &entry ){ return entry.second.size() > 3; }, []( const auto &entry ){ return entry.first % 2 == 1; } ) };
+    assert( long_name == &*map.find( 3 ) );
+    assert( odd == &*map.find( 1 ) );
+
+    static_assert( []()
+    {
+      constexpr std::string_view text{ "select" };
+      const auto [ vowel, missing ]{ select_if_each( text, []( const char c ){ return c == 'e'; }, []( const char c ){ return c == 'z'; } ) };
+      return vowel == text.data() + 1 && missing == nullptr;
+    }() );
+  }
+
+  void testSelectByStringViewDoesNotAllocate()
+  {
+    const std::vector< std::string > vec{ std::string{ long_key } };
+    const std::map< std::string, int, std::less<> > map{ { std::string{ long_key }, 1 } };
+    const test_n::AllocationCounter counter;
+
+    auto existing{ select_if( vec, []( const std::string_view value ){ return value == long_key; } ) };
+    auto missing{ select_if( vec, []( const std::string_view value ){ return value.empty(); } ) };
+    auto entry{ select_if( map, []( const auto &entry ){ return entry.first == long_key; } ) };
+
+    assert( existing == &vec.front() );
+    assert( missing == nullptr );
+    assert( entry == &*map.begin() );
+    assert( counter.allocations() == 0 );
+  }
 }
 
 int main()
 {
   testSelectFromConstantVector();
   testSelectFromMutableVector();
-}
\ No newline at end of file
+  testSelectEachInOnePass();
+  testSelectEachStopsEarly();
+  testSelectEachFromMapAndConstant();
+  testSelectByStringViewDoesNotAllocate();
+}
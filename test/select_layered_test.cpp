@@ -0,0 +1,153 @@
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "flat_map.h"
+#include "key_hash.h"
+#include "select_layered.h"
+#include "small_map.h"
+#include "test_util.h"
+
+using namespace select_n;
+using test_n::Tracer;
+
+namespace
+{
+  using entry_t = test_n::test_map_entry;
+
+  //! Counts its comparisons, to tell which layers were searched.
+  struct counting_less
+  {
+    using is_transparent = void;
+
+    std::size_t *comparisons;
+
+    bool operator()( const std::string_view a, const std::string_view b ) const noexcept
+    {
+      ++*comparisons;
+      return a < b;
+    }
+  };
+
+  void testSelectFirstFromMutableLayers()
+  {
+    auto overrides{ test_n::make_test_map() };
+    auto defaults{ test_n::make_test_map() };
+    test_n::testMap_t empty;
+    Tracer::clear_log();
+
+    auto existing{ select_first( entry_t::EXISTING, empty, overrides, defaults ) };
+    auto missing{ select_first( entry_t::MISSING, empty, overrides, defaults ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer * > ) );
+    assert( existing == &overrides.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectFirstFromMixedLayers()
+  {
+    small_map< std::string, int, 4 > request{ { "retries", 3 } };
+    std::unordered_map< std::string, int, key_hash< std::string >, std::equal_to<> > tenant{ { "timeout", 5 } };
+    const std::map< std::string, int, std::less<> > defaults{ { "timeout", 30 }, { "retries", 1 }, { "verbose", 0 } };
+    const std::string_view timeout{ "timeout" };
+
+    auto from_tenant{ select_first( timeout, request, tenant, defaults ) };
+    auto from_request{ select_first( std::string_view{ "retries" }, request, tenant, defaults ) };
+    auto from_defaults{ select_first( std::string_view{ "verbose" }, request, tenant, defaults ) };
+
+    assert( ( std::is_same_v< decltype( from_tenant ), const int * > ) );
+    assert( from_tenant == &tenant.at( "timeout" ) );
+    assert( from_request == &request.at( "retries" ) );
+    assert( from_defaults == &defaults.at( "verbose" ) );
+    assert( select_first( std::string_view{ "missing" }, request, tenant, defaults ) == nullptr );
+  }
+
+  void testSelectFirstStopsAtFirstHit()
+  {
+    std::size_t first_comparisons{ 0 };
+    std::size_t second_comparisons{ 0 };
+    const std::map< std::string, int, counting_less > first{ { { "a", 1 } }, counting_less{ &first_comparisons } };
+    const std::map< std::string, int, counting_less > second{ { { "a", 2 }, { "b", 3 } }, counting_less{ &second_comparisons } };
+    first_comparisons = second_comparisons = 0;
+
+    assert( *select_first( std::string_view{ "a" }, first, second ) == 1 );
+    assert( first_comparisons > 0 );
+    assert( second_comparisons == 0 );
+
+    assert( *select_first( std::string_view{ "b" }, first, second ) == 3 );
+    assert( second_comparisons > 0 );
+  }
+
+  void testSelectOrDefaultLayeredFromMutableLayers()
+  {
+    auto overrides{ test_n::make_test_map() };
+    flat_map< entry_t, Tracer > empty;
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default_layered( entry_t::EXISTING, def, empty, overrides ) };
+    auto &missing{ select_or_default_layered( entry_t::MISSING, def, empty, overrides ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &overrides.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultLayeredFromConstantLayer()
+  {
+    auto overrides{ test_n::make_test_map() };
+    const auto defaults{ test_n::make_test_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default_layered( entry_t::EXISTING, def, overrides, defaults ) };
+    auto &missing{ select_or_default_layered( entry_t::MISSING, def, overrides, defaults ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer & > ) );
+    assert( &existing == &overrides.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultLayeredFromTemporaryDefault()
+  {
+    auto overrides{ test_n::make_test_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto missing{ select_or_default_layered( entry_t::MISSING, std::move( def ), overrides ) };
+
+    assert( ( std::is_same_v< decltype( missing ), Tracer > ) );
+    assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::MOVE_CONSTRUCTION, def.id() } } ) );
+  }
+
+  void testSelectOrDefaultLayeredWithConvertedDefault()
+  {
+    const std::map< std::string, std::string, std::less<> > tenant{ { "name", "tenant" } };
+    const std::map< std::string, std::string, std::less<> > defaults{ { "name", "global" }, { "locale", "en" } };
+
+    assert( ( std::is_same_v< decltype( select_or_default_layered( std::string_view{ "name" }, "none", tenant, defaults ) ), const std::string > ) );
+    assert( select_or_default_layered( std::string_view{ "name" }, "none", tenant, defaults ) == "tenant" );
+    assert( select_or_default_layered( std::string_view{ "locale" }, "none", tenant, defaults ) == "en" );
+    assert( select_or_default_layered( std::string_view{ "zone" }, "none", tenant, defaults ) == "none" );
+  }
+}
+
+int main()
+{
+  testSelectFirstFromMutableLayers();
+  testSelectFirstFromMixedLayers();
+  testSelectFirstStopsAtFirstHit();
+  testSelectOrDefaultLayeredFromMutableLayers();
+  testSelectOrDefaultLayeredFromConstantLayer();
+  testSelectOrDefaultLayeredFromTemporaryDefault();
+  testSelectOrDefaultLayeredWithConvertedDefault();
+}
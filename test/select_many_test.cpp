@@ -0,0 +1,217 @@
+#include <cassert>
+#include <array>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "flat_map.h"
+#include "key_hash.h"
+#include "select_many.h"
+#include "select_sorted.h"
+#include "swiss_map.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  //! Every third key is missing, and there are more keys than fit into a single batch.
+  std::vector< int > make_keys()
+  {
+    std::vector< int > keys;
+    for ( int key{ 0 }; key < 100; ++key )
+      keys.push_back( key % 3 == 0 ? -key : key );
+    return keys;
+  }
+
+  template< typename CONTAINER >
+  void testSelectManyMatchesSelect( CONTAINER &container )
+  {
+    const auto keys{ make_keys() };
+    std::vector< decltype( select( container, keys.front() ) ) > results;
+
+    select_many( container, keys, std::back_inserter( results ) );
+
+    assert( results.size() == keys.size() );
+    for ( std::size_t i{ 0 }; i < keys.size(); ++i )
+      assert( results[ i ] == select( container, keys[ i ] ) );
+  }
+
+  //! Map wrapper counting the prefetch hints it receives.
+  struct PrefetchingMap : std::unordered_map< int, int >
+  {
+    std::size_t hash( const int &key ) const { return hash_function()( key ); }
+    void prefetch_hashed( std::size_t ) const { ++prefetches; }
+    mutable std::size_t prefetches{ 0 };
+  };
+
+  void testSelectManyFromStandardContainers()
+  {
+    std::map< int, std::string > map;
+    std::unordered_map< int, std::string > unordered;
+    std::set< int > set;
+    std::vector< int > vec;
+    for ( int key{ 1 }; key < 100; ++key )
+    {
+      map[ key ] = unordered[ key ] = std::to_string( key );
+      set.insert( key );
+      vec.push_back( key );
+    }
+
+    testSelectManyMatchesSelect( map );
+    testSelectManyMatchesSelect( std::as_const( map ) );
+    testSelectManyMatchesSelect( unordered );
+    testSelectManyMatchesSelect( set );
+    testSelectManyMatchesSelect( vec );
+  }
+
+  //! Hash putting many keys into the same bucket.
+  struct CollidingHash
+  {
+    std::size_t operator()( const int key ) const noexcept { return static_cast< std::size_t >( key ) % 4; }
+  };
+
+  void testSelectManyFromHashBuckets()
+  {
+    std::unordered_map< int, std::string > map;
+    std::unordered_map< int, int, CollidingHash > colliding;
+    std::unordered_set< int > set;
+    for ( int key{ 1 }; key < 100; ++key )
+    {
+      map[ key ] = std::to_string( key );
+      colliding[ key ] = -key;
+      set.insert( key );
+    }
+    static_assert( detail_n::BucketLayout< std::unordered_map< int, std::string >, const int & > );
+    static_assert( detail_n::BucketLayout< const std::unordered_set< int >, const int & > );
+    static_assert( !detail_n::BucketLayout< std::map< int, std::string >, const int & > );
+
+    testSelectManyMatchesSelect( map );
+    testSelectManyMatchesSelect( std::as_const( map ) );
+    testSelectManyMatchesSelect( colliding );
+    testSelectManyMatchesSelect( set );
+
+    std::unordered_map< int, std::string > empty;
+    testSelectManyMatchesSelect( empty );
+  }
+
+  void testHeterogeneousKeysDoNotAllocate()
+  {
+    using test_n::long_key;
+    const std::unordered_map< std::string, int, key_hash< std::string >, std::equal_to<> > map{ { std::string{ long_key }, 1 } };
+    const std::vector< const char * > keys{ long_key.data(), test_n::long_missing.data(), long_key.data() };
+    static_assert( !detail_n::BucketLayout< decltype( map ), const char *const & > );
+    std::array< const int *, 3 > results{};
+
+    const test_n::AllocationCounter counter;
+    select_many( map, keys, results.begin() );
+    assert( counter.allocations() == 0 );
+    assert( results[ 0 ] == &map.begin()->second );
+    assert( results[ 1 ] == nullptr );
+    assert( results[ 2 ] == &map.begin()->second );
+  }
+
+  void testSelectManyFromSortedLayouts()
+  {
+    std::vector< std::pair< int, std::string > > entries;
+    std::vector< int > vec;
+    for ( int key{ 99 }; key > 0; --key )
+    {
+      entries.emplace_back( key, std::to_string( key ) );
+      vec.insert( vec.begin(), key );
+    }
+
+    flat_map< int, std::string > map{ entries };
+    const flat_set< int > set{ vec };
+    const sorted_view view{ vec };
+
+    testSelectManyMatchesSelect( map );
+    testSelectManyMatchesSelect( set );
+    testSelectManyMatchesSelect( view );
+
+    // Degenerate layouts.
+    flat_map< int, std::string > empty;
+    const flat_set< int > single{ 5 };
+    testSelectManyMatchesSelect( empty );
+    testSelectManyMatchesSelect( single );
+  }
+
+  void testSelectManyPrefetches()
+  {
+    PrefetchingMap map;
+    map[ 1 ] = 1;
+
+    testSelectManyMatchesSelect( map );
+    assert( map.prefetches == make_keys().size() );
+  }
+
+  //! Hash counting its calls, and unlike the standard hash of \c int not the identity.
+  struct CountingHash
+  {
+    std::size_t operator()( const int key ) const noexcept
+    {
+      ++calls;
+      return static_cast< std::size_t >( key ) * 0x9e3779b97f4a7c15u;
+    }
+    static inline std::size_t calls{ 0 };
+  };
+
+  void testSelectManyFromSwissMap()
+  {
+    swiss_map< int, int, CountingHash > map;
+    swiss_map< std::string, int > strings;
+    for ( int key{ 1 }; key < 100; ++key )
+    {
+      map.try_emplace( key, -key );
+      strings.try_emplace( std::to_string( key ), key );
+    }
+    static_assert( detail_n::Prefetchable< swiss_map< int, int, CountingHash >, int > );
+    static_assert( detail_n::Prefetchable< swiss_map< std::string, int >, std::string > );
+
+    // select_many hashes each key once for its prefetch and lookup, and the check with select once more.
+    CountingHash::calls = 0;
+    testSelectManyMatchesSelect( map );
+    assert( CountingHash::calls == 2 * make_keys().size() );
+
+    std::vector< std::string > keys;
+    for ( const auto key : make_keys() )
+      keys.push_back( std::to_string( key ) );
+    std::vector< int * > results;
+    select_many( strings, keys, std::back_inserter( results ) );
+    for ( std::size_t i{ 0 }; i < keys.size(); ++i )
+      assert( results[ i ] == select( strings, keys[ i ] ) );
+  }
+
+  template< typename OUTPUT, typename DEFAULT >
+  concept SelectsOrDefaultMany = requires( const std::map< int, std::string > &map, const DEFAULT &def, OUTPUT out ){ select_or_default_many( map, std::vector{ 1 }, def, out ); };
+
+  void testSelectOrDefaultMany()
+  {
+    const std::map< int, std::string > map{ { 1, "one" }, { 2, "two" } };
+    const std::string def{ "none" };
+    std::vector< std::string > results;
+
+    select_or_default_many( map, std::vector{ 2, 3, 1 }, def, std::back_inserter( results ) );
+
+    assert( ( results == std::vector< std::string >{ "two", "none", "one" } ) );
+
+    // Outputs, which cannot take the entries or the default, are rejected at the call.
+    static_assert( SelectsOrDefaultMany< std::back_insert_iterator< std::vector< std::string > >, std::string > );
+    static_assert( !SelectsOrDefaultMany< std::back_insert_iterator< std::vector< int > >, std::string > );
+    static_assert( !SelectsOrDefaultMany< std::back_insert_iterator< std::vector< std::string > >, int > );
+  }
+}
+
+int main()
+{
+  testSelectManyFromStandardContainers();
+  testSelectManyFromHashBuckets();
+  testHeterogeneousKeysDoNotAllocate();
+  testSelectManyFromSortedLayouts();
+  testSelectManyPrefetches();
+  testSelectManyFromSwissMap();
+  testSelectOrDefaultMany();
+}
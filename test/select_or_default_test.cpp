@@ -1,6 +1,14 @@
+#include <any>
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
+#include "flat_map.h"
 #include "select_or_default.h"
 #include "test_util.h"
 
@@ -11,6 +19,9 @@ namespace
 {
   using entry_t = test_n::test_map_entry;
 
+  using test_n::long_key;
+  using test_n::long_missing;
+
   void testSelectImplicitDefaultFromConstantMap()
   {
     const auto map{ test_n::make_test_map() };
@@ -122,6 +133,163 @@ namespace
     assert( missing == def );
     assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::MOVE_CONSTRUCTION, def.id() } } ) );
   }
+  template< typename MAP >
+  void testSelectOrEmplace()
+  {
+    const auto source{ test_n::make_test_map() };
+    MAP map{ source.begin(), source.end() };
+    if constexpr ( requires { map.reserve( 2 ); } )
+      // Do not count relocations of a flat map's storage.
+      map.reserve( 2 );
+    const auto tracer{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_emplace( map, entry_t::EXISTING, tracer ) };
+    auto &missing{ select_or_emplace( map, entry_t::MISSING, tracer ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &map.at( entry_t::MISSING ) );
+    assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::COPY_CONSTRUCTION, missing.id() } } ) );
+  }
+
+  template< typename MAP >
+  void testSelectOrInsertWith()
+  {
+    const auto source{ test_n::make_test_map() };
+    MAP map{ source.begin(), source.end() };
+    if constexpr ( requires { map.reserve( 2 ); } )
+      // Do not count relocations of a flat map's storage.
+      map.reserve( 2 );
+    std::size_t calls{ 0 };
+    const auto factory{ [ &calls ]{ ++calls; return test_n::make_test_tracer(); } };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_insert_with( map, entry_t::EXISTING, factory ) };
+    assert( calls == 0 );
+    auto &missing{ select_or_insert_with( map, entry_t::MISSING, factory ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &map.at( entry_t::MISSING ) );
+    assert( calls == 1 );
+#ifdef __clang__
+    // Clang does not elide the conversion of the factory's result (CWG 2327) -> a single move.
+    assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::MOVE_CONSTRUCTION, missing.id() } } ) );
+#else
+    assert( Tracer::log().empty() );
+#endif
+  }
+
+  template< typename MAP >
+  void testSelectOrInsertWithGreedyValue()
+  {
+    // std::any could be constructed from the placeholder of the factory's result itself -> store the actual result.
+    MAP map{ { 0, std::any{ 0 } } };
+    if constexpr ( requires { map.reserve( 2 ); } )
+      // Do not relocate a flat map's storage.
+      map.reserve( 2 );
+    std::size_t calls{ 0 };
+    const auto factory{ [ &calls ]{ ++calls; return std::any{ 42 }; } };
+
+    auto &existing{ select_or_insert_with( map, 0, factory ) };
+    assert( calls == 0 );
+    auto &missing{ select_or_insert_with( map, 1, factory ) };
+
+    assert( ( std::is_same_v< decltype( missing ), std::any & > ) );
+    assert( &existing == &map.at( 0 ) );
+    assert( &missing == &map.at( 1 ) );
+    assert( calls == 1 );
+    assert( std::any_cast< int >( existing ) == 0 );
+    assert( std::any_cast< int >( missing ) == 42 );
+  }
+
+  //! Hash of \c int , counting its calls for \c key . Other keys are hashed e.g. when the map links a node into an empty bucket.
+  struct CountingHash
+  {
+    std::size_t operator()( const int hashed ) const noexcept
+    {
+      if ( hashed == key )
+        ++calls;
+      return std::hash< int >{}( hashed );
+    }
+    static inline int key{ 0 };
+    static inline std::size_t calls{ 0 };
+  };
+
+  void testSelectOrInsertWithConvertedValue()
+  {
+    // The value is constructed from the factory's result of another type -> still a single lookup.
+    std::unordered_map< int, std::string, CountingHash > map{ { 0, "zero" } };
+    map.reserve( 2 );
+    std::size_t calls{ 0 };
+    const auto factory{ [ &calls ]{ ++calls; return "one"; } };
+
+    CountingHash::key = 0;
+    CountingHash::calls = 0;
+    auto &existing{ select_or_insert_with( map, 0, factory ) };
+    assert( CountingHash::calls == 1 );
+    assert( calls == 0 );
+    CountingHash::key = 1;
+    CountingHash::calls = 0;
+    auto &missing{ select_or_insert_with( map, 1, factory ) };
+
+    assert( ( std::is_same_v< decltype( missing ), std::string & > ) );
+    assert( CountingHash::calls == 1 );
+    assert( calls == 1 );
+    assert( &existing == &map.at( 0 ) );
+    assert( &missing == &map.at( 1 ) );
+    assert( missing == "one" );
+  }
+
+  void testSelectOrEmplaceWithHint()
+  {
+    // No try_emplace for a heterogeneous key -> insertion hinted by lower_bound.
+    std::map< std::string, Tracer, std::less<> > map;
+    Tracer::clear_log();
+
+    auto &missing{ select_or_emplace( map, std::string_view{ "key" } ) };
+    auto &existing{ select_or_insert_with( map, std::string_view{ "key" }, []() -> Tracer { throw std::logic_error{ "not called" }; } ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( &existing == &missing );
+    assert( map.size() == 1 );
+    assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::DEFAULT_CONSTRUCTION, missing.id() } } ) );
+  }
+
+  void testTransparentLookupDoesNotAllocate()
+  {
+    const std::map< std::string, std::string, std::less<> > map{ { std::string{ long_key }, std::string{ long_key } } };
+    const std::string def{ long_missing };
+    const test_n::AllocationCounter counter;
+
+    auto &existing{ select_or_default( map, long_key, def ) };
+    auto &missing{ select_or_default( map, long_missing, def ) };
+    auto &implicit{ select_or_default( map, long_missing.data() ) };
+
+    assert( &existing == &map.begin()->second );
+    assert( &missing == &def );
+    assert( implicit.empty() );
+    assert( counter.allocations() == 0 );
+  }
+
+  void testSelectConvertedDefault()
+  {
+    // The default has to be converted -> return by value, instead of a reference to a temporary.
+    const std::map< std::string, std::string, std::less<> > map{ { "key", "value" } };
+
+    auto existing{ select_or_default( map, "key", "default" ) };
+    auto missing{ select_or_default( map, "missing", "default" ) };
+
+    assert( ( std::is_same_v< decltype( select_or_default( map, "key", "default" ) ), const std::string > ) );
+    assert( existing == "value" );
+    assert( missing == "default" );
+  }
 }
 
 int main()
@@ -134,4 +302,19 @@ int main()
   testSelectExplicitDefaultFromMutableMap();
   testSelectExplicitDefaultFromTemporaryMap();
   testSelectExplicitDefaultFromTemporaryDefault();
+
+  testSelectOrEmplace< test_n::testMap_t >();
+  testSelectOrEmplace< std::unordered_map< entry_t, Tracer > >();
+  testSelectOrEmplace< flat_map< entry_t, Tracer > >();
+  testSelectOrInsertWith< test_n::testMap_t >();
+  testSelectOrInsertWith< std::unordered_map< entry_t, Tracer > >();
+  testSelectOrInsertWith< flat_map< entry_t, Tracer > >();
+  testSelectOrInsertWithGreedyValue< std::map< int, std::any > >();
+  testSelectOrInsertWithGreedyValue< std::unordered_map< int, std::any > >();
+  testSelectOrInsertWithGreedyValue< flat_map< int, std::any > >();
+  testSelectOrInsertWithConvertedValue();
+  testSelectOrEmplaceWithHint();
+
+  testTransparentLookupDoesNotAllocate();
+  testSelectConvertedDefault();
 }
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "select_parallel.h"
+
+using namespace select_n;
+
+namespace
+{
+  constexpr parallel_policy test_policy{ .threshold = 1000, .min_block_size = 100, .threads = 4 };
+
+  std::vector< std::int64_t > make_test_vector()
+  {
+    std::vector< std::int64_t > vec( 1'000'000, 0 );
+    vec[ 123'456 ] = vec[ 654'321 ] = vec[ 999'999 ] = 1;
+    return vec;
+  }
+
+  void testSelectIfFindsFirstMatch()
+  {
+    const auto vec{ make_test_vector() };
+
+    auto existing{ select_if( test_policy, vec, []( const std::int64_t value ){ return value == 1; } ) };
+    auto missing{ select_if( test_policy, vec, []( const std::int64_t value ){ return value == 2; } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const std::int64_t * > ) );
+    assert( existing == &vec[ 123'456 ] );
+    assert( missing == nullptr );
+  }
+
+  void testSelectIfStopsEarly()
+  {
+    auto vec{ make_test_vector() };
+    vec[ 10 ] = 1;
+    std::atomic< std::size_t > calls{ 0 };
+
+    auto existing{ select_if( test_policy, vec, [ &calls ]( const std::int64_t value ){ ++calls; return value == 1; } ) };
+
+    assert( ( std::is_same_v< decltype( existing ), std::int64_t * > ) );
+    assert( existing == &vec[ 10 ] );
+    assert( calls < vec.size() / 2 );
+  }
+
+  void testSelectIfBelowThreshold()
+  {
+    const std::vector< int > vec{ 1, 2, 3, 2 };
+
+    assert( select_if( test_policy, vec, []( const int value ){ return value == 2; } ) == &vec[ 1 ] );
+    assert( select_if( parallel, vec, []( const int value ){ return value == 4; } ) == nullptr );
+  }
+
+  void testSelectIfRethrows()
+  {
+    const auto vec{ make_test_vector() };
+    bool thrown{ false };
+
+    try
+    {
+      select_if( test_policy, vec, []( const std::int64_t value ) -> bool { if ( value == 1 ) throw std::runtime_error{ "test" }; return false; } );
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+
+    assert( thrown );
+  }
+
+  void testSelectFromIntegralVector()
+  {
+    auto vec{ make_test_vector() };
+
+    auto existing{ select( test_policy, vec, 1 ) };
+    auto missing{ select( test_policy, vec, 2 ) };
+
+    assert( ( std::is_same_v< decltype( existing ), std::int64_t * > ) );
+    assert( existing == &vec[ 123'456 ] );
+    assert( missing == nullptr );
+  }
+
+  void testSelectFromStringVector()
+  {
+    std::vector< std::string > vec( 5000, "a" );
+    vec[ 4000 ] = vec[ 4500 ] = "b";
+
+    assert( select( test_policy, vec, std::string{ "b" } ) == &vec[ 4000 ] );
+    assert( select( test_policy, vec, std::string{ "c" } ) == nullptr );
+  }
+}
+
+int main()
+{
+  testSelectIfFindsFirstMatch();
+  testSelectIfStopsEarly();
+  testSelectIfBelowThreshold();
+  testSelectIfRethrows();
+
+  testSelectFromIntegralVector();
+  testSelectFromStringVector();
+}
@@ -0,0 +1,142 @@
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "key_hash.h"
+#include "select_path.h"
+#include "test_util.h"
+
+using namespace select_n;
+using test_n::Tracer;
+
+namespace
+{
+  using entry_t = test_n::test_map_entry;
+  using inner_t = std::unordered_map< std::string, test_n::testMap_t, key_hash< std::string >, std::equal_to<> >;
+  using nested_t = std::map< int, inner_t >;
+
+  nested_t make_test_nested_map()
+  {
+    Tracer::Silencer silencer;
+    nested_t nested;
+    nested[ 1 ][ "inner" ] = test_n::make_test_map();
+    nested[ 2 ];
+    return nested;
+  }
+
+  void testSelectPathFromConstantMap()
+  {
+    const auto nested{ make_test_nested_map() };
+    Tracer::clear_log();
+
+    auto existing{ select_path( nested, 1, std::string_view{ "inner" }, entry_t::EXISTING ) };
+    auto missing{ select_path( nested, 1, "inner", entry_t::MISSING ) };
+    auto missing_inner{ select_path( nested, 2, "inner", entry_t::EXISTING ) };
+    auto missing_outer{ select_path( nested, 3, "inner", entry_t::EXISTING ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer * > ) );
+    assert( existing == &nested.at( 1 ).at( "inner" ).at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( missing_inner == nullptr );
+    assert( missing_outer == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectPathFromMutableMap()
+  {
+    auto nested{ make_test_nested_map() };
+    Tracer::clear_log();
+
+    auto existing{ select_path( nested, 1, "inner", entry_t::EXISTING ) };
+    auto level{ select_path( nested, 1, "inner" ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer * > ) );
+    assert( existing == &nested.at( 1 ).at( "inner" ).at( entry_t::EXISTING ) );
+    assert( level == &nested.at( 1 ).at( "inner" ) );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectPathIntoVector()
+  {
+    const std::map< std::string, std::vector< int >, std::less<> > nested{ { "primes", { 2, 3, 5, 7 } } };
+
+    assert( select_path( nested, "primes", 5 ) == &nested.at( "primes" )[ 2 ] );
+    assert( select_path( nested, "primes", 4 ) == nullptr );
+    assert( select_path( nested, "squares", 4 ) == nullptr );
+  }
+
+  void testSelectPathOrDefaultFromMutableMap()
+  {
+    auto nested{ make_test_nested_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_path_or_default( nested, def, 1, "inner", entry_t::EXISTING ) };
+    auto &missing{ select_path_or_default( nested, def, 2, "inner", entry_t::EXISTING ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &nested.at( 1 ).at( "inner" ).at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectPathOrDefaultFromConstantMap()
+  {
+    const auto nested{ make_test_nested_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_path_or_default( nested, def, 1, "inner", entry_t::EXISTING ) };
+    auto &missing{ select_path_or_default( nested, def, 1, "inner", entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer & > ) );
+    assert( &existing == &nested.at( 1 ).at( "inner" ).at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectPathOrDefaultFromTemporaryMap()
+  {
+    auto nested{ make_test_nested_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto existing{ select_path_or_default( std::move( nested ), def, 1, "inner", entry_t::EXISTING ) };
+
+    std::cout << Tracer::log() << std::endl;
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer > ) );
+    assert( ( Tracer::log() == std::vector{ Tracer::log_entry_t{ Tracer::operation::MOVE_CONSTRUCTION, existing.id() } } ) );
+  }
+
+  void testSelectPathOrDefaultWithConvertedDefault()
+  {
+    const std::map< int, std::map< std::string, std::string, std::less<> > > nested{ { 1, { { "key", "value" } } } };
+
+    auto existing{ select_path_or_default( nested, "default", 1, "key" ) };
+    auto missing{ select_path_or_default( nested, "default", 2, "key" ) };
+
+    assert( ( std::is_same_v< decltype( select_path_or_default( nested, "default", 1, "key" ) ), const std::string > ) );
+    assert( existing == "value" );
+    assert( missing == "default" );
+  }
+}
+
+int main()
+{
+  testSelectPathFromConstantMap();
+  testSelectPathFromMutableMap();
+  testSelectPathIntoVector();
+  testSelectPathOrDefaultFromMutableMap();
+  testSelectPathOrDefaultFromConstantMap();
+  testSelectPathOrDefaultFromTemporaryMap();
+  testSelectPathOrDefaultWithConvertedDefault();
+}
@@ -0,0 +1,91 @@
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "select.h"
+
+using namespace select_n;
+
+namespace
+{
+  template< typename T >
+  void testSelectFromVectorOfSize( const std::size_t size )
+  {
+    std::vector< T > vec( size );
+    std::iota( vec.begin(), vec.end(), T{ 1 } );
+
+    for ( std::size_t position{ 0 }; position < size; ++position )
+    {
+      auto existing{ select( vec, vec[ position ] ) };
+
+      assert( ( std::is_same_v< decltype( existing ), T * > ) );
+      assert( existing == &vec[ position ] );
+    }
+
+    assert( select( vec, T{ 0 } ) == nullptr );
+
+#ifdef SELECT_N_SIMD_X86
+    // The dispatcher picks only one kernel, so check the baseline kernel explicitly.
+    for ( std::size_t position{ 0 }; position < size; ++position )
+      assert( detail_n::sse2_find_index( vec.data(), size, vec[ position ] ) == position );
+    assert( detail_n::sse2_find_index( vec.data(), size, T{ 0 } ) == size );
+#endif
+  }
+
+  template< typename T >
+  void testSelectFromVector()
+  {
+    // Cover empty input, partial blocks and the scalar tail of every kernel.
+    for ( std::size_t size{ 0 }; size < 100; ++size )
+      testSelectFromVectorOfSize< T >( size );
+  }
+
+  void testSelectFirstOfDuplicates()
+  {
+    std::vector< std::int64_t > vec( 80, 7 );
+    vec[ 41 ] = vec[ 73 ] = 3;
+
+    assert( select( vec, 3 ) == &vec[ 41 ] );
+  }
+
+  void testSelectFromConstantArray()
+  {
+    const std::array< std::uint32_t, 40 > arr{ [] {
+      std::array< std::uint32_t, 40 > result{};
+      std::iota( result.begin(), result.end(), 100u );
+      return result;
+    }() };
+
+    auto existing{ select( arr, 133 ) };
+    auto missing{ select( arr, 99 ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const std::uint32_t * > ) );
+    assert( existing == &arr[ 33 ] );
+    assert( missing == nullptr );
+  }
+
+  void testSelectWithArithmeticConversions()
+  {
+    const std::vector< std::uint32_t > unsigned_vec{ 1, 0xFFFFFFFFu, 2 };
+    const std::vector< std::int8_t > small_vec{ 1, 44, 2 };
+
+    // Same results as std::find, which converts both sides to their common type.
+    assert( select( unsigned_vec, -1 ) == &unsigned_vec[ 1 ] );
+    assert( select( small_vec, 300 ) == nullptr );
+    assert( select( small_vec, 44L ) == &small_vec[ 1 ] );
+  }
+}
+
+int main()
+{
+  testSelectFromVector< std::int8_t >();
+  testSelectFromVector< std::uint16_t >();
+  testSelectFromVector< std::int32_t >();
+  testSelectFromVector< std::uint64_t >();
+
+  testSelectFirstOfDuplicates();
+  testSelectFromConstantArray();
+  testSelectWithArithmeticConversions();
+}
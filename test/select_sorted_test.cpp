@@ -0,0 +1,167 @@
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "select_or_default.h"
+#include "select_sorted.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  std::vector< int > make_sorted_vector( const std::size_t size )
+  {
+    std::vector< int > vec;
+    for ( std::size_t i{ 0 }; i < size; ++i )
+      vec.push_back( static_cast< int >( 3 * i + 1 ) );
+    return vec;
+  }
+
+  void testSelectSorted()
+  {
+    for ( std::size_t size{ 0 }; size < 70; ++size )
+    {
+      const auto vec{ make_sorted_vector( size ) };
+
+      for ( const auto &value : vec )
+      {
+        auto existing{ select_sorted( vec, value ) };
+        assert( ( std::is_same_v< decltype( existing ), const int * > ) );
+        assert( existing == &value );
+
+        assert( select_sorted( vec, value - 1 ) == nullptr );
+        assert( select_sorted( vec, value + 1 ) == nullptr );
+      }
+    }
+  }
+
+  void testSelectSortedWithCompare()
+  {
+    std::vector< std::string > vec{ "delta", "charlie", "bravo", "alpha" };
+
+    auto existing{ select_sorted( vec, std::string{ "bravo" }, std::greater<>{} ) };
+    auto missing{ select_sorted( vec, std::string{ "echo" }, std::greater<>{} ) };
+
+    assert( ( std::is_same_v< decltype( existing ), std::string * > ) );
+    assert( existing == &vec[ 2 ] );
+    assert( missing == nullptr );
+  }
+
+  void testSelectInterpolated()
+  {
+    for ( std::size_t size{ 0 }; size < 70; ++size )
+    {
+      const auto vec{ make_sorted_vector( size ) };
+
+      for ( const auto &value : vec )
+      {
+        assert( select_interpolated( vec, value ) == &value );
+        assert( select_interpolated( vec, value + 1 ) == nullptr );
+      }
+      assert( select_interpolated( vec, -5 ) == nullptr );
+    }
+
+    // Skewed keys defeat the estimates, but must still be found.
+    const std::vector< std::uint64_t > skewed{ 0, 1, 2, 3, 4, 5, 6, 7, 1'000'000'000'000, 2'000'000'000'000 };
+    for ( const auto &value : skewed )
+      assert( select_interpolated( skewed, value ) == &value );
+    assert( select_interpolated( skewed, 8 ) == nullptr );
+
+    const std::vector< int > constant( 10, 4 );
+    assert( select_interpolated( constant, 4 ) != nullptr );
+    assert( select_interpolated( constant, 5 ) == nullptr );
+
+    // Character types are compared as integers, including keys outside of their range.
+    const std::string letters{ "acegikmoqsuwy" };
+    for ( const auto &letter : letters )
+      assert( select_interpolated( letters, letter ) == &letter );
+    assert( select_interpolated( letters, 'b' ) == nullptr );
+    assert( select_interpolated( letters, 1'000 ) == nullptr );
+    assert( select_interpolated( letters, -1 ) == nullptr );
+
+    const std::u8string utf8{ u8"acegikmoqsuwy" };
+    assert( select_interpolated( utf8, u8'k' ) == &utf8[ 5 ] );
+    assert( select_interpolated( utf8, u8'l' ) == nullptr );
+  }
+
+  void testSelectFromSortedView()
+  {
+    const auto vec{ make_sorted_vector( 20 ) };
+    const sorted_view view{ vec };
+    const auto &def{ detail_n::static_default< int >() };
+
+    auto existing{ select( view, 31 ) };
+    auto missing{ select( view, 32 ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const int * > ) );
+    assert( existing == &vec[ 10 ] );
+    assert( missing == nullptr );
+
+    assert( &select_or_default( view, 31 ) == &vec[ 10 ] );
+    assert( &select_or_default( view, 32 ) == &def );
+  }
+
+  void testSelectOrDefaultFromTemporarySortedView()
+  {
+    std::vector< std::string > vec{ std::string{ test_n::long_key }, "b", "c" };
+    const std::string def{ "default" };
+
+    // The view does not own the strings, so they are copied rather than moved out of the vector.
+    assert( select_or_default( sorted_view{ vec }, "b", def ) == "b" );
+    assert( select_or_default( sorted_view{ vec }, test_n::long_key, def ) == test_n::long_key );
+    assert( select_or_default( sorted_view{ vec }, "d", def ) == "default" );
+    assert( vec[ 0 ] == test_n::long_key && vec[ 1 ] == "b" );
+  }
+
+  void testSelectFromEytzingerSet()
+  {
+    for ( std::size_t size{ 0 }; size < 70; ++size )
+    {
+      auto vec{ make_sorted_vector( size ) };
+      std::reverse( vec.begin(), vec.end() );
+      const eytzinger_set< int > set( vec.begin(), vec.end() );
+
+      assert( set.size() == size );
+      assert( reinterpret_cast< std::uintptr_t >( set.begin() - 1 ) % 64 == 0 );
+      for ( const auto &value : vec )
+      {
+        auto existing{ select( set, value ) };
+        assert( ( std::is_same_v< decltype( existing ), const int * > ) );
+        assert( existing != nullptr && *existing == value );
+
+        assert( select( set, value - 1 ) == nullptr );
+        assert( select( set, value + 1 ) == nullptr );
+      }
+    }
+  }
+
+  void testSelectFromEytzingerSetOfTracers()
+  {
+    const auto vec{ test_n::make_test_vector() };
+    const eytzinger_set< test_n::Tracer > set( vec.begin(), vec.end() );
+    const auto &def{ detail_n::static_default< test_n::Tracer >() };
+    test_n::Tracer::clear_log();
+
+    auto existing{ select( set, vec.front() ) };
+    auto missing{ select( set, def ) };
+
+    assert( existing != nullptr && *existing == vec.front() );
+    assert( missing == nullptr );
+    assert( test_n::Tracer::log().empty() );
+  }
+}
+
+int main()
+{
+  testSelectSorted();
+  testSelectSortedWithCompare();
+  testSelectInterpolated();
+
+  testSelectFromSortedView();
+  testSelectOrDefaultFromTemporarySortedView();
+  testSelectFromEytzingerSet();
+  testSelectFromEytzingerSetOfTracers();
+}
@@ -0,0 +1,325 @@
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "flat_map.h"
+#include "select.h"
+#include "select_if.h"
+#include "select_layered.h"
+#include "select_many.h"
+#include "select_or_default.h"
+#include "select_path.h"
+#include "select_stats.h"
+
+using namespace select_n;
+
+namespace
+{
+  const stats_n::site_stats *find_site( const std::vector< stats_n::site_stats > &sites, const std::uint_least32_t line )
+  {
+    for ( const auto &site : sites )
+      if ( site.line == line )
+        return &site;
+    return nullptr;
+  }
+
+  const stats_n::site_stats *find_operation( const std::vector< stats_n::site_stats > &sites, const std::string_view operation )
+  {
+    for ( const auto &site : sites )
+      if ( site.operation == operation )
+        return &site;
+    return nullptr;
+  }
+
+  //! Number of tables of running threads.
+  std::size_t running_tables_count()
+  {
+    auto &registry{ stats_n::detail_n::registry::instance() };
+    const std::lock_guard lock{ registry.mutex };
+    return registry.tables.size();
+  }
+
+  void testCountHitsAndMisses()
+  {
+    stats_n::reset();
+    const std::map< int, int > map{ { 1, 10 } };
+
+    const auto line{ std::source_location::current().line() + 2 };
+    for ( int key{ 0 }; key < 100; ++key )
+      select( map, key % 4 );
+
+    const auto sites{ stats_n::snapshot() };
+    const auto site{ find_site( sites, line ) };
+    assert( site != nullptr );
+    assert( site->operation == "select" );
+    assert( site->hits == 25 );
+    assert( site->misses == 75 );
+    assert( site->defaults == 0 );
+  }
+
+  void testCountDefaultsOnce()
+  {
+    stats_n::reset();
+    const std::map< int, int > map{ { 1, 10 } };
+    const int def{ -1 };
+
+    const auto line{ std::source_location::current().line() + 2 };
+    for ( int key{ 0 }; key < 10; ++key )
+      select_or_default( map, key, def );
+
+    const auto sites{ stats_n::snapshot() };
+    const auto site{ find_site( sites, line ) };
+    assert( site != nullptr );
+    assert( site->operation == "select_or_default" );
+    assert( site->hits == 1 );
+    assert( site->misses == 9 );
+    assert( site->defaults == 9 );
+
+    // The nested select is not recorded on its own.
+    for ( const auto &other : sites )
+      assert( &other == site || other.hits + other.misses == 0 );
+  }
+
+  void testCountSelectIfEach()
+  {
+    stats_n::reset();
+    const std::vector< int > vec{ 1, 2, 3 };
+
+    const auto matches{ []( const int expected ){ return [ expected ]( const int value ){ return value == expected; }; } };
+
+    // Calls with any number of predicates are recorded under a single site.
+    for ( int key{ 0 }; key < 4; ++key )
+      select_if_each( vec, matches( key ), matches( 1 ), matches( 2 ), matches( 3 ), matches( 1 ) );
+
+    const auto sites{ stats_n::snapshot() };
+    const auto site{ find_operation( sites, "select_if_each" ) };
+    assert( site != nullptr );
+    assert( site->hits == 3 );
+    assert( site->misses == 1 );
+
+    // The walk records no lookups of its own.
+    for ( const auto &other : sites )
+      assert( &other == site || other.hits + other.misses == 0 );
+  }
+
+  void testSelectIfEachResult()
+  {
+    // The instrumented function returns the plain tuple.
+    const std::vector< int > vec{ 1, 2, 3 };
+    const auto [ two, missing ]{ select_if_each( vec, []( const int value ){ return value == 2; }, []( const int value ){ return value == 4; } ) };
+    assert( two == &vec[ 1 ] );
+    assert( missing == nullptr );
+    assert( std::get< 0 >( select_if_each( vec, []( const int value ){ return value == 3; } ) ) == &vec[ 2 ] );
+    static_assert( std::is_same_v< decltype( select_if_each( vec, []( const int value ){ return value == 3; } ) ), std::tuple< const int * > > );
+  }
+
+  void testCountLayeredCalls()
+  {
+    stats_n::reset();
+    const std::map< int, int > overrides{ { 1, 10 } };
+    const std::map< int, int > defaults{ { 1, 1 }, { 2, 2 } };
+    const std::map< int, int > empty;
+    const int def{ -1 };
+
+    // Calls with any number of layers are recorded under a single site per function.
+    for ( int key{ 0 }; key < 4; ++key )
+    {
+      select_first( key, empty, overrides, empty, empty, defaults );
+      select_or_default_layered( key, def, empty, overrides, empty, empty, defaults );
+    }
+
+    const auto sites{ stats_n::snapshot() };
+    const auto first{ find_operation( sites, "select_first" ) };
+    assert( first != nullptr );
+    assert( first->hits == 2 );
+    assert( first->misses == 2 );
+
+    const auto layered{ find_operation( sites, "select_or_default_layered" ) };
+    assert( layered != nullptr );
+    assert( layered->hits == 2 );
+    assert( layered->defaults == 2 );
+
+    // The lookups of the layers are not recorded on their own.
+    for ( const auto &other : sites )
+      assert( &other == first || &other == layered || other.hits + other.misses == 0 );
+  }
+
+  void testLayeredResults()
+  {
+    // The instrumented functions return the plain pointer or reference.
+    const std::map< int, int > overrides{ { 1, 10 } };
+    const std::map< int, int > defaults{ { 1, 1 }, { 2, 2 } };
+    const int def{ -1 };
+    static_assert( std::is_same_v< decltype( select_first( 2, overrides, defaults ) ), const int * > );
+    assert( *select_first( 2, overrides, defaults ) == 2 );
+    assert( select_first( 3, overrides, defaults ) == nullptr );
+    auto &value{ select_or_default_layered( 1, def, overrides, defaults ) };
+    assert( &value == &overrides.at( 1 ) );
+    auto &fallback{ select_or_default_layered( 3, def, overrides, defaults ) };
+    assert( &fallback == &def );
+  }
+
+  void testCountPathCalls()
+  {
+    stats_n::reset();
+    using level_t = std::map< int, std::map< int, int > >;
+    const std::map< int, std::map< int, std::map< int, level_t > > > nested{ { 1, { { 1, { { 1, { { 1, { { 2, 12 } } } } } } } } } };
+    const int def{ -1 };
+
+    // Paths of any length are recorded under a single site per function.
+    for ( int key{ 0 }; key < 4; ++key )
+    {
+      select_path( nested, 1, 1, 1, 1, key );
+      select_path_or_default( nested, def, 1, 1, 1, 1, key );
+    }
+
+    const auto sites{ stats_n::snapshot() };
+    const auto path{ find_operation( sites, "select_path" ) };
+    assert( path != nullptr );
+    assert( path->hits == 1 );
+    assert( path->misses == 3 );
+
+    const auto path_or_default{ find_operation( sites, "select_path_or_default" ) };
+    assert( path_or_default != nullptr );
+    assert( path_or_default->hits == 1 );
+    assert( path_or_default->defaults == 3 );
+
+    // The lookups of the levels are not recorded on their own.
+    for ( const auto &other : sites )
+      assert( &other == path || &other == path_or_default || other.hits + other.misses == 0 );
+  }
+
+  void testPathResults()
+  {
+    // The instrumented functions return the plain pointer or reference.
+    const std::map< int, std::map< int, int > > nested{ { 1, { { 2, 12 } } } };
+    const int def{ -1 };
+    static_assert( std::is_same_v< decltype( select_path( nested, 1, 2 ) ), const int * > );
+    assert( *select_path( nested, 1, 2 ) == 12 );
+    auto &entry{ select_path_or_default( nested, def, 1, 2 ) };
+    assert( &entry == &nested.at( 1 ).at( 2 ) );
+    assert( select_path_or_default( nested, def, 2, 2 ) == -1 );
+  }
+
+  template< typename MAP >
+  void testCountBatchedCalls()
+  {
+    stats_n::reset();
+    MAP map;
+    for ( int key{ 0 }; key < 20; key += 2 )
+      map.try_emplace( key, key );
+    const int def{ -1 };
+    const std::vector< int > found{ 0, 2, 4 };
+    const std::vector< int > keys{ 0, 1, 2, 3 };
+    std::vector< const int * > pointers( keys.size() );
+    std::vector< int > values( keys.size() );
+
+    // Each call is recorded once at its call site, whichever way the container is searched.
+    const auto line{ std::source_location::current().line() + 3 };
+    for ( int call{ 0 }; call < 2; ++call )
+    {
+      select_many( map, call ? keys : found, pointers.begin() );
+      select_or_default_many( map, call ? keys : found, def, values.begin() );
+    }
+
+    const auto sites{ stats_n::snapshot() };
+    const auto many{ find_site( sites, line ) };
+    assert( many != nullptr );
+    assert( many->operation == "select_many" );
+    assert( many->hits == 1 );
+    assert( many->misses == 1 );
+
+    const auto many_or_default{ find_site( sites, line + 1 ) };
+    assert( many_or_default != nullptr );
+    assert( many_or_default->operation == "select_or_default_many" );
+    assert( many_or_default->hits == 1 );
+    assert( many_or_default->defaults == 1 );
+
+    // The single lookups are not recorded on their own.
+    for ( const auto &other : sites )
+      assert( &other == many || &other == many_or_default || other.hits + other.misses == 0 );
+  }
+
+  void testSampleLatency()
+  {
+    stats_n::reset();
+    const std::vector< int > vec{ 1, 2, 3 };
+
+    const auto line{ std::source_location::current().line() + 2 };
+    for ( int call{ 0 }; call < 10 * SELECT_N_STATS_SAMPLE_PERIOD; ++call )
+      select_if( vec, []( const int value ){ return value == 2; } );
+
+    const auto sites{ stats_n::snapshot() };
+    const auto site{ find_site( sites, line ) };
+    assert( site != nullptr );
+    assert( site->hits == 10 * SELECT_N_STATS_SAMPLE_PERIOD );
+    assert( site->samples == 10 );
+
+    std::uint64_t histogram_total{ 0 };
+    for ( const auto count : site->latency_histogram )
+      histogram_total += count;
+    assert( histogram_total == site->samples );
+  }
+
+  void testAggregateThreads()
+  {
+    stats_n::reset();
+    const std::map< int, int > map{ { 1, 10 } };
+
+    const auto running_tables{ running_tables_count() };
+    const auto line{ std::source_location::current().line() + 3 };
+    const auto work{ [ &map ] {
+      for ( int key{ 0 }; key < 1000; ++key )
+        select( map, 1 );
+    } };
+    {
+      std::jthread first{ work };
+      std::jthread second{ work };
+    }
+
+    const auto sites{ stats_n::snapshot() };
+    const auto site{ find_site( sites, line ) };
+    assert( site != nullptr );
+    assert( site->hits == 2000 );
+
+    std::ostringstream report;
+    stats_n::dump( report );
+    assert( report.str().find( "hits=2000" ) != std::string::npos );
+
+    // The finished threads left their counters, but not their tables.
+    assert( running_tables_count() == running_tables );
+  }
+
+  // Instrumentation does not interfere with constant evaluation.
+  constexpr bool selectAtCompileTime()
+  {
+    const int values[]{ 1, 2, 3 };
+    const std::array< int, 3 > arr{ 1, 2, 3 };
+    return select( arr, 2 ) == &arr[ 1 ] && values[ 0 ] == 1;
+  }
+  static_assert( selectAtCompileTime() );
+}
+
+int main()
+{
+  testCountHitsAndMisses();
+  testCountDefaultsOnce();
+  testCountSelectIfEach();
+  testSelectIfEachResult();
+  testCountLayeredCalls();
+  testLayeredResults();
+  testCountPathCalls();
+  testPathResults();
+  testCountBatchedCalls< std::map< int, int > >();
+  testCountBatchedCalls< std::unordered_map< int, int > >();
+  testCountBatchedCalls< flat_map< int, int > >();
+  testSampleLatency();
+  testAggregateThreads();
+}
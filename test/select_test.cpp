@@ -1,5 +1,14 @@
 #include <cassert>
-
+#include <array>
+#include <map>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "key_hash.h"
 #include "select.h"
 #include "select_util.h"
 #include "test_util.h"
@@ -10,6 +19,9 @@ namespace
 {
   using entry_t = test_n::test_map_entry;
 
+  using test_n::long_key;
+  using test_n::long_missing;
+
   void testSelectFromConstantMap()
   {
     const auto map{ test_n::make_test_map() };
@@ -101,6 +113,85 @@ namespace
     assert( missing == nullptr );
     assert( test_n::Tracer::log().empty() );
   }
+
+  //! Search \c values for \c value in constant evaluation, returning the index of the match or \c -1 .
+  template< std::size_t N >
+  constexpr int constant_index( const std::array< int, N > &values, const int value )
+  {
+    const auto entry{ select( values, value ) };
+    return entry ? static_cast< int >( entry - values.data() ) : -1;
+  }
+
+  void testSelectFromFixedArray()
+  {
+    static_assert( detail_n::Unrollable< const std::array< int, 4 >, int > );
+    static_assert( detail_n::Unrollable< std::span< const char, SELECT_N_UNROLL_LIMIT >, char > );
+    static_assert( !detail_n::Unrollable< std::span< int >, int > );
+    static_assert( !detail_n::Unrollable< std::array< int, SELECT_N_UNROLL_LIMIT + 1 >, int > );
+    static_assert( !detail_n::Unrollable< std::array< std::string, 4 >, std::string > );
+
+    static_assert( constant_index( std::array{ 3, 1, 4, 1, 5 }, 1 ) == 1 );
+    static_assert( constant_index( std::array{ 3, 1, 4, 1, 5 }, 5 ) == 4 );
+    static_assert( constant_index( std::array{ 3, 1, 4, 1, 5 }, 2 ) == -1 );
+
+    std::array< int, SELECT_N_UNROLL_LIMIT > values{};
+    for ( std::size_t index{ 0 }; index < values.size(); ++index )
+      values[ index ] = static_cast< int >( index * 3 );
+    const auto &constant{ values };
+
+    for ( std::size_t index{ 0 }; index < values.size(); ++index )
+    {
+      assert( select( values, static_cast< int >( index * 3 ) ) == &values[ index ] );
+      assert( select( constant, static_cast< int >( index * 3 ) ) == &values[ index ] );
+      assert( select( values, static_cast< int >( index * 3 + 1 ) ) == nullptr );
+    }
+    assert( ( std::is_same_v< decltype( select( values, 0 ) ), int * > ) );
+    assert( ( std::is_same_v< decltype( select( constant, 0 ) ), const int * > ) );
+
+    const std::span< int, 4 > fixed{ values.data(), 4 };
+    const std::span< int > dynamic{ values };
+    assert( select( fixed, 9 ) == &values[ 3 ] );
+    assert( select( fixed, 12 ) == nullptr );
+    assert( ( std::is_same_v< decltype( select( fixed, 9 ) ), int * > ) );
+    assert( select( dynamic, 9 ) == &values[ 3 ] );
+
+    const std::array< const char *, 3 > names{ long_key.data(), nullptr, long_missing.data() };
+    assert( select( names, nullptr ) == &names[ 1 ] );
+    assert( select( names, long_missing.data() ) == &names[ 2 ] );
+  }
+
+  void testTransparentLookupDoesNotAllocate()
+  {
+    const std::map< std::string, int, std::less<> > map{ { std::string{ long_key }, 1 } };
+    const std::set< std::string, std::less<> > set{ std::string{ long_key } };
+    const std::unordered_map< std::string, int, key_hash< std::string >, std::equal_to<> > hashed{ { std::string{ long_key }, 1 } };
+    const std::vector< std::string > vec{ std::string{ long_key } };
+    const char *c_string{ long_key.data() };
+    const test_n::AllocationCounter counter;
+
+    assert( select( map, long_key ) == &map.begin()->second );
+    assert( select( map, c_string ) == &map.begin()->second );
+    assert( select( map, "a key longer than any small string buffer" ) == &map.begin()->second );
+    assert( select( map, long_missing ) == nullptr );
+    assert( select( set, long_key ) == &*set.begin() );
+    assert( select( set, long_missing ) == nullptr );
+    assert( select( hashed, long_key ) == &hashed.begin()->second );
+    assert( select( hashed, long_missing ) == nullptr );
+    assert( select( vec, long_key ) == &vec.front() );
+    assert( select( vec, c_string ) == &vec.front() );
+    assert( select( vec, long_missing ) == nullptr );
+    assert( counter.allocations() == 0 );
+  }
+
+  void testOpaqueLookupAllocates()
+  {
+    // No transparent comparator -> the key is converted to a temporary std::string.
+    const std::map< std::string, int > map{ { std::string{ long_key }, 1 } };
+    const test_n::AllocationCounter counter;
+
+    assert( select( map, long_key.data() ) != nullptr );
+    assert( counter.allocations() > 0 );
+  }
 }
 
 int main()
@@ -113,4 +204,8 @@ int main()
 
   testSelectFromConstantVector();
   testSelectFromMutableVector();
+  testSelectFromFixedArray();
+
+  testTransparentLookupDoesNotAllocate();
+  testOpaqueLookupAllocates();
 }
@@ -0,0 +1,293 @@
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "select.h"
+#include "select_if.h"
+#include "select_or_default.h"
+#include "small_map.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using test_n::Tracer;
+  using entry_t = test_n::test_map_entry;
+
+  struct test_map_hash
+  {
+    std::size_t operator()( const entry_t key ) const noexcept { return static_cast< std::size_t >( key ); }
+  };
+
+  using test_small_map_t = small_map< entry_t, Tracer, 4, test_map_hash >;
+
+  test_small_map_t make_test_small_map()
+  {
+    Tracer::Silencer silencer;
+    return { { entry_t::EXISTING, {} } };
+  }
+
+  void testSelectFromConstantSmallMap()
+  {
+    const auto map{ make_test_small_map() };
+    Tracer::clear_log();
+
+    auto existing{ select( map, entry_t::EXISTING ) };
+    auto missing{ select( map, entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer * > ) );
+    assert( existing == &map.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultFromMutableSmallMap()
+  {
+    auto map{ make_test_small_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default( map, entry_t::EXISTING, def ) };
+    auto &missing{ select_or_default( map, entry_t::MISSING, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSmallMapDoesNotAllocate()
+  {
+    const std::string def{ "default" };
+    const test_n::AllocationCounter counter;
+
+    small_map< int, int > numbers;
+    small_map< std::string_view, std::string_view > words;
+    for ( int i{ 0 }; i < 16; ++i )
+      numbers.try_emplace( i, i * i );
+    words.try_emplace( "one", "1" );
+    words.try_emplace( "two", "2" );
+
+    assert( !numbers.hashed() );
+    assert( *select( numbers, 7 ) == 49 );
+    assert( select( numbers, 16 ) == nullptr );
+    assert( select( numbers, 7L ) != nullptr );
+    assert( select_or_default( numbers, 100, -1 ) == -1 );
+    assert( select( words, std::string_view{ "two" } ) != nullptr );
+    assert( select_or_default( words, std::string_view{ "three" }, std::string_view{ def } ) == def );
+    assert( counter.allocations() == 0 );
+  }
+
+  void testMigrationToHashIndex()
+  {
+    small_map< int, int, 8 > map;
+    for ( int i{ 0 }; i < 8; ++i )
+      map.try_emplace( i, -i );
+    assert( !map.hashed() );
+
+    for ( int i{ 8 }; i < 1000; ++i )
+      assert( map.try_emplace( i, -i ).second );
+    assert( map.hashed() );
+    assert( map.size() == 1000 );
+    assert( !map.try_emplace( 500, 0 ).second );
+
+    for ( int i{ 0 }; i < 1000; ++i )
+      assert( map.at( i ) == -i );
+    assert( select( map, 1000 ) == nullptr );
+    assert( select( map, -1 ) == nullptr );
+    const auto values{ map.values() };
+    assert( *select_if( values, []( const int value ){ return value == -999; } ) == -999 );
+  }
+
+  //! String hash failing on demand, e.g. while the map migrates its entries.
+  struct failing_hash
+  {
+    static inline bool fail{ false };
+
+    std::size_t operator()( const std::string_view key ) const
+    {
+      if ( fail )
+        throw std::runtime_error{ "hash failed" };
+      return std::hash< std::string_view >{}( key );
+    }
+  };
+
+  void testFailedMigrationKeepsEntries()
+  {
+    // Longer than any small string buffer, so moving out of the inline entries would leave them empty.
+    const std::string value{ test_n::long_key };
+    small_map< std::string, std::string, 4, failing_hash > map;
+    for ( int i{ 0 }; i < 4; ++i )
+      map.try_emplace( value + std::to_string( i ), value );
+
+    failing_hash::fail = true;
+    bool thrown{ false };
+    try
+    {
+      map.try_emplace( "fifth", "value" );
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    failing_hash::fail = false;
+
+    assert( thrown );
+    assert( !map.hashed() );
+    assert( map.size() == 4 );
+    for ( int i{ 0 }; i < 4; ++i )
+      assert( *select( map, value + std::to_string( i ) ) == value );
+
+    assert( map.try_emplace( "fifth", "value" ).second );
+    assert( map.hashed() );
+    assert( *select( map, value + "3" ) == value );
+  }
+
+  //! String hash failing once the given number of calls succeeded, or never if negative.
+  struct countdown_hash
+  {
+    static inline int calls_left{ -1 };
+
+    std::size_t operator()( const std::string_view key ) const
+    {
+      if ( calls_left == 0 )
+        throw std::runtime_error{ "hash failed" };
+      if ( calls_left > 0 )
+        --calls_left;
+      return std::hash< std::string_view >{}( key );
+    }
+  };
+
+  void testFailedEraseKeepsEntries()
+  {
+    small_map< std::string, int, 4, countdown_hash > map;
+    for ( int i{ 0 }; i < 20; ++i )
+      map[ std::to_string( i ) ] = i;
+    assert( map.hashed() );
+
+    // Find the erased key, then fail hashing the last entry, which would move into the gap.
+    countdown_hash::calls_left = 1;
+    bool thrown{ false };
+    try
+    {
+      map.erase( std::string{ "0" } );
+    }
+    catch ( const std::runtime_error & )
+    {
+      thrown = true;
+    }
+    countdown_hash::calls_left = -1;
+
+    assert( thrown );
+    assert( map.size() == 20 );
+    for ( int i{ 0 }; i < 20; ++i )
+      assert( map.at( std::to_string( i ) ) == i );
+
+    assert( map.erase( std::string{ "0" } ) == 1 );
+    assert( !map.contains( std::string{ "0" } ) );
+    assert( map.at( "19" ) == 19 );
+    assert( map.try_emplace( "0", 0 ).second );
+    assert( map.size() == 20 );
+  }
+
+  void testEraseMovesLastEntry()
+  {
+    for ( const int count : { 6, 300 } )
+    {
+      small_map< std::string, int, 6 > map;
+      for ( int i{ 0 }; i < count; ++i )
+        map[ std::to_string( i ) ] = i;
+
+      for ( int i{ 0 }; i < count; i += 3 )
+        assert( map.erase( std::to_string( i ) ) == 1 );
+      assert( map.erase( std::string{ "0" } ) == 0 );
+
+      assert( map.size() == static_cast< std::size_t >( count - ( count + 2 ) / 3 ) );
+      for ( int i{ 0 }; i < count; ++i )
+        assert( map.contains( std::to_string( i ) ) == ( i % 3 != 0 ) );
+      for ( const auto &entry : map )
+        assert( entry.first == std::to_string( entry.second ) );
+    }
+  }
+
+  void testHeterogeneousLookup()
+  {
+    small_map< std::string, int, 2 > map{ { "a", 1 }, { "b", 2 } };
+    assert( *select( map, "a" ) == 1 );
+    assert( *select( map, std::string_view{ "b" } ) == 2 );
+
+    map.try_emplace( "c", 3 );
+    assert( map.hashed() );
+    assert( *select( map, "c" ) == 3 );
+    assert( select( map, "d" ) == nullptr );
+  }
+
+  void testInsertOrAssign()
+  {
+    small_map< int, std::string, 2 > map;
+    assert( map.insert_or_assign( 1, "a" ).second );
+    assert( !map.insert_or_assign( 1, "b" ).second );
+    assert( map.at( 1 ) == "b" );
+
+    map.insert_or_assign( 2, "c" );
+    map.insert_or_assign( 3, "d" );
+    assert( !map.insert_or_assign( 3, "e" ).second );
+    assert( map.at( 3 ) == "e" );
+  }
+
+  void testCopyAndMove()
+  {
+    for ( const int count : { 3, 50 } )
+    {
+      small_map< int, std::string, 4 > map;
+      for ( int i{ 0 }; i < count; ++i )
+        map.try_emplace( i, std::to_string( i ) );
+
+      auto copy{ map };
+      assert( copy.size() == map.size() );
+      assert( copy.at( count - 1 ) == std::to_string( count - 1 ) );
+
+      auto moved{ std::move( map ) };
+      assert( moved.size() == static_cast< std::size_t >( count ) );
+      assert( moved.at( 0 ) == "0" );
+      assert( map.empty() );
+
+      map = moved;
+      assert( map.size() == moved.size() );
+      copy = std::move( moved );
+      assert( copy.at( count - 1 ) == std::to_string( count - 1 ) );
+    }
+  }
+
+  void testClearStartsOverInline()
+  {
+    small_map< int, int, 4 > map{ { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 4 }, { 5, 5 } };
+    assert( map.hashed() );
+
+    map.clear();
+    assert( map.empty() );
+    assert( !map.hashed() );
+
+    map.try_emplace( 6, 6 );
+    assert( !map.hashed() );
+    assert( map.at( 6 ) == 6 );
+  }
+}
+
+int main()
+{
+  testSelectFromConstantSmallMap();
+  testSelectOrDefaultFromMutableSmallMap();
+  testSmallMapDoesNotAllocate();
+  testMigrationToHashIndex();
+  testFailedMigrationKeepsEntries();
+  testFailedEraseKeepsEntries();
+  testEraseMovesLastEntry();
+  testHeterogeneousLookup();
+  testInsertOrAssign();
+  testCopyAndMove();
+  testClearStartsOverInline();
+}
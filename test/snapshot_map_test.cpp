@@ -0,0 +1,221 @@
+#include <atomic>
+#include <cassert>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "select.h"
+#include "select_or_default.h"
+#include "snapshot_map.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using config_t = std::map< std::string, int, std::less<> >;
+
+  void reclaim()
+  {
+    for ( int round{ 0 }; round < 4; ++round )
+      detail_n::epoch_domain::instance().reclaim();
+  }
+
+  void testSelectFromSnapshotMap()
+  {
+    const snapshot_map< config_t > map{ { { "timeout", 30 } } };
+
+    auto existing{ select( map, "timeout" ) };
+    auto missing{ select( map, "retries" ) };
+
+    assert( ( std::is_same_v< decltype( existing ), select_handle< const int, detail_n::epoch_guard > > ) );
+    assert( existing && *existing == 30 );
+    assert( !missing );
+
+    assert( ( !std::is_reference_v< decltype( select_or_default( map, "timeout", 0 ) ) > ) );
+    assert( select_or_default( map, "timeout", 0 ) == 30 );
+    assert( select_or_default( map, "retries", 3 ) == 3 );
+  }
+
+  void testSelectFromSnapshot()
+  {
+    snapshot_map< config_t > map{ { { "timeout", 30 } } };
+    const int def{ 0 };
+
+    const auto snapshot{ map.load() };
+    map.update( []( config_t &config ){ config[ "timeout" ] = 60; } );
+    reclaim();
+
+    // The snapshot still sees its version.
+    auto &existing{ select_or_default( snapshot, "timeout", def ) };
+    assert( ( std::is_same_v< decltype( existing ), const int & > ) );
+    assert( existing == 30 );
+    assert( select( snapshot, "retries" ) == nullptr );
+    assert( snapshot.version() == 0 );
+
+    assert( *select( map, "timeout" ) == 60 );
+    assert( map.version() == 1 );
+  }
+
+  void testStoreReplacesVersion()
+  {
+    snapshot_map< config_t > map;
+    assert( map.load()->empty() );
+
+    map.store( { { "retries", 3 } } );
+    assert( map.load().size() == 1 );
+    assert( *select( map, "retries" ) == 3 );
+    assert( map.version() == 1 );
+  }
+
+  //! Map counting its live instances.
+  struct counted_map : config_t
+  {
+    static inline int live{ 0 };
+
+    counted_map() { ++live; }
+    counted_map( const counted_map &other ) : config_t{ other } { ++live; }
+    counted_map( counted_map &&other ) noexcept : config_t{ std::move( other ) } { ++live; }
+    counted_map &operator=( const counted_map & ) = default;
+    ~counted_map() { --live; }
+  };
+
+  void testPublishReclaimsOldVersions()
+  {
+    {
+      snapshot_map< counted_map > map;
+      for ( int value{ 0 }; value < 10; ++value )
+      {
+        map.update( [ value ]( counted_map &config ){ config[ "value" ] = value; } );
+        // Without readers, the replaced version is gone right away.
+        assert( counted_map::live == 1 );
+      }
+
+      {
+        const auto snapshot{ map.load() };
+        map.update( []( counted_map &config ){ config[ "value" ] = -1; } );
+        assert( counted_map::live == 2 );
+        assert( snapshot->at( "value" ) == 9 );
+      }
+
+      // The version held by the snapshot is only reclaimed by the next publication.
+      assert( counted_map::live == 2 );
+      map.update( []( counted_map &config ){ config[ "value" ] = -2; } );
+      assert( counted_map::live == 1 );
+    }
+    reclaim();
+    assert( counted_map::live == 0 );
+  }
+
+  void testPublishReclaimsVersionsOfOtherWriters()
+  {
+    {
+      snapshot_map< counted_map > map;
+      std::atomic< int > step{ 0 };
+      const auto await{ [ &step ]( const int expected ){ while ( step.load() != expected ) std::this_thread::yield(); } };
+
+      // The first writer stays alive, so the version it replaced is not handed over by its exit.
+      std::jthread first{ [ & ]
+      {
+        await( 1 );
+        map.update( []( counted_map &config ){ config[ "value" ] = 1; } );
+        step = 2;
+        await( 3 );
+      } };
+
+      {
+        const auto snapshot{ map.load() };
+        step = 1;
+        await( 2 );
+        assert( counted_map::live == 2 );
+      }
+
+      // Another writer's publication reclaims the version replaced by the first one.
+      std::jthread{ [ & ] { map.update( []( counted_map &config ){ config[ "value" ] = 2; } ); } }.join();
+      assert( counted_map::live == 1 );
+      step = 3;
+    }
+    reclaim();
+    assert( counted_map::live == 0 );
+  }
+
+  /*!
+    \brief Run \c operation on a new thread, letting its allocation after \c failing others throw \c std::bad_alloc .
+
+    Unless an exited thread left an epoch record to reuse, a new thread allocates one, too.
+    Returns whether \c operation completed.
+  */
+  template< typename OPERATION >
+  bool completesFailingAllocation( const std::size_t failing, const OPERATION &operation )
+  {
+    bool completed{ false };
+    std::thread{ [ & ] {
+      test_n::AllocationCounter counter;
+      counter.fail_after( failing );
+      try
+      {
+        operation();
+        completed = true;
+      }
+      catch ( const std::bad_alloc & ) {}
+    } }.join();
+    return completed;
+  }
+
+  void testFailedAllocationPublishesNothing()
+  {
+    snapshot_map< std::map< int, int > > map{ { { 1, 1 } } };
+
+    // Fail each allocation in turn, until none is left to fail. A failed update must not be live, or a retry would apply it twice.
+    std::size_t failing{ 0 };
+    for ( ; !completesFailingAllocation( failing, [ &map ] { map.update( []( std::map< int, int > &config ){ config[ 1 ] += 1; } ); } ); ++failing )
+    {
+      assert( map.version() == 0 );
+      assert( select_or_default( map, 1, -1 ) == 1 );
+    }
+    // Copying the map, and publishing the copy allocate.
+    assert( failing > 0 );
+    assert( map.version() == 1 );
+    assert( select_or_default( map, 1, -1 ) == 2 );
+  }
+
+  void testConcurrentReadersAndWriter()
+  {
+    snapshot_map< config_t > map{ { { "a", 0 }, { "b", 0 } } };
+    std::atomic< bool > stop{ false };
+    {
+      std::vector< std::jthread > readers;
+      for ( int reader{ 0 }; reader < 4; ++reader )
+        readers.emplace_back( [ & ]
+        {
+          while ( !stop.load( std::memory_order_relaxed ) )
+          {
+            // Both entries are updated together, so a snapshot sees them equal.
+            const auto snapshot{ map.load() };
+            assert( *select( snapshot, "a" ) == *select( snapshot, "b" ) );
+            assert( *select( snapshot, "a" ) == static_cast< int >( snapshot.version() ) );
+          }
+        } );
+
+      for ( int round{ 1 }; round <= 1000; ++round )
+        map.update( [ round ]( config_t &config ){ config[ "a" ] = config[ "b" ] = round; } );
+      stop = true;
+    }
+
+    assert( *select( map, "a" ) == 1000 );
+  }
+}
+
+int main()
+{
+  testSelectFromSnapshotMap();
+  testSelectFromSnapshot();
+  testStoreReplacesVersion();
+  testPublishReclaimsOldVersions();
+  // Before any other thread used the epoch domain, so the writer has to allocate a new record.
+  testFailedAllocationPublishesNothing();
+  testPublishReclaimsVersionsOfOtherWriters();
+  testConcurrentReadersAndWriter();
+}
@@ -0,0 +1,270 @@
+#include <cassert>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "select.h"
+#include "select_or_default.h"
+#include "small_map.h"
+#include "swiss_map.h"
+#include "test_util.h"
+
+using namespace select_n;
+
+namespace
+{
+  using test_n::Tracer;
+  using entry_t = test_n::test_map_entry;
+  using test_swiss_map_t = swiss_map< entry_t, Tracer >;
+
+  //! Hashes all keys alike, so every lookup probes the same groups.
+  struct colliding_hash
+  {
+    std::size_t operator()( int ) const noexcept { return 42; }
+  };
+
+  test_swiss_map_t make_test_swiss_map()
+  {
+    Tracer::Silencer silencer;
+    return { { entry_t::EXISTING, {} } };
+  }
+
+  void testSelectFromConstantSwissMap()
+  {
+    const auto map{ make_test_swiss_map() };
+    Tracer::clear_log();
+
+    auto existing{ select( map, entry_t::EXISTING ) };
+    auto missing{ select( map, entry_t::MISSING ) };
+
+    assert( ( std::is_same_v< decltype( existing ), const Tracer * > ) );
+    assert( existing == &map.at( entry_t::EXISTING ) );
+    assert( missing == nullptr );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectOrDefaultFromMutableSwissMap()
+  {
+    auto map{ make_test_swiss_map() };
+    auto def{ test_n::make_test_tracer() };
+    Tracer::clear_log();
+
+    auto &existing{ select_or_default( map, entry_t::EXISTING, def ) };
+    auto &missing{ select_or_default( map, entry_t::MISSING, def ) };
+
+    assert( ( std::is_same_v< decltype( existing ), Tracer & > ) );
+    assert( &existing == &map.at( entry_t::EXISTING ) );
+    assert( &missing == &def );
+    assert( Tracer::log().empty() );
+  }
+
+  void testSelectFromEmptySwissMap()
+  {
+    const swiss_map< int, int > map;
+    assert( select( map, 1 ) == nullptr );
+    assert( map.begin() == map.end() );
+  }
+
+  void testInsertEraseAndGrow()
+  {
+    swiss_map< int, int > map;
+    for ( int i{ 0 }; i < 10000; ++i )
+      assert( map.try_emplace( i, 2 * i ).second );
+    assert( map.size() == 10000 );
+    assert( !map.try_emplace( 17, 0 ).second );
+
+    for ( int i{ 0 }; i < 10000; i += 2 )
+      assert( map.erase( i ) == 1 );
+    assert( map.erase( 0 ) == 0 );
+    assert( map.size() == 5000 );
+
+    for ( int i{ 0 }; i < 10000; ++i )
+      assert( ( select( map, i ) != nullptr ) == ( i % 2 == 1 ) );
+
+    std::size_t count{ 0 };
+    for ( const auto &entry : map )
+    {
+      assert( entry.second == 2 * entry.first );
+      ++count;
+    }
+    assert( count == map.size() );
+  }
+
+  void testDeletedSlotsAreReused()
+  {
+    swiss_map< int, int > map;
+    map.reserve( 100 );
+    const auto capacity{ map.capacity() };
+    for ( int round{ 0 }; round < 100; ++round )
+    {
+      for ( int i{ 0 }; i < 50; ++i )
+        map[ round * 50 + i ] = i;
+      for ( int i{ 0 }; i < 50; ++i )
+        map.erase( round * 50 + i );
+    }
+    assert( map.empty() );
+    assert( map.capacity() == capacity );
+  }
+
+  void testCollidingHashes()
+  {
+    swiss_map< int, int, colliding_hash > map;
+    for ( int i{ 0 }; i < 100; ++i )
+      map.try_emplace( i, i );
+    for ( int i{ 0 }; i < 100; i += 3 )
+      map.erase( i );
+
+    for ( int i{ 0 }; i < 100; ++i )
+      assert( ( select( map, i ) != nullptr ) == ( i % 3 != 0 ) );
+    assert( select( map, 100 ) == nullptr );
+  }
+
+  void testHeterogeneousLookup()
+  {
+    swiss_map< std::string, int > map{ { "alpha", 1 }, { "beta", 2 } };
+    const std::string_view beta{ "beta" };
+
+    assert( *select( map, beta ) == 2 );
+    assert( *select( map, "alpha" ) == 1 );
+    assert( select( map, std::string_view{ "gamma" } ) == nullptr );
+    assert( map.hash( beta ) == map.hash( std::string{ beta } ) );
+
+    using test_n::long_key;
+    map.try_emplace( std::string{ long_key }, 3 );
+    const test_n::AllocationCounter counter;
+    assert( *select( map, long_key ) == 3 );
+    assert( *select( map, long_key.data() ) == 3 );
+    assert( select( map, long_key.substr( 1 ) ) == nullptr );
+    assert( counter.allocations() == 0 );
+  }
+
+  void testSelectHashedAcrossMaps()
+  {
+    swiss_map< std::string, int > tenant{ { "timeout", 5 } };
+    small_map< std::string, int, 2 > overlay{ { "retries", 3 } };
+    small_map< std::string, int, 2 > hashed_overlay{ { "a", 0 }, { "b", 0 }, { "retries", 4 } };
+    const std::map< std::string, int, std::less<> > defaults{ { "timeout", 30 }, { "retries", 1 } };
+    assert( hashed_overlay.hashed() );
+
+    const std::string_view key{ "retries" };
+    const auto hash{ key_hash< std::string >{}( key ) };
+
+    assert( select_hashed( tenant, key, hash ) == nullptr );
+    assert( *select_hashed( overlay, key, hash ) == 3 );
+    assert( *select_hashed( hashed_overlay, key, hash ) == 4 );
+    assert( *select_hashed( defaults, key, hash ) == 1 );
+
+    assert( select_or_default_hashed( tenant, key, hash, 0 ) == 0 );
+    assert( select_or_default_hashed( hashed_overlay, key, hash, 0 ) == 4 );
+    assert( &select_or_default_hashed( tenant, std::string_view{ "timeout" }, tenant.hash( std::string_view{ "timeout" } ), defaults.at( "timeout" ) ) == &tenant.at( "timeout" ) );
+  }
+
+  //! Value, which can only be copied, and throws on the copy after \c budget ones.
+  struct ThrowingCopy
+  {
+    explicit ThrowingCopy( const int value ) : value{ value } {}
+    ThrowingCopy( const ThrowingCopy &other ) : value{ other.value }
+    {
+      if ( budget-- == 0 )
+        throw std::runtime_error{ "copy" };
+    }
+    ThrowingCopy &operator=( const ThrowingCopy & ) = default;
+
+    int value;
+    static inline int budget{ -1 };
+  };
+
+  //! Hash, which throws after \c budget calls.
+  struct ThrowingHash
+  {
+    std::size_t operator()( const int key ) const
+    {
+      if ( budget-- == 0 )
+        throw std::runtime_error{ "hash" };
+      return static_cast< std::size_t >( key );
+    }
+    static inline int budget{ -1 };
+  };
+
+  void testFailedRehashKeepsEntries()
+  {
+    // std::string moves without throwing, but the value has to be copied -> copy the key, too.
+    static_assert( std::is_nothrow_move_constructible_v< std::string > && !std::is_nothrow_move_constructible_v< ThrowingCopy > );
+    swiss_map< std::string, ThrowingCopy > copied;
+    copied.reserve( 8 );
+    for ( int key{ 0 }; key < 8; ++key )
+      copied.try_emplace( std::string{ test_n::long_key } + std::to_string( key ), key );
+    ThrowingCopy::budget = 3;
+    try
+    {
+      copied.reserve( 4 * copied.capacity() );
+      assert( false );
+    }
+    catch ( const std::runtime_error & )
+    {
+      ThrowingCopy::budget = -1;
+      assert( copied.size() == 8 );
+      for ( int key{ 0 }; key < 8; ++key )
+        assert( copied.at( std::string{ test_n::long_key } + std::to_string( key ) ).value == key );
+    }
+
+    // Entries are moved -> a throwing hash must not leave some of them moved-from.
+    swiss_map< int, int, ThrowingHash > moved;
+    moved.reserve( 8 );
+    for ( int key{ 0 }; key < 8; ++key )
+      moved.try_emplace( key, key );
+    ThrowingHash::budget = 3;
+    try
+    {
+      moved.reserve( 4 * moved.capacity() );
+      assert( false );
+    }
+    catch ( const std::runtime_error & )
+    {
+      ThrowingHash::budget = -1;
+      assert( moved.size() == 8 );
+      for ( int key{ 0 }; key < 8; ++key )
+        assert( moved.at( key ) == key );
+    }
+  }
+
+  void testCopyAndMove()
+  {
+    swiss_map< int, std::string > map;
+    for ( int i{ 0 }; i < 100; ++i )
+      map.try_emplace( i, std::to_string( i ) );
+    map.erase( 50 );
+
+    auto copy{ map };
+    assert( copy.size() == 99 );
+    assert( copy.at( 99 ) == "99" );
+    assert( select( copy, 50 ) == nullptr );
+
+    auto moved{ std::move( map ) };
+    assert( moved.size() == 99 );
+    assert( map.empty() );
+    assert( select( map, 1 ) == nullptr );
+
+    map = moved;
+    assert( map.at( 1 ) == "1" );
+    map.clear();
+    assert( map.empty() );
+    assert( select( map, 1 ) == nullptr );
+  }
+}
+
+int main()
+{
+  testSelectFromConstantSwissMap();
+  testSelectOrDefaultFromMutableSwissMap();
+  testSelectFromEmptySwissMap();
+  testInsertEraseAndGrow();
+  testDeletedSlotsAreReused();
+  testCollidingHashes();
+  testHeterogeneousLookup();
+  testSelectHashedAcrossMaps();
+  testCopyAndMove();
+  testFailedRehashKeepsEntries();
+}
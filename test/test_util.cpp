@@ -1,5 +1,9 @@
 #include "test_util.h"
+#include <algorithm>
+#include <atomic>
 #include <compare>
+#include <cstdlib>
+#include <new>
 
 using namespace select_n::test_n;
 
@@ -69,6 +73,66 @@ Tracer::log_t Tracer::_log{};
 Tracer::Silencer::Silencer() noexcept { record_log = false; }
 Tracer::Silencer::~Silencer() noexcept { record_log = true; }
 
+namespace
+{
+  constexpr std::size_t no_failure{ static_cast< std::size_t >( -1 ) };
+
+  std::atomic< std::size_t > allocation_count{ 0 };
+  //! Number of the allocation to fail.
+  std::atomic< std::size_t > failing_allocation{ no_failure };
+
+  void *allocate( const std::size_t size, const std::size_t alignment )
+  {
+    if ( auto number{ allocation_count.fetch_add( 1, std::memory_order_relaxed ) };
+         number == failing_allocation.load( std::memory_order_relaxed ) && failing_allocation.compare_exchange_strong( number, no_failure ) )
+      throw std::bad_alloc{};
+
+    // Aligned allocation requires a size multiple of the alignment.
+    const auto rounded{ ( std::max< std::size_t >( size, 1 ) + alignment - 1 ) / alignment * alignment };
+    if ( auto *memory{ alignment > alignof( std::max_align_t ) ? std::aligned_alloc( alignment, rounded ) : std::malloc( rounded ) } )
+      return memory;
+    else
+      throw std::bad_alloc{};
+  }
+}
+
+void *operator new( const std::size_t size ) { return allocate( size, alignof( std::max_align_t ) ); }
+void *operator new( const std::size_t size, const std::align_val_t alignment ) { return allocate( size, static_cast< std::size_t >( alignment ) ); }
+void *operator new[]( const std::size_t size ) { return operator new( size ); }
+void *operator new[]( const std::size_t size, const std::align_val_t alignment ) { return operator new( size, alignment ); }
+void *operator new( const std::size_t size, const std::nothrow_t & ) noexcept
+{
+  try { return operator new( size ); }
+  catch ( const std::bad_alloc & ) { return nullptr; }
+}
+void *operator new( const std::size_t size, const std::align_val_t alignment, const std::nothrow_t & ) noexcept
+{
+  try { return operator new( size, alignment ); }
+  catch ( const std::bad_alloc & ) { return nullptr; }
+}
+void *operator new[]( const std::size_t size, const std::nothrow_t &tag ) noexcept { return operator new( size, tag ); }
+void *operator new[]( const std::size_t size, const std::align_val_t alignment, const std::nothrow_t &tag ) noexcept { return operator new( size, alignment, tag ); }
+void operator delete( void *memory ) noexcept { std::free( memory ); }
+void operator delete( void *memory, const std::nothrow_t & ) noexcept { std::free( memory ); }
+void operator delete( void *memory, std::align_val_t, const std::nothrow_t & ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory, const std::nothrow_t & ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory, std::align_val_t, const std::nothrow_t & ) noexcept { std::free( memory ); }
+void operator delete( void *memory, std::align_val_t ) noexcept { std::free( memory ); }
+void operator delete( void *memory, std::size_t ) noexcept { std::free( memory ); }
+void operator delete( void *memory, std::size_t, std::align_val_t ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory, std::align_val_t ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory, std::size_t ) noexcept { std::free( memory ); }
+void operator delete[]( void *memory, std::size_t, std::align_val_t ) noexcept { std::free( memory ); }
+
+AllocationCounter::AllocationCounter() noexcept : _start{ allocation_count.load( std::memory_order_relaxed ) } {}
+
+AllocationCounter::~AllocationCounter() { failing_allocation.store( no_failure ); }
+
+std::size_t AllocationCounter::allocations() const noexcept { return allocation_count.load( std::memory_order_relaxed ) - _start; }
+
+void AllocationCounter::fail_after( const std::size_t allocations ) noexcept { failing_allocation.store( allocation_count.load( std::memory_order_relaxed ) + allocations ); }
+
 Tracer select_n::test_n::make_test_tracer() noexcept
 {
   Tracer::Silencer silencer;
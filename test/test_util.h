@@ -1,9 +1,11 @@
 #pragma once
 
 #include <compare>
+#include <cstddef>
 #include <map>
 #include <ostream>
 #include <set>
+#include <string_view>
 #include <vector>
 
 namespace select_n::test_n
@@ -67,6 +69,36 @@ namespace select_n::test_n
     static log_t _log;
   };
 
+  /*!
+    \brief Counts the heap allocations by \c operator \c new , while it exists.
+
+    The global allocation functions of the test programs are replaced, so all allocations of all threads are counted.
+    A counter can also make an allocation fail, to test the handling of \c std::bad_alloc .
+  */
+  class AllocationCounter
+  {
+  public:
+    AllocationCounter() noexcept;
+    ~AllocationCounter();
+
+    AllocationCounter( const AllocationCounter & ) = delete;
+    AllocationCounter &operator=( const AllocationCounter & ) = delete;
+
+    //! Number of allocations since construction.
+    std::size_t allocations() const noexcept;
+
+    //! Let the allocation after the next \c allocations ones throw \c std::bad_alloc , unless the counter is destroyed before.
+    void fail_after( std::size_t allocations ) noexcept;
+
+  private:
+    std::size_t _start;
+  };
+
+  //! Longer than any small string buffer, so a temporary \c std::string of it would allocate.
+  inline constexpr std::string_view long_key{ "a key longer than any small string buffer" };
+  //! Like \c long_key , but missing from the containers of the tests.
+  inline constexpr std::string_view long_missing{ "a missing key longer than any small string buffer" };
+
   enum class test_map_entry
   {
     EXISTING,
@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "mapped_index.h"
+#include "select_or_default.h"
+
+using namespace select_n;
+
+namespace
+{
+  using index_t = mapped_index< relative_string, relative_string >;
+
+  int usage()
+  {
+    std::cerr << "usage: select_index build <input.tsv> <output.idx>\n"
+              << "       select_index get <index.idx> <key>...\n";
+    return EXIT_FAILURE;
+  }
+
+  //! Build an index from lines of tab separated keys and values.
+  int build( const char *input_path, const char *output_path )
+  {
+    std::ifstream input{ input_path };
+    if ( !input )
+    {
+      std::cerr << "select_index: cannot open " << input_path << '\n';
+      return EXIT_FAILURE;
+    }
+
+    mapped_index_builder< relative_string, relative_string > builder;
+    std::size_t line_number{ 0 };
+    for ( std::string line; std::getline( input, line ); )
+    {
+      ++line_number;
+      if ( line.empty() )
+        continue;
+
+      const auto tab{ line.find( '\t' ) };
+      if ( tab == std::string::npos )
+      {
+        std::cerr << "select_index: " << input_path << ':' << line_number << ": missing tab\n";
+        return EXIT_FAILURE;
+      }
+      builder.add( line.substr( 0, tab ), line.substr( tab + 1 ) );
+    }
+
+    const auto lines{ builder.size() };
+    builder.write( output_path );
+    std::cout << "wrote " << index_t{ output_path }.size() << " entries of " << lines << " lines to " << output_path << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  //! Print the values of keys, or an empty line for missing keys.
+  int get( const char *index_path, char **keys, const int count )
+  {
+    const index_t index{ index_path };
+    for ( int key{ 0 }; key < count; ++key )
+      std::cout << select_or_default( index, std::string_view{ keys[ key ] } ).view() << '\n';
+    return EXIT_SUCCESS;
+  }
+}
+
+int main( int argc, char **argv )
+{
+  try
+  {
+    if ( argc == 4 && std::string_view{ argv[ 1 ] } == "build" )
+      return build( argv[ 2 ], argv[ 3 ] );
+    else if ( argc >= 3 && std::string_view{ argv[ 1 ] } == "get" )
+      return get( argv[ 2 ], argv + 3, argc - 3 );
+    else
+      return usage();
+  }
+  catch ( const std::exception &error )
+  {
+    std::cerr << "select_index: " << error.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}